@@ -0,0 +1,244 @@
+#include "rarexsec/Service.h"
+#include "rarexsec/proc/Env.h"
+
+#include <TROOT.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Keeps a rarexsec::Service (Hub, caches, ROOT's jitted code) alive behind a local UNIX socket.
+// Requests and replies are single-line JSON; see rarexsec/Service.h for the operations.
+//
+//   rarexsec-daemon [--socket PATH] [--threads N]       serve until "shutdown" or SIGINT/SIGTERM
+//   rarexsec-daemon [--socket PATH] --send 'JSON'       send one request and print the reply
+//
+// The socket defaults to $RAREXSEC_SOCKET, then $TMPDIR/rarexsec-<uid>.sock; it is created with
+// mode 0600. --threads enables ROOT's implicit MT (0 = hardware concurrency). The sample catalogue
+// and its options come from the same RAREXSEC_* variables as the macros.
+//
+// Connections are served one at a time on the accepting thread, since the Service is not
+// thread-safe and a request's event loops already use every thread --threads allows. A second
+// client waits in the listen backlog until the first disconnects, so clients should close the
+// connection once they have their replies (--send does).
+
+namespace {
+
+volatile std::sig_atomic_t g_stop = 0;
+
+void on_signal(int) { g_stop = 1; }
+
+std::string default_socket()
+{
+    if (const char* s = std::getenv("RAREXSEC_SOCKET"); s && *s)
+        return s;
+    const char* tmp = std::getenv("TMPDIR");
+    return std::string(tmp && *tmp ? tmp : "/tmp") + "/rarexsec-" + std::to_string(::getuid()) + ".sock";
+}
+
+sockaddr_un address(const std::string& path)
+{
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path))
+        throw std::invalid_argument("socket path too long: " + path);
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return addr;
+}
+
+int connect_to(const std::string& path)
+{
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+    const auto addr = address(path);
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+        const int err = errno;
+        ::close(fd);
+        throw std::runtime_error("cannot connect to " + path + ": " + std::strerror(err));
+    }
+    return fd;
+}
+
+bool listening(const std::string& path)
+{
+    try {
+        ::close(connect_to(path));
+        return true;
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+}
+
+// A stale socket left by a daemon that did not shut down cleanly is replaced.
+int listen_on(const std::string& path)
+{
+    struct stat st {};
+    if (::lstat(path.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode))
+            throw std::runtime_error(path + " exists and is not a socket");
+        if (listening(path))
+            throw std::runtime_error("a daemon is already listening on " + path);
+        ::unlink(path.c_str());
+    }
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+    const auto addr = address(path);
+    const mode_t old = ::umask(077);
+    const int rc = ::bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+    ::umask(old);
+    if (rc != 0 || ::listen(fd, 16) != 0) {
+        const int err = errno;
+        ::close(fd);
+        throw std::runtime_error("cannot listen on " + path + ": " + std::strerror(err));
+    }
+    return fd;
+}
+
+bool write_all(int fd, const std::string& s)
+{
+    std::size_t off = 0;
+    while (off < s.size()) {
+        const ssize_t n = ::send(fd, s.data() + off, s.size() - off, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        off += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+// One request per line until the client closes the connection.
+void serve_connection(int fd, rarexsec::Service& service)
+{
+    std::string buf;
+    char chunk[1 << 16];
+    while (!service.stopping()) {
+        const ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR && !g_stop)
+            continue;
+        if (n <= 0)
+            return;
+        buf.append(chunk, static_cast<std::size_t>(n));
+        std::size_t nl;
+        while ((nl = buf.find('\n')) != std::string::npos) {
+            const std::string line = buf.substr(0, nl);
+            buf.erase(0, nl + 1);
+            if (line.find_first_not_of(" \t\r") == std::string::npos)
+                continue;
+            if (!write_all(fd, service.handle(line) + "\n"))
+                return;
+            if (service.stopping())
+                return;
+        }
+    }
+}
+
+int serve(const std::string& path, int threads)
+{
+    gROOT->SetBatch(kTRUE);
+    if (threads >= 0)
+        ROOT::EnableImplicitMT(static_cast<unsigned>(threads));
+    rarexsec::Service service(rarexsec::Env::from_env());
+
+    const int lfd = listen_on(path);
+    struct sigaction sa {};
+    sa.sa_handler = on_signal;
+    ::sigemptyset(&sa.sa_mask);
+    ::sigaction(SIGINT, &sa, nullptr);
+    ::sigaction(SIGTERM, &sa, nullptr);
+    std::cerr << "[rarexsec-daemon] listening on " << path << std::endl;
+
+    while (!g_stop && !service.stopping()) {
+        const int fd = ::accept(lfd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR)
+                continue;
+            std::cerr << "[rarexsec-daemon] accept: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        serve_connection(fd, service);
+        ::close(fd);
+    }
+    ::close(lfd);
+    ::unlink(path.c_str());
+    std::cerr << "[rarexsec-daemon] stopped" << std::endl;
+    return 0;
+}
+
+int send_request(const std::string& path, const std::string& request)
+{
+    const int fd = connect_to(path);
+    std::string line = request;
+    line.erase(std::remove(line.begin(), line.end(), '\n'), line.end());
+    if (!write_all(fd, line + "\n")) {
+        ::close(fd);
+        throw std::runtime_error("cannot send to " + path);
+    }
+    std::string reply;
+    char chunk[1 << 16];
+    while (reply.find('\n') == std::string::npos) {
+        const ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        reply.append(chunk, static_cast<std::size_t>(n));
+    }
+    ::close(fd);
+    if (reply.empty())
+        throw std::runtime_error("no reply from " + path);
+    std::cout << reply;
+    return reply.find("\"ok\":true") != std::string::npos ? 0 : 1;
+}
+
+void usage(const char* argv0)
+{
+    std::cerr << "usage: " << argv0 << " [--socket PATH] [--threads N]\n"
+              << "       " << argv0 << " [--socket PATH] --send 'JSON'\n";
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::string path = default_socket(), request;
+    int threads = -1;
+    bool client = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if ((arg == "--socket" || arg == "--threads" || arg == "--send") && i + 1 >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+        if (arg == "--socket") {
+            path = argv[++i];
+        } else if (arg == "--threads") {
+            threads = std::atoi(argv[++i]);
+        } else if (arg == "--send") {
+            client = true;
+            request = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    try {
+        return client ? send_request(path, request) : serve(path, threads);
+    } catch (const std::exception& e) {
+        std::cerr << "[rarexsec-daemon] " << e.what() << std::endl;
+        return 1;
+    }
+}
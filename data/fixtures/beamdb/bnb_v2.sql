@@ -0,0 +1,8 @@
+-- bnb DB of the BeamIndex check; see run.sql.
+CREATE TABLE bnb (run INTEGER, subrun INTEGER, E1DCNT REAL, tor860 REAL, tor875 REAL);
+INSERT INTO bnb VALUES
+  (1, 1, 21, 1.0, 2.0),
+  (1, 2, 22, 3.0, 0),
+  (1, 3, 23, 0.75, NULL),
+  (2, 2, 24, 0.25, 6.0),
+  (2, 2, 25, 0.5, 6.5);
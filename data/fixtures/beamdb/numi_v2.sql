@@ -0,0 +1,9 @@
+-- numi DB with the beam-quality-cut counts of the BeamIndex check; see run.sql.
+CREATE TABLE numi (run INTEGER, subrun INTEGER, EA9CNT_wcut REAL, tortgt_wcut REAL);
+INSERT INTO numi VALUES
+  (3, 1, 31, 1.5),
+  (3, 2, 32, 2.5),
+  (3, 3, 0, 3.5),
+  (4, 1, 41, 4.5),
+  (4, 1, 42, 4.25),
+  (4, 2, 43, 5.5);
@@ -0,0 +1,11 @@
+-- slip-stacking numi DB (per horn mode) of the BeamIndex check; see run.sql.
+CREATE TABLE numi (run INTEGER, subrun INTEGER,
+                   EA9CNT_fhc REAL, tortgt_fhc REAL, tor101_fhc REAL,
+                   EA9CNT_rhc REAL, tortgt_rhc REAL, tor101_rhc REAL);
+INSERT INTO numi VALUES
+  (3, 1, 10, 1.25, 1.0, 0, 0, 0),
+  (3, 2, 12, 0, 2.75, 0, 0, 0),
+  (3, 3, 0, 3.0, 3.25, 0, 0, 0),
+  (4, 1, 0, 0, 0, 20, 4.5, 4.0),
+  (4, 2, 0, 0, 0, 22, NULL, 5.25),
+  (4, 3, 0, 0, 0, NULL, 6.0, 6.5);
@@ -0,0 +1,35 @@
+-- runinfo of the BeamIndex check (macros/io/check_beam_index.C). Runs 1-2 exercise the BNB
+-- tor875/tor860 and bnb-DB/runinfo fallbacks, runs 3-4 the NuMI EA9CNT>0 rule.
+CREATE TABLE runinfo (run INTEGER, subrun INTEGER, begin_time TEXT, end_time TEXT,
+                      EXTTrig REAL, Gate2Trig REAL, E1DCNT REAL, tor860 REAL, tor875 REAL);
+INSERT INTO runinfo VALUES
+  -- in bnb DB: its tor875 wins
+  (1, 1, '2016-01-04T10:00:00', '2016-01-04T10:20:00', 100, 200, 11, 1.5, 1.25),
+  -- in bnb DB without tor875: runinfo tor875 still beats the bnb DB tor860
+  (1, 2, '2016-01-04T10:20:00', '2016-01-04T10:40:00', 101, 201, 12, 0, 2.5),
+  -- in bnb DB with tor860 only, runinfo without tor875: bnb DB tor860
+  (1, 3, '2016-01-04T10:40:00', '2016-01-04T11:00:00', 102, 202, 13, 0.5, 0),
+  -- not in bnb DB: runinfo tor875
+  (1, 4, '2016-01-05T09:00:00', '2016-01-05T09:20:00', 103, 203, 14, 3.5, 4.75),
+  -- not in bnb DB, no tor875 anywhere: runinfo tor860
+  (1, 5, '2016-01-05T09:20:00', '2016-01-05T09:40:00', 104, 204, 15, 5.5, NULL),
+  -- repeated row, counted once
+  (1, 5, '2016-01-05T09:20:00', '2016-01-05T09:40:00', 104, 204, 15, 5.5, NULL),
+  -- no toroid at all: zero BNB POT
+  (2, 1, '2016-02-01T00:00:00', '2016-02-01T00:20:00', 105, 205, 0, 0, 0),
+  -- bnb DB row repeated with different counts, collapsed with MAX
+  (2, 2, '2016-02-01T00:20:00', '2016-02-01T00:40:00', 106, 206, 16, 0, 0),
+  -- FHC: EA9CNT>0 with tortgt
+  (3, 1, '2017-03-01T12:00:00', '2017-03-01T12:20:00', 107, 207, 0, 0, 0),
+  -- FHC: EA9CNT>0 without tortgt, tor101 used
+  (3, 2, '2017-03-01T12:20:00', '2017-03-01T12:40:00', 108, 208, 0, 0, 0),
+  -- FHC: toroid counts but EA9CNT=0, zero POT
+  (3, 3, '2017-03-02T12:00:00', '2017-03-02T12:20:00', 109, 209, 0, 0, 0),
+  -- RHC: EA9CNT>0 with tortgt
+  (4, 1, '2018-06-01T08:00:00', '2018-06-01T08:20:00', 110, 210, 0, 0, 0),
+  -- RHC: EA9CNT>0 without tortgt, tor101 used
+  (4, 2, '2018-06-01T08:20:00', '2018-06-01T08:40:00', 111, 211, 0, 0, 0),
+  -- RHC: EA9CNT NULL, zero POT
+  (4, 3, '2018-06-02T08:00:00', '2018-06-02T08:20:00', 112, 212, 0, 0, 0),
+  -- in neither NuMI DB
+  (4, 4, '2018-06-02T08:20:00', '2018-06-02T08:40:00', 113, 213, 0, 0, 0);
@@ -572,6 +572,9 @@ def main() -> None:
                 logging.info("Skipping %s:%s (no samples).", beam_key, period)
                 continue
 
+            # Exclusion filters name other samples; resolve them to those samples' truth filters
+            truth_by_key = {x.get("sample_key"): x.get("truth_filter") for x in samples_in if x.get("truth_filter")}
+
             samples_out: list[dict] = []
             # We retain references to the processed entries for period-level EXT scaling
             period_data_entries: List[dict] = []
@@ -658,6 +661,17 @@ def main() -> None:
                     if rp:
                         s["file"] = str(ntuple_dir / rp)
                 s["kind"] = classify_kind(s)
+                exclusions = []
+                for key in s.get("exclusion_truth_filters", []) or []:
+                    if key not in truth_by_key:
+                        raise ValueError(f"{beam_key}:{period}: exclusion '{key}' names no sample with a truth_filter")
+                    exclusions.append(truth_by_key[key])
+                if exclusions:
+                    s["exclusion_truth_filters"] = exclusions
+                else:
+                    s.pop("exclusion_truth_filters", None)
+                if not s.get("truth_filter"):
+                    s.pop("truth_filter", None)
                 dv_list = s.pop("detector_variations", []) or []
                 detvars = {}
                 for dv in dv_list:
@@ -675,8 +689,7 @@ def main() -> None:
                     if k.startswith("__"):
                         s.pop(k, None)
                 # Drop fields not needed downstream
-                for k in ("sample_key", "sample_type", "truth_filter", "exclusion_truth_filters",
-                          "relative_path", "variation_type", "stage_name"):
+                for k in ("sample_key", "sample_type", "relative_path", "variation_type", "stage_name"):
                     s.pop(k, None)
 
             run_copy = dict(run_details)
@@ -1,10 +1,27 @@
 #include "rarexsec/Hub.h"
 #include "rarexsec/Processor.h"
+#include "rarexsec/io/BeamIndex.h"
+#include "rarexsec/io/EntryIndex.h"
+#include "rarexsec/io/Exposure.h"
+#include "rarexsec/io/ReadAhead.h"
+#include "rarexsec/io/RunMask.h"
+#include "rarexsec/proc/Selection.h"
 #include "rarexsec/proc/Volume.h"
 
+#include <TChain.h>
+#include <TEntryList.h>
+#include <TEnv.h>
+#include <TFile.h>
+#include <TTree.h>
+#include <TTreeCache.h>
+
 #include <algorithm>
 #include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
 #include <fstream>
+#include <iostream>
 #include <nlohmann/json.hpp>
 #include <sstream>
 #include <stdexcept>
@@ -15,6 +32,8 @@
 
 using json = nlohmann::json;
 
+static const std::string kEventTree = "nuselection/EventSelectionFilter";
+
 //____________________________________________________________________________
 static std::string to_lower(std::string s)
 {
@@ -52,20 +71,248 @@ parse_kind_slice(const std::string& kind, const json& s)
     throw std::runtime_error("unknown kind: " + kind);
 }
 //____________________________________________________________________________
+static std::vector<std::string> sample_files(const json& s)
+{
+    if (s.contains("files"))
+        return s.at("files").get<std::vector<std::string>>();
+    if (s.contains("file")) {
+        const auto f = s.at("file").get<std::string>();
+        return f.empty() ? std::vector<std::string>{} : std::vector<std::string>{f};
+    }
+    throw std::runtime_error("sample missing 'file' or 'files'");
+}
+//____________________________________________________________________________
+// {"file": path} or {"runs": [run | [run, subrun] | [run, first, last], ...]}
+template <class Resolve>
+static rarexsec::io::RunMask parse_good_runs(const json& g, const Resolve& resolve)
+{
+    if (g.contains("file"))
+        return rarexsec::io::RunMask::read(resolve(g.at("file").get<std::string>()));
+    std::vector<rarexsec::io::RunMask::Range> ranges;
+    for (const auto& r : g.at("runs")) {
+        rarexsec::io::RunMask::Range range;
+        if (r.is_number_unsigned()) {
+            range.run = r.get<std::uint32_t>();
+        } else if (r.is_array() && (r.size() == 2 || r.size() == 3)) {
+            range.run = r.at(0).get<std::uint32_t>();
+            range.first = range.last = r.at(1).get<std::uint32_t>();
+            if (r.size() == 3)
+                range.last = r.at(2).get<std::uint32_t>();
+        } else {
+            throw std::runtime_error("good_runs: bad entry " + r.dump());
+        }
+        ranges.push_back(range);
+    }
+    return rarexsec::io::RunMask(std::move(ranges));
+}
+//____________________________________________________________________________
+// Exposure of the data in a beam-index total: POT of the beamline's horn mode and the triggers EXT
+// is scaled to (E1DCNT for BNB, EA9CNT after the beam-quality cuts for NuMI).
+static std::pair<double, double> data_exposure(const std::string& beamline, const rarexsec::io::BeamTotals& t)
+{
+    const auto bl = to_lower(beamline);
+    if (bl.find("numi") != std::string::npos) {
+        const bool fhc = bl.find("fhc") != std::string::npos, rhc = bl.find("rhc") != std::string::npos;
+        const double pot = fhc ? t.pot_fhc : (rhc ? t.pot_rhc : t.pot_fhc + t.pot_rhc);
+        return {pot, t.ea9cnt_wcut};
+    }
+    if (bl.find("bnb") != std::string::npos)
+        return {t.pot_bnb, t.e1dcnt};
+    throw std::runtime_error("good_runs: cannot tell the beam of beamline " + beamline);
+}
+//____________________________________________________________________________
+static rarexsec::io::EntryRanges build_entry_ranges(const rarexsec::Entry& rec, const std::string& file,
+                                                    rarexsec::selection::Preset preset)
+{
+    ROOT::RDataFrame df(kEventTree, file);
+    ROOT::RDF::RNode node = df;
+    node = rarexsec::processor().run(node, rec);
+    node = rarexsec::selection::apply(node, preset, rec);
+    // for a single-file TTree input rdfentry_ is the entry number within that file
+    auto taken = node.Take<ULong64_t>("rdfentry_");
+    std::vector<std::uint64_t> entries(taken->begin(), taken->end());
+    return rarexsec::io::EntryRanges::from_entries(std::move(entries));
+}
+//____________________________________________________________________________
 rarexsec::Frame rarexsec::Hub::sample(const Entry& rec) const
 {
-    static const std::string tree = "nuselection/EventSelectionFilter";
-    auto df_ptr = std::make_shared<ROOT::RDataFrame>(tree, rec.files);
-    ROOT::RDF::RNode node = *df_ptr;
+    return sample(rec, "", 0, 0);
+}
+//____________________________________________________________________________
+rarexsec::Frame rarexsec::Hub::sample(const Entry& rec, std::uint64_t begin, std::uint64_t end) const
+{
+    if (end != 0 && end <= begin)
+        throw std::invalid_argument("Hub::sample: empty entry range");
+    return sample(rec, "", begin, end);
+}
+//____________________________________________________________________________
+rarexsec::Frame rarexsec::Hub::sample(const Entry& rec, const std::string& stream, std::uint64_t begin,
+                                      std::uint64_t end) const
+{
+    const bool ranged = begin != 0 || end != 0;
+    const auto files = input_files(rec);
+    Frame frame;
+    if (!(opt_.entry_index && restrict_to_index(rec, files, frame))) {
+        if (opt_.cache_bytes > 0 || opt_.learn_entries > 0) {
+            frame.chain = std::make_shared<TChain>(kEventTree.c_str());
+            for (const auto& file : files)
+                frame.chain->Add(file.c_str());
+            frame.df = std::make_shared<ROOT::RDataFrame>(*frame.chain);
+        } else {
+            frame.df = std::make_shared<ROOT::RDataFrame>(kEventTree, files);
+        }
+    }
+    if (frame.chain) {
+        if (opt_.cache_bytes > 0)
+            frame.chain->SetCacheSize(opt_.cache_bytes);
+        if (opt_.learn_entries > 0)
+            frame.chain->SetCacheLearnEntries(opt_.learn_entries);
+    }
+    if (read_ahead_ && !ranged) {
+        const std::size_t group = read_ahead_->add_group(stream, files);
+        frame.loop_start = frame.df->Count();
+        frame.loop_start.OnPartialResult(ROOT::RDF::RResultPtr<ULong64_t>::kOnce,
+                                         [ra = read_ahead_, group](ULong64_t&) { ra->started(group); });
+    }
+    ROOT::RDF::RNode node = *frame.df;
+    if (ranged)
+        node = node.Range(begin, end);
 
     node = processor().run(node, rec);
     node = apply_slice(node, rec);
+    node = apply_good_runs(node, rec);
 
-    return Frame{df_ptr, std::move(node)};
+    frame.node = std::move(node);
+    return frame;
+}
+//____________________________________________________________________________
+std::uint64_t rarexsec::Hub::read_ahead_bytes() const
+{
+    return read_ahead_ ? read_ahead_->bytes_warmed() : 0;
+}
+//____________________________________________________________________________
+std::vector<std::string> rarexsec::Hub::input_files(const Entry& rec) const
+{
+    if (skims_.empty() || opt_.columns.empty())
+        return rec.files;
+    std::vector<std::string> out;
+    for (const auto& file : rec.files) {
+        auto it = skims_.find(file);
+        if (it == skims_.end())
+            return rec.files;
+        const io::SkimInfo& s = it->second;
+        const auto st = io::stamp(file);
+        const bool current = s.processor_version == Processor::version && (!st || *st == s.source_stamp);
+        // the usage log also holds JIT identifiers and branches of other sample kinds: only the
+        // names that are branches of this source have to survive in the skim (overlays written
+        // before source_branches was recorded are checked against every name)
+        const bool covers = std::all_of(opt_.columns.begin(), opt_.columns.end(), [&](const std::string& c) {
+            const bool in_source = s.source_branches.empty() ||
+                                   std::find(s.source_branches.begin(), s.source_branches.end(), c) !=
+                                       s.source_branches.end();
+            return !in_source || std::find(s.branches.begin(), s.branches.end(), c) != s.branches.end();
+        });
+        if (!current || !covers || (!s.preselection.empty() && !opt_.allow_preselected_skims))
+            return rec.files;
+        out.push_back(s.file);
+    }
+    return out;
+}
+//____________________________________________________________________________
+std::optional<std::vector<std::pair<std::string, rarexsec::io::EntryRanges>>>
+rarexsec::Hub::index_lists(const Entry& rec, const std::vector<std::string>& files) const
+{
+    const auto preset = *opt_.entry_index;
+    const std::string key = selection::preset_name(preset);
+
+    std::vector<std::pair<std::string, io::EntryRanges>> lists;
+    for (const auto& file : files) {
+        const auto st = io::stamp(file);
+        if (!st)
+            return std::nullopt;
+        const auto path = io::index_path(file, key, Processor::version, opt_.index_dir);
+        auto ranges = io::read_index(path, *st, key, Processor::version);
+        if (!ranges) {
+            if (!opt_.build_index)
+                return std::nullopt;
+            ranges = build_entry_ranges(rec, file, preset);
+            try {
+                io::write_index(path, *st, key, Processor::version, *ranges);
+            } catch (const std::exception& ex) {
+                std::cerr << "[Hub] " << ex.what() << "; using the entry index in memory only" << std::endl;
+            }
+        }
+        lists.emplace_back(file, std::move(*ranges));
+    }
+    return lists;
 }
 //____________________________________________________________________________
-rarexsec::Hub::Hub(const std::string& path)
+std::uint64_t rarexsec::Hub::entries(const Entry& rec) const
 {
+    const auto files = input_files(rec);
+    if (opt_.entry_index) {
+        if (const auto lists = index_lists(rec, files)) {
+            std::uint64_t n = 0;
+            for (const auto& [file, ranges] : *lists)
+                n += ranges.count();
+            return n;
+        }
+    }
+    std::uint64_t n = 0;
+    for (const auto& path : files) {
+        std::unique_ptr<TFile> f(TFile::Open(path.c_str(), "READ"));
+        if (!f || f->IsZombie())
+            throw std::runtime_error("Hub::entries: cannot open " + path);
+        auto* tree = f->Get<TTree>(kEventTree.c_str());
+        if (!tree)
+            throw std::runtime_error("Hub::entries: no " + kEventTree + " in " + path);
+        n += static_cast<std::uint64_t>(tree->GetEntries());
+    }
+    return n;
+}
+//____________________________________________________________________________
+bool rarexsec::Hub::restrict_to_index(const Entry& rec, const std::vector<std::string>& files,
+                                      Frame& frame) const
+{
+    const std::string key = selection::preset_name(*opt_.entry_index);
+    const auto lists = index_lists(rec, files);
+    if (!lists)
+        return false;
+
+    // files without a sub-list contribute no entries
+    auto chain = std::make_shared<TChain>(kEventTree.c_str());
+    auto elist = std::make_shared<TEntryList>("rarexsec_entries", key.c_str());
+    for (const auto& [file, ranges] : *lists) {
+        chain->Add(file.c_str());
+        if (ranges.empty())
+            continue;
+        TEntryList sub("", "", kEventTree.c_str(), file.c_str());
+        for (const auto& r : ranges.ranges())
+            for (std::uint64_t e = r.first; e < r.second; ++e)
+                sub.Enter(static_cast<Long64_t>(e));
+        elist->Add(&sub);
+    }
+    chain->SetEntryList(elist.get());
+
+    frame.chain = std::move(chain);
+    frame.entries = std::move(elist);
+    frame.df = std::make_shared<ROOT::RDataFrame>(*frame.chain);
+    return true;
+}
+//____________________________________________________________________________
+rarexsec::Hub::Hub(const std::string& path) : Hub(path, Options{}) {}
+//____________________________________________________________________________
+rarexsec::Hub::Hub(const std::string& path, Options opt) : opt_(std::move(opt))
+{
+    if (!opt_.skim_overlay.empty())
+        skims_ = io::read_skim_overlay(opt_.skim_overlay);
+    if (opt_.prefetch)
+        gEnv->SetValue("TFile.AsyncPrefetching", 1);
+    if (opt_.learn_entries > 0)
+        TTreeCache::SetLearnEntries(opt_.learn_entries);
+    if (opt_.read_ahead_bytes > 0)
+        read_ahead_ = std::make_shared<io::ReadAhead>(opt_.read_ahead_bytes);
+
     std::ifstream cfg(path);
     if (!cfg)
         throw std::runtime_error("cannot open " + path);
@@ -73,6 +320,46 @@ rarexsec::Hub::Hub(const std::string& path)
     cfg >> j;
 
     const auto& bl = j.at("beamlines");
+
+    // all simulation files are summed in one parallel pass before the samples are built
+    std::unordered_map<std::string, io::Exposure> exposure;
+    std::vector<std::string> exposure_errors;
+    std::optional<io::BeamIndex> beam;
+    if (!opt_.beam_index.empty())
+        beam = io::BeamIndex::load(opt_.beam_index);
+
+    // good-run files are looked up next to the catalogue
+    const auto resolve = [base = std::filesystem::path(path).parent_path()](const std::string& f) {
+        const std::filesystem::path p(f);
+        return (p.is_absolute() ? p : base / p).string();
+    };
+    if (opt_.exposure != Options::ExposureMode::Catalogue) {
+        std::vector<std::string> files;
+        std::unordered_set<std::string> seen;
+        for (const auto& runs : bl)
+            for (const auto& run : runs)
+                for (const auto& s : run.at("samples")) {
+                    const auto kind = to_lower(s.at("kind").get<std::string>());
+                    if (parse_kind_slice(kind, s).first != Source::MC)
+                        continue;
+                    for (auto& f : sample_files(s))
+                        if (seen.insert(f).second)
+                            files.push_back(std::move(f));
+                }
+        io::ExposureCache cache = opt_.exposure_cache.empty() ? io::ExposureCache{}
+                                                              : io::ExposureCache(opt_.exposure_cache);
+        const auto per_file = io::file_exposures(files, &cache);
+        for (std::size_t i = 0; i < files.size(); ++i)
+            exposure.emplace(files[i], per_file[i]);
+        if (cache.dirty() && !opt_.exposure_cache.empty()) {
+            try {
+                cache.save();
+            } catch (const std::exception& ex) {
+                std::cerr << "[Hub] " << ex.what() << "; exposure cache not updated" << std::endl;
+            }
+        }
+    }
+
     for (auto it_bl = bl.begin(); it_bl != bl.end(); ++it_bl) {
         const std::string beamline = it_bl.key();
         const auto& runs = it_bl.value();
@@ -82,6 +369,52 @@ rarexsec::Hub::Hub(const std::string& path)
             const auto& arr = it_r.value().at("samples");
             auto& bucket = db_[beamline][period];
 
+            // good-run list of the period: a path, or {"file"|"runs", "pot", "triggers"}. The masked
+            // data exposure replaces the period's nominal one: with a beam index it is summed over
+            // the data samples' subruns in the list, otherwise pot and triggers must give it
+            std::shared_ptr<const io::RunMask> mask;
+            std::optional<double> mask_pot, mask_triggers;
+            const auto masked_subruns = [&](const std::vector<std::string>& files) {
+                std::vector<io::BeamIndex::Key> keys;
+                for (const auto& f : files) {
+                    const auto k = io::read_subruns(f);
+                    keys.insert(keys.end(), k.begin(), k.end());
+                }
+                if (mask)
+                    keys.erase(std::remove_if(keys.begin(), keys.end(),
+                                              [&](const io::BeamIndex::Key& k) {
+                                                  return !mask->contains(k.first, k.second);
+                                              }),
+                               keys.end());
+                return keys;
+            };
+            if (it_r.value().contains("good_runs")) {
+                const auto& g = it_r.value().at("good_runs");
+                mask = std::make_shared<const io::RunMask>(
+                    g.is_string() ? io::RunMask::read(resolve(g.get<std::string>())) : parse_good_runs(g, resolve));
+                if (g.is_object() && g.contains("pot"))
+                    mask_pot = g.at("pot").get<double>();
+                if (g.is_object() && g.contains("triggers"))
+                    mask_triggers = g.at("triggers").get<double>();
+                good_runs_[beamline + "/" + period] = mask;
+
+                std::vector<std::string> data_files;
+                for (const auto& s : arr)
+                    if (parse_kind_slice(to_lower(s.at("kind").get<std::string>()), s).first == Source::Data)
+                        for (auto& f : sample_files(s))
+                            data_files.push_back(std::move(f));
+                if (beam && !data_files.empty()) {
+                    std::vector<io::BeamIndex::Key> missing;
+                    const auto totals = beam->subruns(masked_subruns(data_files), &missing);
+                    if (!missing.empty())
+                        std::cerr << "[Hub] " << beamline << "/" << period << ": " << missing.size()
+                                  << " data subruns are not in the beam index" << std::endl;
+                    const auto [pot, triggers] = data_exposure(beamline, totals);
+                    mask_pot = pot;
+                    mask_triggers = triggers;
+                }
+            }
+
             for (const auto& s : arr) {
                 Entry rec;
                 rec.beamline = beamline;
@@ -92,27 +425,71 @@ rarexsec::Hub::Hub(const std::string& path)
                 rec.kind = (kind_str == "dirt") ? sample::origin::dirt
                                                 : sample::from_source_slice(rec.source, rec.slice);
 
-                if (s.contains("files")) {
-                    rec.files = s.at("files").get<std::vector<std::string>>();
-                } else if (s.contains("file")) {
-                    const auto f = s.at("file").get<std::string>();
-                    rec.files = f.empty() ? std::vector<std::string>{} : std::vector<std::string>{f};
-                } else {
-                    throw std::runtime_error("sample missing 'file' or 'files'");
-                }
+                rec.files = sample_files(s);
                 if (rec.files.empty())
                     throw std::runtime_error("empty 'files' for sample in " + beamline + "/" + period);
                 rec.file = rec.files.front();
 
+                rec.truth_filter = s.value("truth_filter", std::string());
+                rec.exclusion_truth_filters =
+                    s.value("exclusion_truth_filters", std::vector<std::string>{});
+                if (rec.source == Source::MC &&
+                    (!rec.truth_filter.empty() || !rec.exclusion_truth_filters.empty())) {
+                    const auto expr = TruthFilter::combine(rec.truth_filter, rec.exclusion_truth_filters);
+                    truth_filters_.try_emplace(expr, expr);
+                }
+
                 if (rec.source == Source::Ext) {
-                    rec.trig_nom = s.value("trig", 0.0);
+                    if (mask && !beam)
+                        throw std::runtime_error(beamline + "/" + period +
+                                                 ": good-run list without a beam index; the EXT triggers "
+                                                 "cannot be masked");
+                    if (mask && !mask_triggers)
+                        throw std::runtime_error(beamline + "/" + period +
+                                                 ": good-run list without data subruns or 'triggers'; EXT "
+                                                 "cannot be normalised");
+                    rec.trig_nom = mask_triggers.value_or(s.value("trig", 0.0));
                     rec.trig_eqv = s.value("trig_eff", 0.0);
+                    if (beam && (mask || opt_.exposure != Options::ExposureMode::Catalogue)) {
+                        std::vector<io::BeamIndex::Key> missing;
+                        const double trig = beam->subruns(masked_subruns(rec.files), &missing).ext_triggers;
+                        if (!missing.empty())
+                            std::cerr << "[Hub] " << rec.file << ": " << missing.size()
+                                      << " subruns are not in the beam index" << std::endl;
+                        // the catalogue's count covers every subrun, so a masked sample always takes
+                        // the masked sum
+                        if (mask || opt_.exposure == Options::ExposureMode::Fill) {
+                            rec.trig_eqv = trig;
+                        } else if (std::abs(trig - rec.trig_eqv) > opt_.exposure_tolerance * std::abs(trig)) {
+                            std::ostringstream msg;
+                            msg << beamline << "/" << period << " " << rec.file << ": catalogue trig_eff "
+                                << rec.trig_eqv << ", beam index " << trig;
+                            exposure_errors.push_back(msg.str());
+                        }
+                    }
                 } else if (rec.source == Source::MC) {
-                    rec.pot_nom = s.value("pot", 0.0);
+                    if (mask && !mask_pot)
+                        throw std::runtime_error(beamline + "/" + period +
+                                                 ": good-run list without a beam index and data subruns, or "
+                                                 "'pot'; simulation cannot be normalised");
+                    rec.pot_nom = mask_pot.value_or(s.value("pot", 0.0));
                     rec.pot_eqv = s.value("pot_eff", 0.0);
+                    if (!exposure.empty()) {
+                        double pot = 0.0;
+                        for (const auto& f : rec.files)
+                            pot += exposure.at(f).pot;
+                        if (opt_.exposure == Options::ExposureMode::Fill) {
+                            rec.pot_eqv = pot;
+                        } else if (std::abs(pot - rec.pot_eqv) > opt_.exposure_tolerance * std::abs(pot)) {
+                            std::ostringstream msg;
+                            msg << beamline << "/" << period << " " << rec.file << ": catalogue pot_eff "
+                                << rec.pot_eqv << ", ntuples " << pot;
+                            exposure_errors.push_back(msg.str());
+                        }
+                    }
                 }
 
-                rec.nominal = sample(rec);
+                rec.nominal = sample(rec, "nominal", 0, 0);
 
                 if (s.contains("detvars")) {
                     const auto& dvs = s.at("detvars");
@@ -129,7 +506,7 @@ rarexsec::Hub::Hub(const std::string& path)
                             Entry dv = rec;
                             dv.files = std::move(dv_files);
                             dv.file = dv.files.front();
-                            rec.detvars.emplace(tag, sample(dv));
+                            rec.detvars.emplace(tag, sample(dv, "detvar:" + tag, 0, 0));
                         }
                     }
                 }
@@ -138,14 +515,28 @@ rarexsec::Hub::Hub(const std::string& path)
             }
         }
     }
+
+    if (!exposure_errors.empty()) {
+        std::string msg = "exposure check failed:";
+        for (const auto& e : exposure_errors)
+            msg += "\n  " + e;
+        throw std::runtime_error(msg);
+    }
 }
 //____________________________________________________________________________
-ROOT::RDF::RNode rarexsec::Hub::apply_slice(ROOT::RDF::RNode node, const Entry& rec)
+ROOT::RDF::RNode rarexsec::Hub::apply_slice(ROOT::RDF::RNode node, const Entry& rec) const
 {
     using rarexsec::Slice;
     using rarexsec::Source;
 
     if (rec.source == Source::MC) {
+        if (!rec.truth_filter.empty() || !rec.exclusion_truth_filters.empty()) {
+            const auto expr = TruthFilter::combine(rec.truth_filter, rec.exclusion_truth_filters);
+            auto it = truth_filters_.find(expr);
+            if (it != truth_filters_.end())
+                return it->second.apply(node, "truth_filter");
+            return TruthFilter(expr).apply(node, "truth_filter");
+        }
         if (rec.slice == Slice::StrangenessInclusive)
             return node.Filter([](bool s) { return s; }, {"is_strange"});
         if (rec.slice == Slice::BeamInclusive)
@@ -158,6 +549,19 @@ ROOT::RDF::RNode rarexsec::Hub::apply_slice(ROOT::RDF::RNode node, const Entry&
     return node;
 }
 //____________________________________________________________________________
+ROOT::RDF::RNode rarexsec::Hub::apply_good_runs(ROOT::RDF::RNode node, const Entry& rec) const
+{
+    if (rec.source == Source::MC)
+        return node;
+    auto it = good_runs_.find(rec.beamline + "/" + rec.period);
+    if (it == good_runs_.end())
+        return node;
+    io::branch_usage().request(std::vector<std::string>{"run", "sub"});
+    return node.Filter([mask = it->second](int run, int sub) {
+        return mask->contains(static_cast<std::uint32_t>(run), static_cast<std::uint32_t>(sub));
+    }, {"run", "sub"}, "good_runs");
+}
+//____________________________________________________________________________
 std::vector<const rarexsec::Entry*>
 rarexsec::Hub::simulation_entries(const std::string& beamline,
                                   const std::vector<std::string>& periods) const
@@ -2,17 +2,95 @@
 
 #include "rarexsec/proc/DataModel.h"
 #include "rarexsec/Processor.h"
+#include "rarexsec/TruthFilter.h"
+#include "rarexsec/io/BranchUsage.h"
+#include "rarexsec/io/Skim.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace rarexsec {
 
+namespace selection {
+enum class Preset;
+}
+
+namespace io {
+class ReadAhead;
+class RunMask;
+}
+
 class Hub {
   public:
+    struct Options {
+        // Restrict every sample to the entries passing this preset, using per-file entry indices
+        // keyed on (input file, preset, Processor::version). Downstream selections must be at
+        // least as tight as this preset.
+        std::optional<selection::Preset> entry_index;
+        // Where index sidecars live; empty keeps them next to each input file.
+        std::string index_dir;
+        // Build and store missing or stale indices (one event loop per file); otherwise such
+        // samples are read in full.
+        bool build_index = true;
+
+        // Catalogue overlay from io::write_skims. A sample reads its skims instead of the
+        // originals when every file has a current skim keeping each of columns that is a branch
+        // of the original.
+        std::string skim_overlay;
+        // Input branches the job reads, e.g. from the branch-usage log; skims are not used
+        // without it.
+        std::vector<std::string> columns;
+        // Also accept pre-selected skims; only valid when the job applies those presets anyway.
+        bool allow_preselected_skims = false;
+
+        // TTreeCache size in bytes for the chain behind each sample (0 keeps ROOT's default);
+        // with implicit MT the per-task trees keep ROOT's default size.
+        long long cache_bytes = 0;
+        // Entries the cache learns the branch set from (0 keeps ROOT's default).
+        int learn_entries = 0;
+        // Asynchronous prefetching of baskets (TFile.AsyncPrefetching); set before any file opens.
+        bool prefetch = false;
+        // When non-zero, the start of a sample's first event loop warms the first read_ahead_bytes
+        // of the next sample's files in the background; see io::ReadAhead.
+        std::size_t read_ahead_bytes = 0;
+
+        // Exposure of simulation samples: Catalogue takes pot_eff from the catalogue, Fill sums
+        // the POT of the ntuples' SubRun trees instead, and Check sums it and throws when the
+        // catalogue differs by more than exposure_tolerance (relative).
+        enum class ExposureMode { Catalogue, Fill, Check };
+        ExposureMode exposure = ExposureMode::Catalogue;
+        // Per-file totals reused across jobs; see io::ExposureCache.
+        std::string exposure_cache;
+        double exposure_tolerance = 1e-6;
+        // Beam index from io::BeamIndex; with Fill or Check, EXT samples take trig_eqv from the
+        // EXTTrig of the (run, subrun) pairs in their SubRun trees. Periods with a good-run list
+        // need it (or the list's own pot and triggers) to sum the masked data exposure.
+        std::string beam_index;
+    };
+
     explicit Hub(const std::string& path);
+    Hub(const std::string& path, Options opt);
 
     Frame sample(const Entry& rec) const;
+    // Entries [begin, end) of the sample, counted after any entry index; end = 0 reads to the
+    // last entry. RDataFrame::Range needs implicit MT off, so this is for single-threaded shards
+    // (see exec::run_sharded); such frames are not scheduled for read-ahead.
+    Frame sample(const Entry& rec, std::uint64_t begin, std::uint64_t end) const;
+    // Entries that sample(rec, begin, end) counts over: those the entry index selects when it
+    // applies, otherwise every entry of the files read (skims included).
+    std::uint64_t entries(const Entry& rec) const;
+
+    // Bytes pulled into the page cache by the read-ahead scheduler so far.
+    std::uint64_t read_ahead_bytes() const;
+
+    // Columns requested by this process so far; see io::BranchUsage.
+    static const io::BranchUsage& usage() { return io::branch_usage(); }
 
     std::vector<const Entry*> simulation_entries(const std::string& beamline,
                                                  const std::vector<std::string>& periods) const;
@@ -20,7 +98,23 @@ class Hub {
                                            const std::vector<std::string>& periods) const;
 
   private:
-    static ROOT::RDF::RNode apply_slice(ROOT::RDF::RNode node, const Entry& rec);
+    Frame sample(const Entry& rec, const std::string& stream, std::uint64_t begin, std::uint64_t end) const;
+    ROOT::RDF::RNode apply_slice(ROOT::RDF::RNode node, const Entry& rec) const;
+    // Data and EXT events outside the period's good-run list are dropped.
+    ROOT::RDF::RNode apply_good_runs(ROOT::RDF::RNode node, const Entry& rec) const;
+    std::vector<std::string> input_files(const Entry& rec) const;
+    // Selected entries of each file, or nullopt when the index cannot be used for every file.
+    std::optional<std::vector<std::pair<std::string, io::EntryRanges>>>
+    index_lists(const Entry& rec, const std::vector<std::string>& files) const;
+    bool restrict_to_index(const Entry& rec, const std::vector<std::string>& files, Frame& frame) const;
+
+    Options opt_;
+    std::map<std::string, io::SkimInfo> skims_;
+    std::shared_ptr<io::ReadAhead> read_ahead_;
+    // Compiled truth filters keyed on the combined expression, shared by samples and variations
+    std::unordered_map<std::string, TruthFilter> truth_filters_;
+    // Good-run lists keyed on "beamline/period"
+    std::unordered_map<std::string, std::shared_ptr<const io::RunMask>> good_runs_;
 
     using PeriodDB = std::unordered_map<std::string, std::vector<Entry>>;
     std::unordered_map<std::string, PeriodDB> db_;
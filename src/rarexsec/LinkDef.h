@@ -0,0 +1,41 @@
+// Dictionary for the public interactive headers (DICT_HEADERS in the Makefile). Nothing here is
+// written to ROOT files, so no streamers are generated; the dictionary exists for the rootmap,
+// which lets ROOT load librarexsec on first use, and, when ROOT uses runtime C++ modules, for the
+// module that spares macros from re-parsing Hub.h, Plotter.h and what they include at start-up.
+#ifdef __CLING__
+
+#pragma link off all globals;
+#pragma link off all classes;
+#pragma link off all functions;
+#pragma link C++ nestedclasses;
+#pragma link C++ nestedtypedefs;
+
+#pragma link C++ namespace rarexsec;
+#pragma link C++ namespace rarexsec::selection;
+#pragma link C++ namespace rarexsec::io;
+#pragma link C++ namespace rarexsec::exec;
+#pragma link C++ namespace rarexsec::plot;
+#pragma link C++ namespace rarexsec::systpack;
+
+#pragma link C++ class rarexsec::Env-;
+#pragma link C++ class rarexsec::Frame-;
+#pragma link C++ class rarexsec::Entry-;
+#pragma link C++ class rarexsec::Hub-;
+#pragma link C++ class rarexsec::Processor-;
+#pragma link C++ class rarexsec::TruthFilter-;
+#pragma link C++ class rarexsec::Runner-;
+#pragma link C++ class rarexsec::selection::Cutflow-;
+#pragma link C++ class rarexsec::io::BeamIndex-;
+#pragma link C++ class rarexsec::io::BranchUsage-;
+#pragma link C++ class rarexsec::io::EventIndex-;
+#pragma link C++ class rarexsec::exec::Partial-;
+#pragma link C++ class rarexsec::plot::Plotter-;
+#pragma link C++ class rarexsec::plot::EventDisplay-;
+#pragma link C++ class rarexsec::plot::RenderQueue-;
+#pragma link C++ class rarexsec::systpack::SystematicsPack-;
+
+#pragma link C++ enum rarexsec::Source;
+#pragma link C++ enum rarexsec::Slice;
+#pragma link C++ enum rarexsec::selection::Preset;
+
+#endif
@@ -1,4 +1,5 @@
 #include "rarexsec/Processor.h"
+#include "rarexsec/io/BranchUsage.h"
 #include "rarexsec/proc/Selection.h"
 #include "rarexsec/proc/Volume.h"
 
@@ -8,6 +9,7 @@
 #include <cstdint>
 #include <cstdlib>
 #include <string>
+#include <utility>
 
 namespace {
 constexpr double kRecognisedPurityMin = 0.5;
@@ -32,6 +34,15 @@ inline std::uint64_t training_hash(std::uint32_t run, std::uint32_t subrun, std:
     return splitmix64(key);
 }
 
+// Define that also records the column's inputs, so branch usage resolves through Processor columns
+template <class F>
+ROOT::RDF::RNode define(ROOT::RDF::RNode node, const std::string& name, F&& f,
+                        const ROOT::RDF::ColumnNames_t& inputs = {})
+{
+    rarexsec::io::branch_usage().define(name, inputs);
+    return node.Define(name, std::forward<F>(f), inputs);
+}
+
 inline float u01_from_hash(std::uint64_t h) noexcept
 {
     constexpr std::uint64_t denom = (1ULL << 24);
@@ -40,6 +51,15 @@ inline float u01_from_hash(std::uint64_t h) noexcept
 }
 }
 
+//____________________________________________________________________________
+double rarexsec::Processor::exposure_scale(const rarexsec::Entry& rec)
+{
+    if (rec.source == Source::MC && rec.pot_nom > 0.0 && rec.pot_eqv > 0.0)
+        return rec.pot_nom / rec.pot_eqv;
+    if (rec.source == Source::Ext && rec.trig_nom > 0.0 && rec.trig_eqv > 0.0)
+        return rec.trig_nom / rec.trig_eqv;
+    return 1.0;
+}
 //____________________________________________________________________________
 ROOT::RDF::RNode rarexsec::Processor::run(ROOT::RDF::RNode node,
                                           const rarexsec::Entry& rec) const
@@ -48,28 +68,26 @@ ROOT::RDF::RNode rarexsec::Processor::run(ROOT::RDF::RNode node,
     const bool is_ext = (rec.source == Source::Ext);
     const bool is_mc = (rec.source == Source::MC);
 
-    const double scale_mc = (is_mc && rec.pot_nom > 0.0 && rec.pot_eqv > 0.0) ? (rec.pot_nom / rec.pot_eqv) : 1.0;
-    const double scale_ext = (is_ext && rec.trig_nom > 0.0 && rec.trig_eqv > 0.0) ? (rec.trig_nom / rec.trig_eqv) : 1.0;
+    const double scale = exposure_scale(rec);
 
-    node = node.Define("w_base", [is_mc, is_ext, scale_mc, scale_ext] {
-        const double scale = is_mc ? scale_mc : (is_ext ? scale_ext : 1.0);
-        return static_cast<float>(scale);
-    });
+    // double, so that a partial filled at unit scale and scaled on merge (exec::Incremental) sums
+    // to what a full run does
+    node = define(node, "w_base", [scale] { return scale; });
 
     if (is_mc) {
-        node = node.Define(
+        node = define(node,
             "w_nominal",
-            [](float w, float w_spline, float w_tune) {
-                const float out = w * w_spline * w_tune;
+            [](double w, float w_spline, float w_tune) {
+                const double out = w * w_spline * w_tune;
                 if (!std::isfinite(out))
-                    return 0.0f;
-                if (out < 0.0f)
-                    return 0.0f;
+                    return 0.0;
+                if (out < 0.0)
+                    return 0.0;
                 return out;
             },
             {"w_base", "weightSpline", "weightTune"});
     } else {
-        node = node.Define("w_nominal", [](float w) { return w; }, {"w_base"});
+        node = define(node, "w_nominal", [](double w) { return w; }, {"w_base"});
     }
 
     {
@@ -87,7 +105,7 @@ ROOT::RDF::RNode rarexsec::Processor::run(ROOT::RDF::RNode node,
 
         if (!has("ml_u")) {
             if (have_rse) {
-                node = node.Define(
+                node = define(node,
                     "ml_u",
                     [](int run, int sub, int evt) {
                         const auto h = training_hash(static_cast<std::uint32_t>(run),
@@ -97,12 +115,12 @@ ROOT::RDF::RNode rarexsec::Processor::run(ROOT::RDF::RNode node,
                     },
                     {col_run, col_sub, col_evt});
             } else {
-                node = node.Define("ml_u", [] { return 0.0f; });
+                node = define(node, "ml_u", [] { return 0.0f; });
             }
         }
 
         if (!has("is_training")) {
-            node = node.Define(
+            node = define(node,
                 "is_training",
                 [trainable, have_rse](float u) {
                     if (!trainable || !have_rse) return false;
@@ -112,20 +130,20 @@ ROOT::RDF::RNode rarexsec::Processor::run(ROOT::RDF::RNode node,
         }
 
         if (!has("is_template")) {
-            node = node.Define(
+            node = define(node,
                 "is_template",
                 [trainable](bool t) { return !trainable || !t; },
                 {"is_training"});
         }
 
         if (!has("w_template")) {
-            node = node.Define(
+            node = define(node,
                 "w_template",
-                [trainable, have_rse](float w, bool t) {
+                [trainable, have_rse](double w, bool t) {
                     if (!trainable || !have_rse) return w;
-                    if (t) return 0.0f;
-                    const float keep = 1.0f - kTrainingFraction;
-                    if (keep <= 0.0f) return 0.0f;
+                    if (t) return 0.0;
+                    const double keep = 1.0 - kTrainingFraction;
+                    if (keep <= 0.0) return 0.0;
                     return w / keep;
                 },
                 {"w_nominal", "is_training"});
@@ -133,26 +151,33 @@ ROOT::RDF::RNode rarexsec::Processor::run(ROOT::RDF::RNode node,
     }
 
     if (is_mc) {
-        node = node.Define(
+        node = define(node,
             "in_fiducial",
             [](float x, float y, float z) {
                 return rarexsec::fiducial::is_in_truth_volume(x, y, z);
             },
             {"nu_vtx_x", "nu_vtx_y", "nu_vtx_z"});
 
-        node = node.Define(
+        node = define(node,
             "count_strange",
             [](int kplus, int kminus, int kzero, int lambda0, int sigplus, int sigzero, int sigminus) {
                 return kplus + kminus + kzero + lambda0 + sigplus + sigzero + sigminus;
             },
             {"n_K_plus", "n_K_minus", "n_K0", "n_lambda", "n_sigma_plus", "n_sigma0", "n_sigma_minus"});
 
-        node = node.Define(
+        node = define(node,
             "is_strange",
             [](int strange) { return strange > 0; },
             {"count_strange"});
 
-        node = node.Define(
+        // recipe truth filters count strange hadrons as mc_n_strange
+        {
+            const auto cnames = node.GetColumnNames();
+            if (std::find(cnames.begin(), cnames.end(), "mc_n_strange") == cnames.end())
+                node = define(node, "mc_n_strange", [](int strange) { return strange; }, {"count_strange"});
+        }
+
+        node = define(node,
             "scattering_mode",
             [](int mode) {
                 switch (mode) {
@@ -172,7 +197,7 @@ ROOT::RDF::RNode rarexsec::Processor::run(ROOT::RDF::RNode node,
             },
             {"int_mode"});
 
-        node = node.Define(
+        node = define(node,
             "analysis_channels",
             [](bool fv, int nu, int ccnc, int s, int np, int npim, int npip, int npi0, int ngamma) {
                 const int npi = npim + npip;
@@ -206,7 +231,7 @@ ROOT::RDF::RNode rarexsec::Processor::run(ROOT::RDF::RNode node,
             {"in_fiducial", "nu_pdg", "int_ccnc", "count_strange",
              "n_p", "n_pi_minus", "n_pi_plus", "n_pi0", "n_gamma"});
 
-        node = node.Define(
+        node = define(node,
             "is_signal",
             [](bool is_nu_mu_cc, const ROOT::RVec<int>& lambda_decay_in_fid) {
                 if (!is_nu_mu_cc) return false;
@@ -216,7 +241,7 @@ ROOT::RDF::RNode rarexsec::Processor::run(ROOT::RDF::RNode node,
             },
             {"is_nu_mu_cc", "lambda_decay_in_fid"});
 
-        node = node.Define(
+        node = define(node,
             "recognised_signal",
             [](bool is_sig, float purity, float completeness) {
                 return is_sig && purity > static_cast<float>(kRecognisedPurityMin) &&
@@ -227,15 +252,20 @@ ROOT::RDF::RNode rarexsec::Processor::run(ROOT::RDF::RNode node,
         const int nonmc_channel =
             is_ext ? static_cast<int>(Channel::External) : (is_data ? static_cast<int>(Channel::DataInclusive) : static_cast<int>(Channel::Unknown));
 
-        node = node.Define("in_fiducial", [] { return false; });
-        node = node.Define("is_strange", [] { return false; });
-        node = node.Define("scattering_mode", [] { return -1; });
-        node = node.Define("analysis_channels", [nonmc_channel] { return nonmc_channel; });
-        node = node.Define("is_signal", [] { return false; });
-        node = node.Define("recognised_signal", [] { return false; });
+        node = define(node, "in_fiducial", [] { return false; });
+        node = define(node, "is_strange", [] { return false; });
+        {
+            const auto cnames = node.GetColumnNames();
+            if (std::find(cnames.begin(), cnames.end(), "mc_n_strange") == cnames.end())
+                node = define(node, "mc_n_strange", [] { return 0; });
+        }
+        node = define(node, "scattering_mode", [] { return -1; });
+        node = define(node, "analysis_channels", [nonmc_channel] { return nonmc_channel; });
+        node = define(node, "is_signal", [] { return false; });
+        node = define(node, "recognised_signal", [] { return false; });
     }
 
-    node = node.Define(
+    node = define(node,
         "in_reco_fiducial",
         [](float x, float y, float z) {
             return rarexsec::fiducial::is_in_reco_volume(x, y, z);
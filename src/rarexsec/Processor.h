@@ -6,7 +6,15 @@ namespace rarexsec {
 
 class Processor {
   public:
+    // Bump whenever run() changes a column that selections read; persisted entry indices are
+    // keyed on it.
+    static constexpr unsigned version = 2;
+
     ROOT::RDF::RNode run(ROOT::RDF::RNode node, const rarexsec::Entry& rec) const;
+
+    // Factor w_base applies for the sample's exposure: pot_nom / pot_eqv for simulation,
+    // trig_nom / trig_eqv for EXT, 1 otherwise or when either side is unset.
+    static double exposure_scale(const rarexsec::Entry& rec);
 };
 
 const Processor& processor();
@@ -0,0 +1,62 @@
+#include "rarexsec/Requests.h"
+#include "rarexsec/plot/Channels.h"
+
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+//____________________________________________________________________________
+std::vector<std::string> rarexsec::request::periods(const json& req, const Env& env)
+{
+    if (!req.contains("periods"))
+        return env.periods;
+    return req.at("periods").get<std::vector<std::string>>();
+}
+//____________________________________________________________________________
+rarexsec::selection::Preset rarexsec::request::preset(const json& req, const char* key, const char* fallback)
+{
+    return selection::preset_from_name(req.value(key, std::string(fallback)));
+}
+//____________________________________________________________________________
+rarexsec::plot::TH1DModel rarexsec::request::plot_spec(const json& req)
+{
+    plot::TH1DModel spec;
+    spec.id = req.at("id").get<std::string>();
+    spec.name = req.value("name", std::string());
+    spec.title = req.value("title", std::string());
+    spec.expr = req.value("expr", std::string());
+    spec.weight = req.value("weight", spec.weight);
+    spec.nbins = req.value("nbins", spec.nbins);
+    spec.xmin = req.value("xmin", spec.xmin);
+    spec.xmax = req.value("xmax", spec.xmax);
+    spec.sel = preset(req, "sel", selection::preset_name(spec.sel));
+    return spec;
+}
+//____________________________________________________________________________
+rarexsec::plot::Options rarexsec::request::plot_options(const json& req, const Env& env)
+{
+    plot::Options opt;
+    opt.out_dir = req.value("out_dir", opt.out_dir);
+    opt.image_format = req.value("format", opt.image_format);
+    opt.use_log_y = req.value("log_y", opt.use_log_y);
+    opt.show_ratio = req.value("ratio", opt.show_ratio);
+    opt.legend_on_top = req.value("legend_on_top", opt.legend_on_top);
+    opt.analysis_region_label = req.value("region", std::string());
+    opt.beamline = req.value("beamline", env.beamline);
+    opt.periods = periods(req, env);
+    opt.signal_channels = plot::Channels::signal_keys();
+    return opt;
+}
+//____________________________________________________________________________
+rarexsec::systpack::Config rarexsec::request::systematics_config(const json& req)
+{
+    systpack::Config cfg;
+    cfg.include_ext = req.value("include_ext", cfg.include_ext);
+    cfg.use_ppfx = req.value("ppfx", cfg.use_ppfx);
+    cfg.use_genie = req.value("genie", cfg.use_genie);
+    cfg.use_reint = req.value("reint", cfg.use_reint);
+    cfg.N_ppfx = req.value("n_ppfx", cfg.N_ppfx);
+    cfg.N_genie = req.value("n_genie", cfg.N_genie);
+    cfg.N_reint = req.value("n_reint", cfg.N_reint);
+    return cfg;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "rarexsec/plot/Descriptors.h"
+#include "rarexsec/proc/Env.h"
+#include "rarexsec/syst/SystematicsPack.h"
+
+#include <nlohmann/json_fwd.hpp>
+#include <string>
+#include <vector>
+
+namespace rarexsec {
+
+// Fields shared by the daemon's requests (see Service) and the entries of a recipe's analysis
+// block (see Runner), so that a plot or covariance is spelt the same way in both. Missing fields
+// keep the defaults of the structures they fill; beamline and periods default to the environment's.
+namespace request {
+
+std::vector<std::string> periods(const nlohmann::json& req, const Env& env);
+selection::Preset preset(const nlohmann::json& req, const char* key, const char* fallback);
+
+// id, name, title, expr, weight, nbins, xmin, xmax and sel
+plot::TH1DModel plot_spec(const nlohmann::json& req);
+// out_dir, format, log_y, ratio, legend_on_top, region, beamline and periods
+plot::Options plot_options(const nlohmann::json& req, const Env& env);
+// include_ext, ppfx, genie, reint, n_ppfx, n_genie and n_reint
+systpack::Config systematics_config(const nlohmann::json& req);
+
+}
+}
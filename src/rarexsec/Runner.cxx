@@ -0,0 +1,432 @@
+#include "rarexsec/Runner.h"
+#include "rarexsec/Requests.h"
+#include "rarexsec/exec/Plan.h"
+#include "rarexsec/fit/Fitter.h"
+#include "rarexsec/plot/Plotter.h"
+#include "rarexsec/plot/RenderQueue.h"
+#include "rarexsec/plot/StackedHist.h"
+#include "rarexsec/plot/UnstackedHist.h"
+#include "rarexsec/proc/Selection.h"
+#include "rarexsec/proc/Snapshot.h"
+#include "rarexsec/syst/SystematicsPack.h"
+
+#include <ROOT/RDataFrame.hxx>
+#include <ROOT/RSnapshotOptions.hxx>
+#include <TFile.h>
+#include <TH1D.h>
+#include <TMatrixDSym.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+using json = nlohmann::json;
+
+namespace {
+
+using Entries = std::vector<const rarexsec::Entry*>;
+using SnapshotResult = ROOT::RDF::RResultPtr<ROOT::RDF::RInterface<ROOT::Detail::RDF::RLoopManager>>;
+
+std::string as_double(const std::string& weight) { return "static_cast<double>(" + weight + ")"; }
+
+std::string name_of(const json& spec, const char* what, std::size_t i)
+{
+    if (spec.contains("name"))
+        return spec.at("name").get<std::string>();
+    if (spec.contains("id"))
+        return spec.at("id").get<std::string>();
+    return std::string(what) + "_" + std::to_string(i);
+}
+
+const json& list(const json& analysis, const char* key)
+{
+    static const json empty = json::array();
+    if (!analysis.contains(key))
+        return empty;
+    const json& out = analysis.at(key);
+    if (!out.is_array())
+        throw std::invalid_argument(std::string("analysis.") + key + " must be an array");
+    return out;
+}
+
+// Universe weights only depend on these, not on the variable or binning.
+std::string universe_key(const rarexsec::systpack::Config& cfg)
+{
+    std::ostringstream os;
+    os << std::hexfloat << cfg.ushort_scale;
+    if (cfg.use_ppfx)
+        os << "/ppfx:" << cfg.N_ppfx << ':' << cfg.ppfx_branch << ':' << cfg.ppfx_cv_branch;
+    if (cfg.use_genie)
+        os << "/genie:" << cfg.N_genie << ':' << cfg.genie_branch << ':' << cfg.genie_cv_branch;
+    if (cfg.use_reint)
+        os << "/reint:" << cfg.N_reint << ':' << cfg.reint_branch;
+    return os.str();
+}
+
+struct CutflowJob {
+    std::string name;
+    rarexsec::selection::Preset preset;
+    std::string weight;
+    Entries mc;
+    // one per sample, aligned with mc: the selection of a sample is shared by every output, so
+    // counts are kept per sample and summed over each job's own samples
+    std::vector<std::shared_ptr<rarexsec::selection::Cutflow>> flows;
+    std::vector<ROOT::RDF::RResultPtr<double>> all, sel;
+};
+
+struct SnapshotJob {
+    std::string name;
+    rarexsec::selection::Preset preset;
+    rarexsec::snapshot::Options opt;
+    Entries samples;
+    std::vector<std::pair<std::string, SnapshotResult>> files;
+};
+
+struct SystematicsJob {
+    std::string name, expr, weight, out;
+    rarexsec::selection::Preset preset;
+    std::unique_ptr<TH1D> model;
+    rarexsec::systpack::Config cfg;
+    Entries mc, ext;
+    // the samples as SystematicsPack sees them: plan nodes with the universe weights defined
+    std::vector<rarexsec::Entry> store;
+    rarexsec::systpack::SystematicsPack::Booking booking;
+    std::shared_ptr<TMatrixDSym> total = std::make_shared<TMatrixDSym>();
+};
+
+}
+
+struct rarexsec::Runner::Job {
+    std::vector<std::unique_ptr<plot::StackedHist>> stacked;
+    std::vector<std::unique_ptr<plot::UnstackedHist>> unstacked;
+    std::vector<std::string> formats_stacked, formats_unstacked;
+    std::vector<CutflowJob> cutflows;
+    std::vector<SnapshotJob> snapshots;
+    std::vector<SystematicsJob> systematics;
+};
+
+//____________________________________________________________________________
+rarexsec::Runner::Runner(Env env, const json& analysis, Options opt)
+    : env_(std::move(env)), opt_(opt), analysis_(std::make_unique<json>(analysis))
+{
+    if (!analysis_->is_object())
+        throw std::invalid_argument("Runner: the analysis block must be an object");
+}
+//____________________________________________________________________________
+rarexsec::Runner::~Runner() = default;
+//____________________________________________________________________________
+json rarexsec::Runner::run()
+{
+    const json& analysis = *analysis_;
+    const std::string out_dir = analysis.value("out_dir", std::string("rarexsec-out"));
+    std::filesystem::create_directories(out_dir);
+
+    Hub hub = env_.make_hub();
+    auto simulation = [&](const json& spec) {
+        return hub.simulation_entries(spec.value("beamline", env_.beamline), request::periods(spec, env_));
+    };
+    auto data = [&](const json& spec) {
+        return hub.data_entries(spec.value("beamline", env_.beamline), request::periods(spec, env_));
+    };
+
+    exec::Plan plan;
+    Job job;
+
+    // Declaration: every job names its samples and the expressions it reads, so the plan can
+    // define each of them once per sample ahead of the shared selections.
+    std::map<std::string, std::shared_ptr<TMatrixDSym>> covariances;
+    const json& systematics = list(analysis, "systematics");
+    job.systematics.reserve(systematics.size());
+    for (std::size_t i = 0; i < systematics.size(); ++i) {
+        const json& spec = systematics[i];
+        SystematicsJob s;
+        s.name = name_of(spec, "systematics", i);
+        s.expr = spec.at("expr").get<std::string>();
+        s.weight = as_double(spec.value("weight", std::string("w_nominal")));
+        s.out = spec.value("out", out_dir + "/systematics/" + plot::Plotter::sanitise(s.name) + ".root");
+        s.preset = request::preset(spec, "sel", "InclusiveMuCC");
+        s.model = std::make_unique<TH1D>(plot::Plotter::sanitise(s.name).c_str(), s.expr.c_str(),
+                                         spec.value("nbins", 1), spec.value("xmin", 0.0), spec.value("xmax", 1.0));
+        s.model->SetDirectory(nullptr);
+        s.cfg = request::systematics_config(spec);
+        for (const Entry* rec : simulation(spec))
+            if (rec)
+                s.mc.push_back(rec);
+        if (s.cfg.include_ext)
+            for (const Entry* rec : data(spec))
+                if (rec && rec->source == Source::Ext)
+                    s.ext.push_back(rec);
+        for (const auto* samples : {&s.mc, &s.ext}) {
+            for (const Entry* rec : *samples) {
+                plan.declare(*rec, s.expr);
+                plan.declare(*rec, s.weight);
+            }
+        }
+        if (!covariances.emplace(s.name, s.total).second)
+            throw std::invalid_argument("Runner: systematics '" + s.name + "' given twice");
+        job.systematics.push_back(std::move(s));
+    }
+
+    std::map<std::pair<const Entry*, selection::Preset>, std::shared_ptr<selection::Cutflow>> flows;
+    for (const json& spec : list(analysis, "cutflows")) {
+        CutflowJob c;
+        c.name = name_of(spec, "cutflow", job.cutflows.size());
+        c.preset = request::preset(spec, "preset", "InclusiveMuCC");
+        c.weight = as_double(spec.value("weight", std::string("w_nominal")));
+        for (const Entry* rec : simulation(spec)) {
+            if (!rec)
+                continue;
+            auto& flow = flows[{rec, c.preset}];
+            if (!flow)
+                flow = std::make_shared<selection::Cutflow>();
+            c.mc.push_back(rec);
+            c.flows.push_back(flow);
+            plan.declare(*rec, c.weight);
+            plan.declare_cutflow(*rec, c.preset, flow);
+        }
+        job.cutflows.push_back(std::move(c));
+    }
+
+    for (const json& spec : list(analysis, "snapshots")) {
+        SnapshotJob s;
+        s.name = name_of(spec, "snapshot", job.snapshots.size());
+        s.preset = request::preset(spec, "preset", "InclusiveMuCC");
+        s.opt.outdir = spec.value("out_dir", out_dir + "/snapshots/" + plot::Plotter::sanitise(s.name));
+        s.opt.tree = spec.value("tree", s.opt.tree);
+        s.opt.columns = spec.value("columns", std::vector<std::string>{});
+        const std::string which = spec.value("samples", std::string("all"));
+        if (which != "mc" && which != "data" && which != "all")
+            throw std::invalid_argument("Runner: snapshot '" + s.name + "': samples must be mc, data or all");
+        if (which != "data")
+            s.samples = simulation(spec);
+        if (which != "mc") {
+            const auto d = data(spec);
+            s.samples.insert(s.samples.end(), d.begin(), d.end());
+        }
+        job.snapshots.push_back(std::move(s));
+    }
+
+    plot::Plotter style;
+    style.set_global_style();
+    for (const json& spec : list(analysis, "plots")) {
+        plot::TH1DModel model = request::plot_spec(spec);
+        json with_dir = spec;
+        if (!spec.contains("out_dir"))
+            with_dir["out_dir"] = out_dir + "/plots";
+        plot::Options popt = request::plot_options(with_dir, env_);
+        if (spec.contains("cov")) {
+            const std::string cov = spec.at("cov").get<std::string>();
+            auto it = covariances.find(cov);
+            if (it == covariances.end())
+                throw std::invalid_argument("Runner: plot '" + model.id + "' names unknown systematics '" + cov + "'");
+            // filled after the pass, before the plot is built
+            popt.total_cov = it->second;
+        }
+        const Entries mc = simulation(spec);
+        const Entries d = spec.value("data", true) ? data(spec) : Entries{};
+        const std::string fmt = popt.image_format;
+        if (spec.value("unstacked", false)) {
+            job.unstacked.push_back(std::make_unique<plot::UnstackedHist>(model, popt, mc, d,
+                                                                          spec.value("normalise", true),
+                                                                          spec.value("line_width", 3)));
+            job.unstacked.back()->declare(plan);
+            job.formats_unstacked.push_back(fmt);
+        } else {
+            job.stacked.push_back(std::make_unique<plot::StackedHist>(model, popt, mc, d));
+            job.stacked.back()->declare(plan);
+            job.formats_stacked.push_back(fmt);
+        }
+    }
+
+    // Booking: everything hangs off the plan's shared nodes; nothing has run yet.
+    for (auto& p : job.stacked)
+        p->book(plan);
+    for (auto& p : job.unstacked)
+        p->book(plan);
+
+    for (auto& c : job.cutflows) {
+        for (const Entry* rec : c.mc) {
+            const std::string w = plan.column(*rec, c.weight);
+            c.all.push_back(plan.node(*rec).Sum<double>(w));
+            c.sel.push_back(plan.node(*rec, c.preset).Sum<double>(w));
+        }
+    }
+
+    for (auto& s : job.snapshots) {
+        for (const Entry* rec : s.samples) {
+            if (!rec)
+                continue;
+            auto node = plan.node(*rec, s.preset);
+            const auto cols = snapshot::intersect_cols(node, s.opt.columns);
+            io::branch_usage().request(cols);
+            std::string file = snapshot::make_out_path(s.opt, *rec, "");
+            if (std::filesystem::path(file).extension() != ".root")
+                file += ".root";
+            ROOT::RDF::RSnapshotOptions sopt;
+            sopt.fLazy = true;
+            sopt.fMode = "RECREATE";
+            s.files.emplace_back(file, node.Snapshot(snapshot::make_tree_name(s.opt, *rec, ""), file, cols, sopt));
+        }
+    }
+
+    std::map<std::tuple<const Entry*, selection::Preset, std::string, std::string>, ROOT::RDF::RNode> universes;
+    for (auto& s : job.systematics) {
+        if (s.mc.empty())
+            throw std::runtime_error("Runner: systematics '" + s.name + "' has no simulation samples");
+        s.cfg.value_col = plan.column(*s.mc.front(), s.expr);
+        s.cfg.weight_col = plan.column(*s.mc.front(), s.weight);
+        const systpack::SystematicsPack pack(s.cfg);
+        const std::string ukey = universe_key(s.cfg);
+        s.store.reserve(s.mc.size() + s.ext.size());
+        Entries mc, ext;
+        for (const auto* samples : {&s.mc, &s.ext}) {
+            for (const Entry* rec : *samples) {
+                if (plan.column(*rec, s.expr) != s.cfg.value_col || plan.column(*rec, s.weight) != s.cfg.weight_col)
+                    throw std::runtime_error("Runner: systematics '" + s.name + "' reads different columns in different samples");
+                Entry e = *rec;
+                if (samples == &s.mc) {
+                    const auto key = std::make_tuple(rec, s.preset, s.cfg.weight_col, ukey);
+                    auto it = universes.find(key);
+                    if (it == universes.end())
+                        it = universes.emplace(key, pack.define_universes(plan.node(*rec, s.preset))).first;
+                    e.nominal.node = it->second;
+                } else {
+                    e.nominal.node = plan.node(*rec, s.preset);
+                }
+                s.store.push_back(std::move(e));
+                (samples == &s.mc ? mc : ext).push_back(&s.store.back());
+            }
+        }
+        s.booking = pack.book(*s.model, mc, ext);
+    }
+
+    json report;
+    report["out_dir"] = out_dir;
+    auto stats = [&] {
+        const auto st = plan.stats();
+        return json{{"samples", st.samples}, {"defines", st.defines},        {"filters", st.filters},
+                    {"universe_nodes", universes.size()}, {"event_loops", st.loops}, {"entries", st.entries}};
+    };
+    if (opt_.dry_run) {
+        report["plan"] = stats();
+        report["dry_run"] = true;
+        return report;
+    }
+
+    plan.run();
+    report["plan"] = stats();
+
+    json out_syst = json::array();
+    for (auto& s : job.systematics) {
+        const auto result = systpack::SystematicsPack(s.cfg).finish(*s.model, s.booking);
+        s.total->ResizeTo(result.total);
+        *s.total = result.total;
+        const std::filesystem::path parent = std::filesystem::path(s.out).parent_path();
+        if (!parent.empty())
+            std::filesystem::create_directories(parent);
+        std::unique_ptr<TFile> f(TFile::Open(s.out.c_str(), "RECREATE"));
+        if (!f || f->IsZombie())
+            throw std::runtime_error("cannot write " + s.out);
+        result.H_pred->Write("H_pred");
+        result.total.Write("total");
+        json sources = json::array();
+        for (const auto& [name, cov] : result.sources) {
+            cov.Write(plot::Plotter::sanitise(name).c_str());
+            sources.push_back(name);
+        }
+        f->Close();
+        out_syst.push_back({{"name", s.name}, {"file", s.out}, {"sources", sources}});
+    }
+    report["systematics"] = out_syst;
+
+    json out_cutflows = json::array();
+    for (auto& c : job.cutflows) {
+        double w_all = 0.0, w_sel = 0.0;
+        for (auto& r : c.all)
+            w_all += r.GetValue();
+        for (auto& r : c.sel)
+            w_sel += r.GetValue();
+        std::uint64_t entered = 0;
+        std::vector<std::string> names;
+        std::vector<std::uint64_t> passed;
+        for (const auto& flow : c.flows) {
+            if (flow->names().empty())
+                continue;
+            if (names.empty()) {
+                names = flow->names();
+                passed.assign(names.size(), 0);
+            }
+            entered += flow->entered();
+            for (std::size_t i = 0; i < names.size(); ++i)
+                passed[i] += flow->passed(i);
+        }
+        json atoms = json::array();
+        for (std::size_t i = 0; i < names.size(); ++i)
+            atoms.push_back({{"name", names[i]}, {"passed", passed[i]}});
+        out_cutflows.push_back({{"name", c.name},
+                                {"preset", selection::preset_name(c.preset)},
+                                {"weight_all", w_all},
+                                {"weight_selected", w_sel},
+                                {"entered", entered},
+                                {"atoms", atoms}});
+    }
+    report["cutflows"] = out_cutflows;
+
+    json out_snapshots = json::array();
+    for (auto& s : job.snapshots) {
+        json files = json::array();
+        for (auto& [file, result] : s.files) {
+            result.GetValue();
+            files.push_back(file);
+        }
+        out_snapshots.push_back({{"name", s.name}, {"files", files}});
+    }
+    report["snapshots"] = out_snapshots;
+
+    // filled already: the queue only reads the histograms back and draws
+    plot::RenderQueue queue(opt_.render_workers);
+    for (std::size_t i = 0; i < job.stacked.size(); ++i)
+        queue.add(std::move(job.stacked[i]), job.formats_stacked[i]);
+    for (std::size_t i = 0; i < job.unstacked.size(); ++i)
+        queue.add(std::move(job.unstacked[i]), job.formats_unstacked[i]);
+    json out_plots = json::array();
+    for (const auto& r : queue.run()) {
+        json p{{"id", r.id}, {"file", r.file}, {"ok", r.ok}};
+        if (!r.ok)
+            p["error"] = r.error;
+        out_plots.push_back(p);
+    }
+    report["plots"] = out_plots;
+
+    json out_fits = json::array();
+    const json& fits = list(analysis, "fits");
+    for (std::size_t i = 0; i < fits.size(); ++i) {
+        const json& spec = fits[i];
+        const std::string path = spec.at("workspace").get<std::string>();
+        auto fitter = internal::fit::Fitter::load_workspace(path);
+        const auto r = fitter.fit(spec.value("minimizer", std::string("Minuit2")), spec.value("algo", std::string("Migrad")));
+        out_fits.push_back({{"name", name_of(spec, "fit", i)},
+                            {"workspace", path},
+                            {"status", r.status},
+                            {"nll", r.nll},
+                            {"mu", r.mu},
+                            {"mu_err", r.mu_err_sym},
+                            {"poi_names", r.poi_names},
+                            {"poi_values", r.poi_values},
+                            {"poi_errors", r.poi_errors},
+                            {"nuisances", r.nuis_values},
+                            {"nuisance_errors", r.nuis_errors},
+                            {"cross_section_pb", fitter.cross_section_pb(r)}});
+    }
+    report["fits"] = out_fits;
+
+    std::ofstream(out_dir + "/report.json") << report.dump(2) << '\n';
+    return report;
+}
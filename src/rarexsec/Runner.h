@@ -0,0 +1,47 @@
+#pragma once
+
+#include "rarexsec/proc/Env.h"
+
+#include <memory>
+#include <nlohmann/json_fwd.hpp>
+#include <string>
+
+namespace rarexsec {
+
+// Runs the "analysis" block of a recipe in one go:
+//   plots        stacked (or "unstacked") histograms by channel, with the keys of the daemon's
+//                plot requests; "cov" names a systematics entry whose total covariance is drawn
+//   cutflows     weighted yields and per-atom counts of a preset over the simulation
+//   snapshots    columns of the selected events, one file per sample
+//   systematics  SystematicsPack covariances, with the keys of the daemon's covariance requests
+//   fits         fits of workspaces from Fitter::save_workspace
+// Everything that reads events is booked on one exec::Plan: the samples are selected, split by
+// channel and given each distinct expression once, universe weights are defined once per
+// (sample, selection, weight, systematics setup), and run() reads every sample a single time.
+// Plots are then drawn in a RenderQueue and the fits follow. Outputs go under "out_dir" (default
+// "rarexsec-out"), and run() returns, and writes there as report.json, a summary naming them.
+class Runner {
+  public:
+    struct Options {
+        // RenderQueue workers; 0 takes the hardware concurrency.
+        unsigned render_workers = 0;
+        // Plan and report what would be booked without reading any events.
+        bool dry_run = false;
+    };
+
+    Runner(Env env, const nlohmann::json& analysis, Options opt);
+    ~Runner();
+    Runner(const Runner&) = delete;
+    Runner& operator=(const Runner&) = delete;
+
+    nlohmann::json run();
+
+  private:
+    struct Job;
+
+    Env env_;
+    Options opt_;
+    std::unique_ptr<nlohmann::json> analysis_;
+};
+
+}
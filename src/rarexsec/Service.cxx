@@ -0,0 +1,266 @@
+#include "rarexsec/Service.h"
+#include "rarexsec/Requests.h"
+#include "rarexsec/fit/Fitter.h"
+#include "rarexsec/io/EntryIndex.h"
+#include "rarexsec/plot/Plotter.h"
+#include "rarexsec/plot/StackedHist.h"
+#include "rarexsec/proc/Selection.h"
+#include "rarexsec/syst/SystematicsPack.h"
+
+#include <ROOT/RDataFrame.hxx>
+#include <TFile.h>
+#include <TH1D.h>
+
+#include <exception>
+#include <filesystem>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+struct rarexsec::Service::Workspace {
+    io::FileStamp stamp;
+    std::unique_ptr<internal::fit::Fitter> fitter;
+};
+
+namespace {
+
+// Cached replies naming files are only reused while those files are there.
+bool outputs_exist(const std::string& reply)
+{
+    const json j = json::parse(reply);
+    if (j.contains("file") && !std::filesystem::exists(j["file"].get<std::string>()))
+        return false;
+    if (j.contains("files")) {
+        for (const auto& f : j["files"])
+            if (!std::filesystem::exists(f.get<std::string>()))
+                return false;
+    }
+    return true;
+}
+
+}
+
+//____________________________________________________________________________
+rarexsec::Service::Service(Env env) : env_(std::move(env)), hub_(std::make_unique<Hub>(env_.make_hub())) {}
+//____________________________________________________________________________
+rarexsec::Service::~Service() = default;
+//____________________________________________________________________________
+std::string rarexsec::Service::handle(const std::string& request)
+{
+    ++requests_;
+    json req;
+    try {
+        req = json::parse(request);
+        if (!req.is_object())
+            throw std::invalid_argument("request must be a JSON object");
+    } catch (const std::exception& e) {
+        return json{{"ok", false}, {"error", std::string("bad request: ") + e.what()}}.dump();
+    }
+
+    const bool cacheable = !req.value("nocache", false);
+    req.erase("nocache");
+    std::string key = req.dump();
+    if (req.contains("workspace") && req["workspace"].is_string()) {
+        if (const auto st = io::stamp(req["workspace"].get<std::string>()))
+            key += " " + std::to_string(st->size) + " " + std::to_string(st->mtime_ns);
+    }
+    if (cacheable) {
+        auto it = replies_.find(key);
+        if (it != replies_.end() && outputs_exist(it->second)) {
+            ++hits_;
+            return it->second;
+        }
+    }
+    json reply;
+    try {
+        reply = dispatch(req);
+        reply["ok"] = true;
+    } catch (const std::exception& e) {
+        return json{{"ok", false}, {"error", e.what()}}.dump();
+    }
+    std::string text = reply.dump();
+    const std::string op = req.value("op", "");
+    if (op == "plot" || op == "cutflow" || op == "covariance" || op == "fit")
+        replies_[key] = text;
+    return text;
+}
+//____________________________________________________________________________
+json rarexsec::Service::dispatch(const json& req)
+{
+    const std::string op = req.value("op", "");
+    if (op == "plot")
+        return plot(req);
+    if (op == "cutflow")
+        return cutflow(req);
+    if (op == "covariance")
+        return covariance(req);
+    if (op == "fit")
+        return fit(req);
+    if (op == "ping")
+        return json::object();
+    if (op == "stats")
+        return stats();
+    if (op == "flush") {
+        replies_.clear();
+        workspaces_.clear();
+        return json::object();
+    }
+    if (op == "reload") {
+        replies_.clear();
+        hub_ = std::make_unique<Hub>(env_.make_hub());
+        return json::object();
+    }
+    if (op == "shutdown") {
+        stop_ = true;
+        return json::object();
+    }
+    throw std::invalid_argument("unknown op '" + op + "'");
+}
+//____________________________________________________________________________
+std::vector<const rarexsec::Entry*> rarexsec::Service::simulation(const json& req) const
+{
+    return hub_->simulation_entries(req.value("beamline", env_.beamline), request::periods(req, env_));
+}
+//____________________________________________________________________________
+std::vector<const rarexsec::Entry*> rarexsec::Service::data(const json& req) const
+{
+    return hub_->data_entries(req.value("beamline", env_.beamline), request::periods(req, env_));
+}
+//____________________________________________________________________________
+json rarexsec::Service::plot(const json& req)
+{
+    const plot::TH1DModel spec = request::plot_spec(req);
+    const plot::Options opt = request::plot_options(req, env_);
+
+    plot::Plotter(opt).set_global_style();
+    // the reply names the file the plot writes, as RenderQueue does
+    plot::StackedHist hist(spec, opt, simulation(req),
+                           req.value("data", true) ? data(req) : std::vector<const Entry*>{});
+    const std::string path = hist.output_path(opt.image_format);
+    hist.draw_and_save(opt.image_format);
+    return json{{"files", json::array({path})}};
+}
+//____________________________________________________________________________
+json rarexsec::Service::cutflow(const json& req)
+{
+    const auto preset = request::preset(req, "preset", "InclusiveMuCC");
+    const std::string weight = req.value("weight", std::string("w_nominal"));
+    auto flow = std::make_shared<selection::Cutflow>();
+
+    std::vector<ROOT::RDF::RResultPtr<double>> all, sel;
+    for (const Entry* rec : simulation(req)) {
+        if (!rec)
+            continue;
+        auto node = rec->rnode();
+        all.push_back(node.Sum(weight));
+        sel.push_back(selection::apply(node, preset, *rec, flow).Sum(weight));
+    }
+    double w_all = 0.0, w_sel = 0.0;
+    for (auto& r : all)
+        w_all += r.GetValue();
+    for (auto& r : sel)
+        w_sel += r.GetValue();
+
+    json atoms = json::array();
+    for (std::size_t i = 0; i < flow->names().size(); ++i)
+        atoms.push_back({{"name", flow->names()[i]}, {"passed", flow->passed(i)}});
+    return json{{"preset", selection::preset_name(preset)},
+                {"weight_all", w_all},
+                {"weight_selected", w_sel},
+                {"entered", flow->entered()},
+                {"atoms", atoms}};
+}
+//____________________________________________________________________________
+json rarexsec::Service::covariance(const json& req)
+{
+    const std::string expr = req.at("expr").get<std::string>();
+    const std::string out = req.at("out").get<std::string>();
+    const auto preset = request::preset(req, "sel", "InclusiveMuCC");
+    const std::string weight = req.value("weight", std::string("w_nominal"));
+
+    systpack::Config cfg = request::systematics_config(req);
+    cfg.value_col = "_rx_cov_x";
+    cfg.weight_col = "_rx_cov_w";
+
+    // selected copies of the samples with the value and a double weight defined on them
+    auto prepare = [&](const std::vector<const Entry*>& in, std::vector<Entry>& store) {
+        store.reserve(in.size());
+        std::vector<const Entry*> view;
+        for (const Entry* rec : in) {
+            if (!rec)
+                continue;
+            Entry e = *rec;
+            e.nominal.node = selection::apply(rec->rnode(), preset, *rec)
+                                 .Define(cfg.value_col, expr)
+                                 .Define(cfg.weight_col, "static_cast<double>(" + weight + ")");
+            store.push_back(std::move(e));
+            view.push_back(&store.back());
+        }
+        return view;
+    };
+    std::vector<Entry> mc_store, ext_store;
+    const auto mc = prepare(simulation(req), mc_store);
+    std::vector<const Entry*> ext;
+    if (cfg.include_ext) {
+        std::vector<const Entry*> ext_in;
+        for (const Entry* rec : data(req))
+            if (rec && rec->source == Source::Ext)
+                ext_in.push_back(rec);
+        ext = prepare(ext_in, ext_store);
+    }
+
+    const TH1D model("cov", expr.c_str(), req.value("nbins", 1), req.value("xmin", 0.0), req.value("xmax", 1.0));
+    const auto result = systpack::SystematicsPack(cfg).build(model, mc, ext);
+
+    const std::filesystem::path parent = std::filesystem::path(out).parent_path();
+    if (!parent.empty())
+        std::filesystem::create_directories(parent);
+    std::unique_ptr<TFile> f(TFile::Open(out.c_str(), "RECREATE"));
+    if (!f || f->IsZombie())
+        throw std::runtime_error("cannot write " + out);
+    result.H_pred->Write("H_pred");
+    result.total.Write("total");
+    json sources = json::array();
+    for (const auto& [name, cov] : result.sources) {
+        cov.Write(plot::Plotter::sanitise(name).c_str());
+        sources.push_back(name);
+    }
+    f->Close();
+    return json{{"file", out}, {"sources", sources}};
+}
+//____________________________________________________________________________
+json rarexsec::Service::fit(const json& req)
+{
+    const std::string path = req.at("workspace").get<std::string>();
+    const auto st = io::stamp(path);
+    if (!st)
+        throw std::runtime_error("cannot stat workspace " + path);
+    auto& ws = workspaces_[path];
+    if (!ws || !(ws->stamp == *st)) {
+        ws = std::make_unique<Workspace>();
+        ws->stamp = *st;
+        ws->fitter = std::make_unique<internal::fit::Fitter>(internal::fit::Fitter::load_workspace(path));
+    }
+    const auto r = ws->fitter->fit(req.value("minimizer", std::string("Minuit2")), req.value("algo", std::string("Migrad")));
+    return json{{"status", r.status},
+                {"nll", r.nll},
+                {"mu", r.mu},
+                {"mu_err", r.mu_err_sym},
+                {"poi_names", r.poi_names},
+                {"poi_values", r.poi_values},
+                {"poi_errors", r.poi_errors},
+                {"poi_covariance", r.poi_covariance},
+                {"nuisances", r.nuis_values},
+                {"nuisance_errors", r.nuis_errors},
+                {"cross_section_pb", ws->fitter->cross_section_pb(r)}};
+}
+//____________________________________________________________________________
+json rarexsec::Service::stats() const
+{
+    return json{{"requests", requests_},
+                {"cache_hits", hits_},
+                {"cached_replies", replies_.size()},
+                {"workspaces", workspaces_.size()},
+                {"read_ahead_bytes", hub_->read_ahead_bytes()}};
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "rarexsec/proc/Env.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <nlohmann/json_fwd.hpp>
+#include <string>
+#include <vector>
+
+namespace rarexsec {
+
+// Analysis requests against one long-lived Hub. A request is a JSON object whose "op" is one of
+//   plot        stacked histogram by channel; replies with the image path
+//   cutflow     weighted yields and per-atom counts of a preset
+//   covariance  SystematicsPack result written to a ROOT file; replies with its path
+//   fit         fit of a workspace from Fitter::save_workspace; replies with the result
+//   ping, stats, flush (drop cached replies), reload (rebuild the Hub), shutdown
+// and the reply is a JSON object with "ok" and either the result fields or "error". beamline and
+// periods default to the environment's. Replies are cached on the request text (add "nocache" to
+// bypass); workspaces are cached until their file changes. Being long-lived, the process also
+// keeps ROOT's jitted expressions, the Hub's compiled truth filters and the page cache warm.
+// Not thread-safe: requests are handled one at a time, each using ROOT's implicit MT if enabled.
+class Service {
+  public:
+    explicit Service(Env env);
+    ~Service();
+    Service(const Service&) = delete;
+    Service& operator=(const Service&) = delete;
+
+    // Never throws: failures are reported in the reply.
+    std::string handle(const std::string& request);
+    bool stopping() const { return stop_; }
+
+  private:
+    struct Workspace;
+
+    nlohmann::json dispatch(const nlohmann::json& req);
+    nlohmann::json plot(const nlohmann::json& req);
+    nlohmann::json cutflow(const nlohmann::json& req);
+    nlohmann::json covariance(const nlohmann::json& req);
+    nlohmann::json fit(const nlohmann::json& req);
+    nlohmann::json stats() const;
+    std::vector<const Entry*> simulation(const nlohmann::json& req) const;
+    std::vector<const Entry*> data(const nlohmann::json& req) const;
+
+    Env env_;
+    std::unique_ptr<Hub> hub_;
+    std::map<std::string, std::string> replies_;
+    std::map<std::string, std::unique_ptr<Workspace>> workspaces_;
+    std::uint64_t requests_ = 0, hits_ = 0;
+    bool stop_ = false;
+};
+
+}
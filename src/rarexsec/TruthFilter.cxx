@@ -0,0 +1,350 @@
+#include "rarexsec/TruthFilter.h"
+#include "rarexsec/io/BranchUsage.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+//____________________________________________________________________________
+class rarexsec::TruthFilter::Parser {
+  public:
+    Parser(const std::string& s, TruthFilter& f) : s_(s), f_(f) {}
+
+    void parse()
+    {
+        disjunction();
+        skip_space();
+        if (pos_ != s_.size())
+            fail("unexpected '" + s_.substr(pos_) + "'");
+        if (static_cast<std::size_t>(max_) > max_depth)
+            fail("expression is nested too deeply");
+    }
+
+  private:
+    void disjunction()
+    {
+        conjunction();
+        while (accept("||")) {
+            conjunction();
+            emit(Op::Or, -1);
+        }
+    }
+    void conjunction()
+    {
+        equality();
+        while (accept("&&")) {
+            equality();
+            emit(Op::And, -1);
+        }
+    }
+    void equality()
+    {
+        relation();
+        for (;;) {
+            if (accept("=="))
+                relation(), emit(Op::Eq, -1);
+            else if (accept("!="))
+                relation(), emit(Op::Ne, -1);
+            else
+                return;
+        }
+    }
+    void relation()
+    {
+        sum();
+        for (;;) {
+            if (accept("<="))
+                sum(), emit(Op::Le, -1);
+            else if (accept(">="))
+                sum(), emit(Op::Ge, -1);
+            else if (accept("<"))
+                sum(), emit(Op::Lt, -1);
+            else if (accept(">"))
+                sum(), emit(Op::Gt, -1);
+            else
+                return;
+        }
+    }
+    void sum()
+    {
+        product();
+        for (;;) {
+            if (accept("+"))
+                product(), emit(Op::Add, -1);
+            else if (accept("-"))
+                product(), emit(Op::Sub, -1);
+            else
+                return;
+        }
+    }
+    void product()
+    {
+        unary();
+        for (;;) {
+            if (accept("*"))
+                unary(), emit(Op::Mul, -1);
+            else if (accept("/"))
+                unary(), emit(Op::Div, -1);
+            else
+                return;
+        }
+    }
+    void unary()
+    {
+        skip_space();
+        if (peek("!=") || !(peek("!") || peek("-")))
+            return primary();
+        const Op op = s_[pos_++] == '!' ? Op::Not : Op::Neg;
+        unary();
+        emit(op, 0);
+    }
+    void primary()
+    {
+        skip_space();
+        if (pos_ == s_.size())
+            fail("unexpected end of expression");
+        const char c = s_[pos_];
+        if (c == '(') {
+            ++pos_;
+            disjunction();
+            if (!accept(")"))
+                fail("missing ')'");
+            return;
+        }
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+            const char* begin = s_.c_str() + pos_;
+            char* end = nullptr;
+            const double v = std::strtod(begin, &end);
+            if (end == begin)
+                fail("bad number");
+            pos_ += static_cast<std::size_t>(end - begin);
+            Instr in{Op::Const};
+            in.value = v;
+            push(in, 1);
+            return;
+        }
+        if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            const std::size_t begin = pos_;
+            while (pos_ < s_.size() && (std::isalnum(static_cast<unsigned char>(s_[pos_])) || s_[pos_] == '_'))
+                ++pos_;
+            const std::string id = s_.substr(begin, pos_ - begin);
+            Instr in{Op::Const};
+            if (id == "true" || id == "false") {
+                in.value = id == "true" ? 1.0 : 0.0;
+            } else {
+                auto& cols = f_.columns_;
+                auto it = std::find(cols.begin(), cols.end(), id);
+                if (it == cols.end()) {
+                    if (cols.size() == max_columns)
+                        fail("more than " + std::to_string(max_columns) + " columns");
+                    it = cols.insert(cols.end(), id);
+                }
+                in.op = Op::Column;
+                in.column = static_cast<std::uint8_t>(it - cols.begin());
+            }
+            push(in, 1);
+            return;
+        }
+        fail(std::string("unexpected '") + c + "'");
+    }
+
+    void emit(Op op, int stack_change) { push(Instr{op}, stack_change); }
+    void push(const Instr& in, int stack_change)
+    {
+        f_.code_.push_back(in);
+        depth_ += stack_change;
+        max_ = std::max(max_, depth_);
+    }
+    void skip_space()
+    {
+        while (pos_ < s_.size() && std::isspace(static_cast<unsigned char>(s_[pos_])))
+            ++pos_;
+    }
+    bool peek(const char* tok) { return s_.compare(pos_, std::char_traits<char>::length(tok), tok) == 0; }
+    bool accept(const char* tok)
+    {
+        skip_space();
+        if (!peek(tok))
+            return false;
+        pos_ += std::char_traits<char>::length(tok);
+        return true;
+    }
+    [[noreturn]] void fail(const std::string& what) const
+    {
+        throw std::invalid_argument("truth filter '" + s_ + "': " + what + " at column " + std::to_string(pos_));
+    }
+
+    const std::string& s_;
+    TruthFilter& f_;
+    std::size_t pos_ = 0;
+    int depth_ = 0;
+    int max_ = 0;
+};
+//____________________________________________________________________________
+rarexsec::TruthFilter::TruthFilter(const std::string& expr) : expr_(expr)
+{
+    Parser(expr_, *this).parse();
+}
+//____________________________________________________________________________
+std::string rarexsec::TruthFilter::combine(const std::string& keep, const std::vector<std::string>& exclude)
+{
+    std::string out = keep.empty() ? std::string("true") : "(" + keep + ")";
+    for (const auto& e : exclude)
+        out += " && !(" + e + ")";
+    return out;
+}
+//____________________________________________________________________________
+bool rarexsec::TruthFilter::eval(const double* values) const
+{
+    double st[max_depth];
+    std::size_t n = 0;
+    for (const Instr& in : code_) {
+        switch (in.op) {
+        case Op::Const:
+            st[n++] = in.value;
+            continue;
+        case Op::Column:
+            st[n++] = values[in.column];
+            continue;
+        case Op::Not:
+            st[n - 1] = st[n - 1] == 0.0;
+            continue;
+        case Op::Neg:
+            st[n - 1] = -st[n - 1];
+            continue;
+        default:
+            break;
+        }
+        const double b = st[--n];
+        double& a = st[n - 1];
+        switch (in.op) {
+        case Op::And:
+            a = a != 0.0 && b != 0.0;
+            break;
+        case Op::Or:
+            a = a != 0.0 || b != 0.0;
+            break;
+        case Op::Eq:
+            a = a == b;
+            break;
+        case Op::Ne:
+            a = a != b;
+            break;
+        case Op::Lt:
+            a = a < b;
+            break;
+        case Op::Le:
+            a = a <= b;
+            break;
+        case Op::Gt:
+            a = a > b;
+            break;
+        case Op::Ge:
+            a = a >= b;
+            break;
+        case Op::Add:
+            a += b;
+            break;
+        case Op::Sub:
+            a -= b;
+            break;
+        case Op::Mul:
+            a *= b;
+            break;
+        case Op::Div:
+            a /= b;
+            break;
+        default:
+            break;
+        }
+    }
+    return st[0] != 0.0;
+}
+//____________________________________________________________________________
+namespace {
+
+template <class T>
+ROOT::RDF::RNode as_double(ROOT::RDF::RNode node, const std::string& out, const std::string& col)
+{
+    return node.Define(out, [](T x) { return static_cast<double>(x); }, {col});
+}
+
+// Casts a scalar column to double under a hidden name so the predicate has a fixed signature
+ROOT::RDF::RNode define_double(ROOT::RDF::RNode node, const std::string& out, const std::string& col)
+{
+    const std::string t = node.GetColumnType(col);
+    if (t == "double" || t == "Double_t")
+        return as_double<double>(node, out, col);
+    if (t == "float" || t == "Float_t")
+        return as_double<float>(node, out, col);
+    if (t == "int" || t == "Int_t")
+        return as_double<int>(node, out, col);
+    if (t == "unsigned int" || t == "UInt_t")
+        return as_double<unsigned int>(node, out, col);
+    if (t == "bool" || t == "Bool_t")
+        return as_double<bool>(node, out, col);
+    if (t == "short" || t == "Short_t")
+        return as_double<short>(node, out, col);
+    if (t == "unsigned short" || t == "UShort_t")
+        return as_double<unsigned short>(node, out, col);
+    if (t == "char" || t == "Char_t")
+        return as_double<char>(node, out, col);
+    if (t == "unsigned char" || t == "UChar_t")
+        return as_double<unsigned char>(node, out, col);
+    if (t == "long" || t == "Long_t")
+        return as_double<long>(node, out, col);
+    if (t == "unsigned long" || t == "ULong_t")
+        return as_double<unsigned long>(node, out, col);
+    if (t == "long long" || t == "Long64_t")
+        return as_double<long long>(node, out, col);
+    if (t == "unsigned long long" || t == "ULong64_t")
+        return as_double<unsigned long long>(node, out, col);
+    throw std::invalid_argument("truth filter column '" + col + "' has non-scalar type " + t);
+}
+
+template <std::size_t I>
+using value_t = double;
+
+template <std::size_t... I>
+ROOT::RDF::RNode filter_n(ROOT::RDF::RNode node, const rarexsec::TruthFilter& f,
+                          const ROOT::RDF::ColumnNames_t& cols, const std::string& name,
+                          std::index_sequence<I...>)
+{
+    auto pred = [f](value_t<I>... v) {
+        const double values[] = {v..., 0.0};
+        return f.eval(values);
+    };
+    return name.empty() ? node.Filter(pred, cols) : node.Filter(pred, cols, name);
+}
+
+template <std::size_t... N>
+ROOT::RDF::RNode dispatch(ROOT::RDF::RNode node, const rarexsec::TruthFilter& f,
+                          const ROOT::RDF::ColumnNames_t& cols, const std::string& name,
+                          std::index_sequence<N...>)
+{
+    std::optional<ROOT::RDF::RNode> out;
+    ((cols.size() == N ? (out = filter_n(node, f, cols, name, std::make_index_sequence<N>{}), 0) : 0), ...);
+    return *out;
+}
+
+}
+//____________________________________________________________________________
+ROOT::RDF::RNode rarexsec::TruthFilter::apply(ROOT::RDF::RNode node, const std::string& name) const
+{
+    io::branch_usage().request(columns_);
+
+    const auto have = node.GetColumnNames();
+    ROOT::RDF::ColumnNames_t cols;
+    for (const auto& c : columns_) {
+        if (std::find(have.begin(), have.end(), c) == have.end())
+            throw std::invalid_argument("truth filter '" + expr_ + "': no column " + c);
+        cols.push_back("_rx_tf_" + c);
+        if (std::find(have.begin(), have.end(), cols.back()) == have.end())
+            node = define_double(node, cols.back(), c);
+    }
+    return dispatch(node, *this, cols, name, std::make_index_sequence<max_columns + 1>{});
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <ROOT/RDataFrame.hxx>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rarexsec {
+
+// Truth-level sample filter from the analysis recipe, e.g. "(mc_n_strange > 0)", compiled once
+// into a small postfix program and evaluated in a typed Filter, so recipe expressions never go
+// through the interpreter. Grammar: || && ! == != < <= > >= + - * / (unary - and !), parentheses,
+// numbers, true/false and scalar arithmetic or boolean columns; comparisons yield 0 or 1.
+class TruthFilter {
+  public:
+    static constexpr std::size_t max_columns = 8;
+    static constexpr std::size_t max_depth = 32;
+
+    explicit TruthFilter(const std::string& expr);
+
+    // "(keep) && !(exclude...)"; an empty keep places no positive requirement.
+    static std::string combine(const std::string& keep, const std::vector<std::string>& exclude);
+
+    const std::string& expression() const { return expr_; }
+    const std::vector<std::string>& columns() const { return columns_; }
+
+    // values[i] is the value of columns()[i]
+    bool eval(const double* values) const;
+
+    ROOT::RDF::RNode apply(ROOT::RDF::RNode node, const std::string& name = "") const;
+
+  private:
+    enum class Op : std::uint8_t { Const, Column, Not, Neg, And, Or, Eq, Ne, Lt, Le, Gt, Ge, Add, Sub, Mul, Div };
+    struct Instr {
+        Op op;
+        std::uint8_t column = 0;
+        double value = 0.0;
+    };
+    class Parser;
+
+    std::string expr_;
+    std::vector<std::string> columns_;
+    std::vector<Instr> code_;
+};
+
+}
@@ -0,0 +1,182 @@
+#include "rarexsec/exec/Incremental.h"
+#include "rarexsec/Hub.h"
+#include "rarexsec/Processor.h"
+#include "rarexsec/io/Binary.h"
+#include "rarexsec/io/EntryIndex.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <system_error>
+
+using json = nlohmann::json;
+
+namespace {
+
+constexpr int kManifestVersion = 2;
+
+using rarexsec::io::binary::fnv1a;
+using rarexsec::io::binary::hex;
+
+// Which sample a file belongs to. The normalisation is left out: stored partials are filled at unit
+// exposure scale and scaled when merged.
+std::string sample_id(const rarexsec::Entry& rec)
+{
+    std::string id = rec.beamline + '\n' + rec.period + '\n' + std::to_string(static_cast<int>(rec.source)) + '\n' +
+                     std::to_string(static_cast<int>(rec.slice)) + '\n' + std::to_string(static_cast<int>(rec.kind)) +
+                     '\n' + rec.truth_filter + '\n';
+    for (const auto& ex : rec.exclusion_truth_filters)
+        id += ex + '\n';
+    return hex(fnv1a(id));
+}
+
+struct Item {
+    std::string sample_id;
+    std::string file;
+    rarexsec::io::FileStamp stamp;
+};
+
+std::map<std::string, Item> load_manifest(const std::string& path, const std::string& job_key)
+{
+    std::map<std::string, Item> items;
+    std::ifstream in(path);
+    if (!in)
+        return items;
+    try {
+        json j;
+        in >> j;
+        if (j.at("version").get<int>() != kManifestVersion || j.at("job").get<std::string>() != job_key ||
+            j.at("processor_version").get<unsigned>() != rarexsec::Processor::version)
+            return items;
+        for (const auto& [key, v] : j.at("items").items()) {
+            Item it;
+            it.sample_id = v.at("sample_id").get<std::string>();
+            it.file = v.at("file").get<std::string>();
+            it.stamp.size = v.at("size").get<std::uint64_t>();
+            it.stamp.mtime_ns = v.at("mtime_ns").get<std::int64_t>();
+            items.emplace(key, std::move(it));
+        }
+    } catch (const json::exception&) {
+        items.clear();
+    }
+    return items;
+}
+
+void save_manifest(const std::string& path, const std::string& job_key, const std::map<std::string, Item>& items)
+{
+    json j;
+    j["version"] = kManifestVersion;
+    j["job"] = job_key;
+    j["processor_version"] = rarexsec::Processor::version;
+    json& out = j["items"] = json::object();
+    for (const auto& [key, it] : items)
+        out[key] = {{"sample_id", it.sample_id}, {"file", it.file},
+                    {"size", it.stamp.size}, {"mtime_ns", it.stamp.mtime_ns}};
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream os(tmp, std::ios::trunc);
+        os << j.dump(1) << '\n';
+        if (!os)
+            throw std::runtime_error("exec::run_incremental: cannot write " + tmp);
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0)
+        throw std::runtime_error("exec::run_incremental: cannot rename " + tmp + " to " + path);
+}
+
+}
+
+//____________________________________________________________________________
+rarexsec::exec::Partial rarexsec::exec::run_incremental(const Hub& hub, const std::vector<const Entry*>& entries,
+                                                        const std::string& job_key, const ShardJob& job,
+                                                        const std::string& dir, IncrementalStats* stats)
+{
+    if (dir.empty())
+        throw std::invalid_argument("exec::run_incremental: no store directory");
+    const std::filesystem::path store = std::filesystem::path(dir) / hex(fnv1a(job_key));
+    std::error_code ec;
+    std::filesystem::create_directories(store, ec);
+    if (ec)
+        throw std::runtime_error("exec::run_incremental: cannot create " + store.string() + ": " + ec.message());
+    const std::string manifest = (store / "manifest.json").string();
+    auto items = load_manifest(manifest, job_key);
+    auto part_path = [&](const std::string& key) { return (store / (key + ".part")).string(); };
+
+    IncrementalStats local;
+    IncrementalStats& st = stats ? *stats : local;
+    st = IncrementalStats{};
+
+    Partial total;
+    std::set<std::string> samples, current;
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        if (!entries[i])
+            continue;
+        const Entry& rec = *entries[i];
+        const std::string id = sample_id(rec);
+        const double scale = Processor::exposure_scale(rec);
+        samples.insert(id);
+        for (const auto& file : rec.files) {
+            const std::string key = hex(fnv1a(id + '\n' + file));
+            current.insert(key);
+            const auto stamp = io::stamp(file);
+
+            auto it = items.find(key);
+            if (stamp && it != items.end() && it->second.stamp == *stamp) {
+                try {
+                    Partial p = Partial::read(part_path(key));
+                    p.scale(scale);
+                    total.merge(p);
+                    ++st.reused;
+                    continue;
+                } catch (const std::runtime_error&) {
+                    // missing or damaged: fall through and process the file again
+                }
+            }
+
+            Entry one = rec;
+            one.files = {file};
+            one.file = file;
+            one.detvars.clear();
+            // unit exposure scale, so the stored partial stays valid when the sample's POT or
+            // triggers change
+            if (one.pot_nom > 0.0)
+                one.pot_eqv = one.pot_nom;
+            if (one.trig_nom > 0.0)
+                one.trig_eqv = one.trig_nom;
+            one.nominal = hub.sample(one);
+            std::vector<const Entry*> view(entries.size(), nullptr);
+            view[i] = &one;
+            Partial p;
+            job(view, p);
+            ++st.processed;
+
+            if (stamp) {
+                p.write(part_path(key));
+                items[key] = Item{id, file, *stamp};
+            } else if (it != items.end()) {
+                std::remove(part_path(key).c_str());
+                items.erase(it);
+            }
+            p.scale(scale);
+            total.merge(p);
+        }
+    }
+
+    // files that left a sample; samples not passed here are kept as they are
+    for (auto it = items.begin(); it != items.end();) {
+        if (samples.count(it->second.sample_id) && !current.count(it->first)) {
+            std::remove(part_path(it->first).c_str());
+            it = items.erase(it);
+            ++st.dropped;
+        } else {
+            ++it;
+        }
+    }
+    save_manifest(manifest, job_key, items);
+    return total;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "rarexsec/exec/Partial.h"
+#include "rarexsec/exec/Sharded.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace rarexsec {
+struct Entry;
+class Hub;
+
+namespace exec {
+
+struct IncrementalStats {
+    std::size_t reused = 0;
+    std::size_t processed = 0;
+    std::size_t dropped = 0;
+};
+
+// Runs job once per input file and keeps each file's partial result under dir/<job_key hash>/,
+// keyed by the sample it belongs to and the file's FileStamp. Later calls process only the files
+// that are new or rewritten, drop the stored results of files no longer listed by a sample, and
+// return the sum over the current files in input order. Totals are re-summed from the stored
+// per-file results rather than updated by subtraction, so they equal a call on an empty store bit
+// for bit.
+//
+// job_key names the booked analysis: change it whenever the job does. Stored results are filled at
+// unit exposure scale (pot_eqv = pot_nom, trig_eqv = trig_nom in the entry passed to the job) and
+// multiplied by Processor::exposure_scale of the sample when summed, so a change of POT or triggers
+// reprocesses nothing; the job must therefore be linear in w_base. Files that cannot be stamped
+// (remote URLs) are processed on every call. Entries passed to the job hold a single file each and
+// no detector variations.
+Partial run_incremental(const Hub& hub, const std::vector<const Entry*>& entries, const std::string& job_key,
+                        const ShardJob& job, const std::string& dir, IncrementalStats* stats = nullptr);
+
+}
+}
@@ -0,0 +1,240 @@
+#include "rarexsec/exec/Partial.h"
+#include "rarexsec/io/Binary.h"
+#include "rarexsec/proc/Selection.h"
+
+#include <TArrayD.h>
+#include <TDirectory.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+// Partial layout (native endianness, checked on read):
+//   "RXPR" | u32 version | u32 byte-order mark
+//   u32 n | n x (name, title, edges, contents incl. under/overflow, u8 has_sumw2 [, sumw2],
+//                stats[4], entries)
+//   u32 n | n x (name, values)
+//   u32 n | n x (name, u64 count)
+//   u64 FNV-1a checksum of everything before it
+// Strings are u32 length + bytes, arrays are u32 count + raw doubles.
+
+namespace {
+
+constexpr char kMagic[4] = {'R', 'X', 'P', 'R'};
+constexpr std::uint32_t kVersion = 1;
+constexpr std::uint32_t kByteOrder = 0x01020304u;
+
+using rarexsec::io::binary::fnv1a;
+using rarexsec::io::binary::Reader;
+using rarexsec::io::binary::Writer;
+
+std::vector<double> edges(const TH1D& h)
+{
+    const int nb = h.GetNbinsX();
+    std::vector<double> out(nb + 1);
+    for (int i = 1; i <= nb + 1; ++i)
+        out[i - 1] = h.GetXaxis()->GetBinLowEdge(i);
+    return out;
+}
+
+}
+
+//____________________________________________________________________________
+void rarexsec::exec::Partial::add(const std::string& name, const TH1D& h)
+{
+    auto it = hists_.find(name);
+    if (it == hists_.end()) {
+        auto copy = std::unique_ptr<TH1D>(static_cast<TH1D*>(h.Clone(name.c_str())));
+        copy->SetDirectory(nullptr);
+        hists_.emplace(name, std::move(copy));
+        return;
+    }
+    if (edges(*it->second) != edges(h))
+        throw std::runtime_error("exec::Partial: histogram '" + name + "' added with a different binning");
+    it->second->Add(&h);
+}
+//____________________________________________________________________________
+void rarexsec::exec::Partial::add(const std::string& name, const std::vector<double>& values)
+{
+    auto it = values_.find(name);
+    if (it == values_.end()) {
+        values_.emplace(name, values);
+        return;
+    }
+    if (it->second.size() != values.size())
+        throw std::runtime_error("exec::Partial: accumulator '" + name + "' added with a different length");
+    for (std::size_t i = 0; i < values.size(); ++i)
+        it->second[i] += values[i];
+}
+//____________________________________________________________________________
+void rarexsec::exec::Partial::count(const std::string& name, std::uint64_t n)
+{
+    counters_[name] += n;
+}
+//____________________________________________________________________________
+void rarexsec::exec::Partial::add(const std::string& prefix, const selection::Cutflow& flow)
+{
+    count(prefix + "/entered", flow.entered());
+    const auto& names = flow.names();
+    for (std::size_t i = 0; i < names.size(); ++i)
+        count(prefix + "/" + names[i], flow.passed(i));
+}
+//____________________________________________________________________________
+void rarexsec::exec::Partial::merge(const Partial& other)
+{
+    for (const auto& [name, h] : other.hists_)
+        add(name, *h);
+    for (const auto& [name, v] : other.values_)
+        add(name, v);
+    for (const auto& [name, n] : other.counters_)
+        count(name, n);
+}
+//____________________________________________________________________________
+void rarexsec::exec::Partial::scale(double s)
+{
+    if (s == 1.0)
+        return;
+    for (auto& [name, h] : hists_)
+        h->Scale(s);
+    for (auto& [name, v] : values_)
+        for (double& x : v)
+            x *= s;
+}
+//____________________________________________________________________________
+const TH1D& rarexsec::exec::Partial::hist(const std::string& name) const
+{
+    auto it = hists_.find(name);
+    if (it == hists_.end())
+        throw std::runtime_error("exec::Partial: no histogram '" + name + "'");
+    return *it->second;
+}
+//____________________________________________________________________________
+const std::vector<double>& rarexsec::exec::Partial::values(const std::string& name) const
+{
+    auto it = values_.find(name);
+    if (it == values_.end())
+        throw std::runtime_error("exec::Partial: no accumulator '" + name + "'");
+    return it->second;
+}
+//____________________________________________________________________________
+std::uint64_t rarexsec::exec::Partial::counter(const std::string& name) const
+{
+    auto it = counters_.find(name);
+    return it == counters_.end() ? 0 : it->second;
+}
+//____________________________________________________________________________
+void rarexsec::exec::Partial::write(const std::string& path) const
+{
+    Writer w;
+    w.buffer().append(kMagic, sizeof(kMagic));
+    w.pod(kVersion);
+    w.pod(kByteOrder);
+
+    w.pod<std::uint32_t>(static_cast<std::uint32_t>(hists_.size()));
+    for (const auto& [name, h] : hists_) {
+        w.str(name);
+        w.str(h->GetTitle());
+        const auto e = edges(*h);
+        w.doubles(e.data(), e.size());
+        w.doubles(h->GetArray(), h->GetNbinsX() + 2);
+        const bool sumw2 = h->GetSumw2N() > 0;
+        w.pod<std::uint8_t>(sumw2);
+        if (sumw2)
+            w.doubles(h->GetSumw2()->GetArray(), h->GetNbinsX() + 2);
+        double stats[4] = {0, 0, 0, 0};
+        h->GetStats(stats);
+        for (double s : stats)
+            w.pod(s);
+        w.pod(h->GetEntries());
+    }
+    w.pod<std::uint32_t>(static_cast<std::uint32_t>(values_.size()));
+    for (const auto& [name, v] : values_) {
+        w.str(name);
+        w.doubles(v.data(), v.size());
+    }
+    w.pod<std::uint32_t>(static_cast<std::uint32_t>(counters_.size()));
+    for (const auto& [name, n] : counters_) {
+        w.str(name);
+        w.pod(n);
+    }
+    auto& buf = w.buffer();
+    w.pod(fnv1a(buf.data(), buf.size()));
+
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+        if (!out)
+            throw std::runtime_error("exec::Partial: cannot write " + tmp);
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0)
+        throw std::runtime_error("exec::Partial: cannot rename " + tmp + " to " + path);
+}
+//____________________________________________________________________________
+rarexsec::exec::Partial rarexsec::exec::Partial::read(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("exec::Partial: cannot open " + path);
+    const std::string buf((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (buf.size() < sizeof(kMagic) + 2 * sizeof(std::uint32_t) + sizeof(std::uint64_t) ||
+        std::memcmp(buf.data(), kMagic, sizeof(kMagic)) != 0)
+        throw std::runtime_error("exec::Partial: not a partial-result file: " + path);
+    const std::size_t body = buf.size() - sizeof(std::uint64_t);
+    std::uint64_t sum;
+    std::memcpy(&sum, buf.data() + body, sizeof(sum));
+    if (sum != fnv1a(buf.data(), body))
+        throw std::runtime_error("exec::Partial: checksum mismatch in " + path);
+
+    Reader r(buf.data(), body, "exec::Partial", path);
+    for (std::size_t i = 0; i < sizeof(kMagic); ++i)
+        r.pod<char>();
+    if (r.pod<std::uint32_t>() != kVersion || r.pod<std::uint32_t>() != kByteOrder)
+        throw std::runtime_error("exec::Partial: unsupported version or byte order in " + path);
+
+    Partial out;
+    TDirectory::TContext detached(nullptr);
+    for (auto n = r.pod<std::uint32_t>(); n > 0; --n) {
+        const std::string name = r.str();
+        const std::string title = r.str();
+        const auto e = r.doubles();
+        if (e.size() < 2)
+            throw std::runtime_error("exec::Partial: histogram '" + name + "' without bins in " + path);
+        const int nb = static_cast<int>(e.size()) - 1;
+        auto h = std::make_unique<TH1D>(name.c_str(), title.c_str(), nb, e.data());
+        h->SetDirectory(nullptr);
+        const auto contents = r.doubles();
+        if (contents.size() != e.size() + 1)
+            throw std::runtime_error("exec::Partial: histogram '" + name + "' is malformed in " + path);
+        std::copy(contents.begin(), contents.end(), h->GetArray());
+        if (r.pod<std::uint8_t>()) {
+            const auto sumw2 = r.doubles();
+            if (sumw2.size() != contents.size())
+                throw std::runtime_error("exec::Partial: histogram '" + name + "' is malformed in " + path);
+            h->Sumw2();
+            std::copy(sumw2.begin(), sumw2.end(), h->GetSumw2()->GetArray());
+        } else if (h->GetSumw2N() > 0) {
+            h->Sumw2(false);
+        }
+        double stats[4];
+        for (double& s : stats)
+            s = r.pod<double>();
+        h->PutStats(stats);
+        h->SetEntries(r.pod<double>());
+        out.hists_.emplace(name, std::move(h));
+    }
+    for (auto n = r.pod<std::uint32_t>(); n > 0; --n) {
+        std::string name = r.str();
+        out.values_.emplace(std::move(name), r.doubles());
+    }
+    for (auto n = r.pod<std::uint32_t>(); n > 0; --n) {
+        std::string name = r.str();
+        out.counters_.emplace(std::move(name), r.pod<std::uint64_t>());
+    }
+    if (!r.done())
+        throw std::runtime_error("exec::Partial: trailing bytes in " + path);
+    return out;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <TH1D.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rarexsec {
+namespace selection {
+class Cutflow;
+}
+
+namespace exec {
+
+// Additive results of one pass over part of the data: histograms (contents, sumw2 and stats),
+// fixed-length accumulators and integer counters, each keyed by name. Adding a key that is
+// already present accumulates into it, so a shard's output and the merge of several shards use
+// the same calls; merges done in a fixed order give the same bits on every run.
+class Partial {
+  public:
+    Partial() = default;
+    Partial(Partial&&) = default;
+    Partial& operator=(Partial&&) = default;
+
+    void add(const std::string& name, const TH1D& h);
+    void add(const std::string& name, const std::vector<double>& values);
+    void count(const std::string& name, std::uint64_t n);
+    // Counters "<prefix>/entered" and "<prefix>/<atom>" for every atom of the flow.
+    void add(const std::string& prefix, const selection::Cutflow& flow);
+    void merge(const Partial& other);
+    // Multiplies histogram contents and accumulators by s, and sumw2 by s^2; counters and entry
+    // counts are unchanged. Accumulators are taken to be sums of weights.
+    void scale(double s);
+
+    bool has_hist(const std::string& name) const { return hists_.count(name) != 0; }
+    const TH1D& hist(const std::string& name) const;
+    const std::vector<double>& values(const std::string& name) const;
+    std::uint64_t counter(const std::string& name) const;
+
+    const std::map<std::string, std::unique_ptr<TH1D>>& hists() const { return hists_; }
+    const std::map<std::string, std::vector<double>>& accumulators() const { return values_; }
+    const std::map<std::string, std::uint64_t>& counters() const { return counters_; }
+
+    // Binary file, native endianness (checked on read) with a trailing checksum; written to a
+    // temporary and renamed into place.
+    void write(const std::string& path) const;
+    static Partial read(const std::string& path);
+
+  private:
+    std::map<std::string, std::unique_ptr<TH1D>> hists_;
+    std::map<std::string, std::vector<double>> values_;
+    std::map<std::string, std::uint64_t> counters_;
+};
+
+}
+}
@@ -0,0 +1,143 @@
+#include "rarexsec/exec/Plan.h"
+#include "rarexsec/Hub.h"
+
+#include <ROOT/RDFHelpers.hxx>
+
+#include <algorithm>
+#include <stdexcept>
+
+//____________________________________________________________________________
+rarexsec::exec::Plan::Sample& rarexsec::exec::Plan::sample(const Entry& rec)
+{
+    auto [it, fresh] = samples_.try_emplace(&rec);
+    if (fresh) {
+        it->second.rec = &rec;
+        if (rec.nominal.df)
+            it->second.runs_before = rec.nominal.df->GetNRuns();
+    }
+    return it->second;
+}
+//____________________________________________________________________________
+std::string rarexsec::exec::Plan::name_of(const std::string& expr)
+{
+    auto [it, fresh] = names_.try_emplace(expr);
+    if (fresh)
+        it->second = "_rx_plan_" + std::to_string(names_.size() - 1);
+    return it->second;
+}
+//____________________________________________________________________________
+void rarexsec::exec::Plan::declare(const Entry& rec, const std::string& expr)
+{
+    if (expr.empty())
+        return;
+    Sample& s = sample(rec);
+    if (std::find(s.exprs.begin(), s.exprs.end(), expr) != s.exprs.end())
+        return;
+    if (s.base)
+        throw std::runtime_error("exec::Plan: '" + expr + "' declared after the sample's nodes were booked");
+    s.exprs.push_back(expr);
+}
+//____________________________________________________________________________
+void rarexsec::exec::Plan::declare_cutflow(const Entry& rec, selection::Preset p,
+                                           std::shared_ptr<selection::Cutflow> flow)
+{
+    Sample& s = sample(rec);
+    if (s.selected.count(p))
+        throw std::runtime_error(std::string("exec::Plan: cutflow of ") + selection::preset_name(p) +
+                                 " declared after its filter was booked");
+    s.flows[p] = std::move(flow);
+}
+//____________________________________________________________________________
+ROOT::RDF::RNode& rarexsec::exec::Plan::base(Sample& s)
+{
+    if (!s.base) {
+        ROOT::RDF::RNode node = s.rec->rnode();
+        for (const auto& expr : s.exprs) {
+            if (node.HasColumn(expr))
+                continue;
+            node = node.Define(name_of(expr), expr);
+            ++defines_;
+        }
+        // gives run() a result to trigger the sample with, and the entries read
+        s.count = node.Count();
+        s.base = node;
+    }
+    return *s.base;
+}
+//____________________________________________________________________________
+std::string rarexsec::exec::Plan::column(const Entry& rec, const std::string& expr)
+{
+    Sample& s = sample(rec);
+    ROOT::RDF::RNode& node = base(s);
+    if (std::find(s.exprs.begin(), s.exprs.end(), expr) == s.exprs.end()) {
+        if (node.HasColumn(expr))
+            return expr;
+        throw std::runtime_error("exec::Plan: '" + expr + "' was not declared for this sample");
+    }
+    return s.rec->rnode().HasColumn(expr) ? expr : name_of(expr);
+}
+//____________________________________________________________________________
+ROOT::RDF::RNode rarexsec::exec::Plan::node(const Entry& rec)
+{
+    return base(sample(rec));
+}
+//____________________________________________________________________________
+ROOT::RDF::RNode rarexsec::exec::Plan::node(const Entry& rec, selection::Preset p)
+{
+    Sample& s = sample(rec);
+    auto it = s.selected.find(p);
+    if (it == s.selected.end()) {
+        auto flow = s.flows.count(p) ? s.flows[p] : nullptr;
+        it = s.selected.emplace(p, selection::apply(base(s), p, rec, std::move(flow))).first;
+        if (p != selection::Preset::Empty)
+            ++filters_;
+    }
+    return it->second;
+}
+//____________________________________________________________________________
+ROOT::RDF::RNode rarexsec::exec::Plan::node(const Entry& rec, selection::Preset p, int channel)
+{
+    Sample& s = sample(rec);
+    const auto key = std::make_pair(p, channel);
+    auto it = s.channels.find(key);
+    if (it == s.channels.end()) {
+        auto nf = node(rec, p).Filter([channel](int c) { return c == channel; }, {"analysis_channels"});
+        it = s.channels.emplace(key, nf).first;
+        ++filters_;
+    }
+    return it->second;
+}
+//____________________________________________________________________________
+void rarexsec::exec::Plan::run()
+{
+    std::vector<ROOT::RDF::RResultHandle> handles;
+    std::vector<Sample*> pending;
+    for (auto& [rec, s] : samples_) {
+        if (s.count && !s.count.IsReady()) {
+            handles.emplace_back(s.count);
+            pending.push_back(&s);
+        }
+    }
+    if (handles.empty())
+        return;
+    ROOT::RDF::RunGraphs(handles);
+    for (Sample* s : pending) {
+        entries_ += *s->count;
+        if (s->rec->nominal.df) {
+            const unsigned runs = s->rec->nominal.df->GetNRuns();
+            loops_ += runs - s->runs_before;
+            s->runs_before = runs;
+        }
+    }
+}
+//____________________________________________________________________________
+rarexsec::exec::Plan::Stats rarexsec::exec::Plan::stats() const
+{
+    Stats out;
+    out.samples = samples_.size();
+    out.defines = defines_;
+    out.filters = filters_;
+    out.loops = loops_;
+    out.entries = entries_;
+    return out;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include "rarexsec/proc/Selection.h"
+
+#include <ROOT/RDataFrame.hxx>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rarexsec {
+struct Entry;
+
+namespace exec {
+
+// One graph of booked actions over many samples. Every consumer of a sample asks the plan for its
+// nodes, so an expression is defined once per sample, a selection is one filter per (sample,
+// preset) and a channel split one filter per (sample, preset, channel), however many plots,
+// yields and universes hang below them. Nothing runs until run(), which triggers the event loops
+// of all samples together: each data frame is read once for everything booked on it.
+//
+// Expressions are declared first and defined on the sample's node ahead of its selections;
+// RDataFrame evaluates a Define only for the events that reach a reader of it, so the unused ones
+// cost nothing. The first request for a sample's nodes fixes its definitions, after which
+// declaring a new expression for it throws.
+class Plan {
+  public:
+    Plan() = default;
+    Plan(const Plan&) = delete;
+    Plan& operator=(const Plan&) = delete;
+
+    // Declaration: expressions the sample's consumers will read, and the cutflow a composite
+    // preset of the sample should count into.
+    void declare(const Entry& rec, const std::string& expr);
+    void declare_cutflow(const Entry& rec, selection::Preset p, std::shared_ptr<selection::Cutflow> flow);
+
+    // Booking: the column holding expr (expr itself when it names a column) and the shared nodes.
+    std::string column(const Entry& rec, const std::string& expr);
+    ROOT::RDF::RNode node(const Entry& rec);
+    ROOT::RDF::RNode node(const Entry& rec, selection::Preset p);
+    ROOT::RDF::RNode node(const Entry& rec, selection::Preset p, int channel);
+
+    // Runs the event loops of every sample booked so far, concurrently under implicit MT.
+    void run();
+
+    struct Stats {
+        std::size_t samples = 0, defines = 0, filters = 0;
+        // event loops started by run(), and entries they read
+        std::uint64_t loops = 0, entries = 0;
+    };
+    Stats stats() const;
+
+  private:
+    struct Sample {
+        const Entry* rec = nullptr;
+        std::vector<std::string> exprs;
+        std::map<selection::Preset, std::shared_ptr<selection::Cutflow>> flows;
+        std::optional<ROOT::RDF::RNode> base;
+        std::map<selection::Preset, ROOT::RDF::RNode> selected;
+        std::map<std::pair<selection::Preset, int>, ROOT::RDF::RNode> channels;
+        ROOT::RDF::RResultPtr<ULong64_t> count;
+        unsigned runs_before = 0;
+    };
+
+    Sample& sample(const Entry& rec);
+    ROOT::RDF::RNode& base(Sample& s);
+    std::string name_of(const std::string& expr);
+
+    std::map<const Entry*, Sample> samples_;
+    std::map<std::string, std::string> names_;
+    std::size_t defines_ = 0, filters_ = 0;
+    std::uint64_t loops_ = 0, entries_ = 0;
+};
+
+}
+}
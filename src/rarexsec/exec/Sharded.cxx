@@ -0,0 +1,152 @@
+#include "rarexsec/exec/Sharded.h"
+#include "rarexsec/Hub.h"
+
+#include <TROOT.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+std::string scratch_dir(const rarexsec::exec::ShardOptions& opt)
+{
+    if (!opt.scratch_dir.empty())
+        return opt.scratch_dir;
+    const char* tmp = std::getenv("TMPDIR");
+    return tmp && *tmp ? tmp : "/tmp";
+}
+
+[[noreturn]] void run_worker(const rarexsec::Hub& hub, const std::vector<const rarexsec::Entry*>& entries,
+                             const std::vector<rarexsec::exec::Shard>& shards, const rarexsec::exec::ShardJob& job,
+                             const std::string& path)
+{
+    int status = 0;
+    try {
+        std::vector<rarexsec::Entry> copies;
+        copies.reserve(shards.size());
+        std::vector<const rarexsec::Entry*> view(entries.size(), nullptr);
+        for (const auto& s : shards) {
+            rarexsec::Entry rec = *entries[s.entry];
+            rec.detvars.clear();
+            rec.nominal = hub.sample(rec, s.begin, s.end);
+            copies.push_back(std::move(rec));
+            view[s.entry] = &copies.back();
+        }
+        rarexsec::exec::Partial out;
+        job(view, out);
+        out.write(path);
+    } catch (const std::exception& e) {
+        std::cerr << "exec::run_sharded: worker " << ::getpid() << ": " << e.what() << std::endl;
+        status = 1;
+    } catch (...) {
+        status = 1;
+    }
+    std::cout.flush();
+    std::cerr.flush();
+    // skip atexit handlers and static destructors that belong to the parent
+    ::_exit(status);
+}
+
+}
+
+//____________________________________________________________________________
+std::vector<std::vector<rarexsec::exec::Shard>>
+rarexsec::exec::plan_shards(const Hub& hub, const std::vector<const Entry*>& entries, unsigned n)
+{
+    if (n == 0)
+        throw std::invalid_argument("exec::plan_shards: no workers");
+    std::vector<std::uint64_t> counts(entries.size(), 0);
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        if (!entries[i])
+            continue;
+        counts[i] = hub.entries(*entries[i]);
+        total += counts[i];
+    }
+
+    std::vector<std::vector<Shard>> plan(n);
+    std::uint64_t offset = 0;
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        if (!entries[i])
+            continue;
+        if (counts[i] == 0) {
+            plan[0].push_back({i, 0, 0});
+            continue;
+        }
+        const std::uint64_t first = offset, last = offset + counts[i];
+        for (unsigned k = 0; k < n; ++k) {
+            const std::uint64_t lo = std::max(first, total * k / n);
+            const std::uint64_t hi = std::min(last, total * (k + 1) / n);
+            if (lo >= hi)
+                continue;
+            plan[k].push_back({i, lo - first, hi == last ? 0 : hi - first});
+        }
+        offset = last;
+    }
+    return plan;
+}
+//____________________________________________________________________________
+rarexsec::exec::Partial rarexsec::exec::run_sharded(const Hub& hub, const std::vector<const Entry*>& entries,
+                                                    const ShardJob& job, const ShardOptions& opt)
+{
+    if (ROOT::IsImplicitMTEnabled())
+        throw std::runtime_error("exec::run_sharded: disable implicit MT; forked workers cannot use its thread pool");
+    unsigned n = opt.workers ? opt.workers : std::max(1u, std::thread::hardware_concurrency());
+    const auto plan = plan_shards(hub, entries, n);
+
+    const std::string dir = scratch_dir(opt);
+    const std::string stem = dir + "/rarexsec-shard." + std::to_string(::getpid()) + ".";
+    std::vector<std::string> paths;
+    std::vector<pid_t> pids;
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(nullptr);
+    for (unsigned k = 0; k < n; ++k) {
+        if (plan[k].empty())
+            continue;
+        const std::string path = stem + std::to_string(k) + ".part";
+        const pid_t pid = ::fork();
+        if (pid < 0) {
+            for (pid_t p : pids)
+                ::waitpid(p, nullptr, 0);
+            throw std::runtime_error("exec::run_sharded: fork failed");
+        }
+        if (pid == 0)
+            run_worker(hub, entries, plan[k], job, path);
+        pids.push_back(pid);
+        paths.push_back(path);
+    }
+
+    std::string failed;
+    for (std::size_t k = 0; k < pids.size(); ++k) {
+        int status = 0;
+        while (::waitpid(pids[k], &status, 0) < 0 && errno == EINTR) {
+        }
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            failed += (failed.empty() ? "" : ", ") + paths[k];
+    }
+
+    Partial out;
+    if (failed.empty()) {
+        for (const auto& path : paths)
+            out.merge(Partial::read(path));
+    }
+    if (!opt.keep_partials) {
+        for (const auto& path : paths)
+            std::remove(path.c_str());
+    }
+    if (!failed.empty())
+        throw std::runtime_error("exec::run_sharded: workers failed for " + failed);
+    return out;
+}
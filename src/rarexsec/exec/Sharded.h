@@ -0,0 +1,48 @@
+#pragma once
+#include "rarexsec/exec/Partial.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace rarexsec {
+struct Entry;
+class Hub;
+
+namespace exec {
+
+struct ShardOptions {
+    // Worker processes; 0 takes the hardware concurrency.
+    unsigned workers = 0;
+    // Directory for the workers' partial files; empty takes $TMPDIR, then /tmp.
+    std::string scratch_dir;
+    // Keep the partial files after merging, e.g. to inspect a failed merge.
+    bool keep_partials = false;
+};
+
+// One worker's contiguous range of a sample, as entries [begin, end) of Hub::sample(rec, begin, end);
+// end = 0 runs to the last entry so the shards of a sample always cover it exactly.
+struct Shard {
+    std::size_t entry;
+    std::uint64_t begin, end;
+};
+
+// Splits the samples into n contiguous entry ranges of near-equal size, counted as Hub::sample
+// counts them: over the entries the entry index selects, when it applies (see Hub::entries).
+std::vector<std::vector<Shard>> plan_shards(const Hub& hub, const std::vector<const Entry*>& entries, unsigned n);
+
+// Receives one pointer per input entry, aligned with the input: the worker's copy of the sample
+// restricted to its range, or nullptr when the worker has no range of it. Detector variations are
+// not sharded and are absent from the copies.
+using ShardJob = std::function<void(const std::vector<const Entry*>& entries, Partial& out)>;
+
+// Runs job in forked worker processes, each over its shard of the samples, and merges the partial
+// results they write in worker order, so the result does not depend on scheduling. Workers are
+// single-threaded: fork does not carry ROOT's implicit-MT pool, so this throws when it is enabled.
+// A failed worker makes the call throw after all workers have finished.
+Partial run_sharded(const Hub& hub, const std::vector<const Entry*>& entries, const ShardJob& job,
+                    const ShardOptions& opt = {});
+
+}
+}
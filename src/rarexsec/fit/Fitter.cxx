@@ -1,4 +1,7 @@
 #include "rarexsec/fit/Fitter.h"
+#include "rarexsec/fit/Likelihood.h"
+#include "rarexsec/fit/NativeMinimizer.h"
+#include "rarexsec/fit/ThreadPool.h"
 
 #include "Math/Factory.h"
 #include "Math/Functor.h"
@@ -6,6 +9,11 @@
 #include "TH1.h"
 #include "TH1D.h"
 
+#include <atomic>
+#include <future>
+#include <iostream>
+#include <thread>
+
 namespace rarexsec::internal::fit {
 
 Fitter::Fitter(const std::string &signal_process_label) : signal_label_(signal_process_label) {}
@@ -17,13 +25,22 @@ Fitter::Fitter(const Fitter &o)
       norm_nuis_(o.norm_nuis_),
       shape_nuis_(o.shape_nuis_),
       signal_label_(o.signal_label_),
+      pois_(o.pois_),
+      signal_poi_(o.signal_poi_),
       sigma_ref_pb_(o.sigma_ref_pb_),
       mu_lo_(o.mu_lo_),
       mu_hi_(o.mu_hi_),
       eps_(o.eps_),
+      asym_errors_(o.asym_errors_),
+      asym_tol_(o.asym_tol_),
+      debug_(o.debug_),
       n_pars_(o.n_pars_),
+      n_poi_(o.n_poi_),
+      poi_pars_(o.poi_pars_),
       par_names_(o.par_names_),
-      par_is_norm_(o.par_is_norm_) {}
+      par_is_norm_(o.par_is_norm_),
+      model_(o.model_),
+      pool_(o.pool_) {}
 
 Fitter &Fitter::operator=(const Fitter &o) {
   if (this == &o) return *this;
@@ -33,13 +50,22 @@ Fitter &Fitter::operator=(const Fitter &o) {
   norm_nuis_ = o.norm_nuis_;
   shape_nuis_ = o.shape_nuis_;
   signal_label_ = o.signal_label_;
+  pois_ = o.pois_;
+  signal_poi_ = o.signal_poi_;
   sigma_ref_pb_ = o.sigma_ref_pb_;
   mu_lo_ = o.mu_lo_;
   mu_hi_ = o.mu_hi_;
   eps_ = o.eps_;
+  asym_errors_ = o.asym_errors_;
+  asym_tol_ = o.asym_tol_;
+  debug_ = o.debug_;
   n_pars_ = o.n_pars_;
+  n_poi_ = o.n_poi_;
+  poi_pars_ = o.poi_pars_;
   par_names_ = o.par_names_;
   par_is_norm_ = o.par_is_norm_;
+  model_ = o.model_;
+  pool_ = o.pool_;
   return *this;
 }
 
@@ -150,8 +176,46 @@ void Fitter::set_mu_bounds(double lo, double hi) {
   mu_hi_ = hi;
 }
 
+void Fitter::add_poi(const std::string &poi, double sigma_ref_pb, double lo, double hi) {
+  if (!(lo < hi)) throw std::invalid_argument("add_poi: lo < hi required for " + poi);
+  for (const auto &p : pois_)
+    if (p.name == poi) throw std::runtime_error("POI already exists: " + poi);
+  if (norm_nuis_.count(poi) || shape_nuis_.count(poi)) throw std::runtime_error("POI clashes with a nuisance: " + poi);
+  pois_.push_back(Poi{poi, sigma_ref_pb, lo, hi});
+}
+
+void Fitter::set_poi(const std::string &process, const std::string &poi) {
+  auto it = std::find_if(pois_.begin(), pois_.end(), [&](const Poi &p) { return p.name == poi; });
+  if (it == pois_.end()) throw std::runtime_error("set_poi: unknown POI " + poi);
+  signal_poi_[process] = poi;
+  for (auto &kv : channels_) {
+    auto pit = kv.second.processes.find(process);
+    if (pit != kv.second.processes.end()) pit->second.is_signal = true;
+  }
+}
+
+std::vector<std::string> Fitter::poi_names() const {
+  std::vector<std::string> out;
+  for (const auto &p : effective_pois_()) out.push_back(p.name);
+  return out;
+}
+
 void Fitter::set_yield_floor(double eps) { eps_ = (eps > 0.0 ? eps : 1e-12); }
 
+void Fitter::set_asymmetric_errors(bool on, double tolerance) {
+  asym_errors_ = on;
+  asym_tol_ = (tolerance > 0.0 ? tolerance : 1e-3);
+}
+
+void Fitter::set_debug(bool on) { debug_ = on; }
+
+void Fitter::set_threads(unsigned nthreads) {
+  if (nthreads == 1)
+    pool_.reset();
+  else
+    pool_ = std::make_shared<ThreadPool>(nthreads);
+}
+
 void Fitter::add_channel(const std::string &channel, const TH1 *h_data) {
   if (!h_data) throw std::invalid_argument("add_channel: data histogram is null");
   if (channels_.count(channel)) throw std::runtime_error("channel already exists: " + channel);
@@ -173,7 +237,7 @@ void Fitter::add_process(const std::string &channel, const std::string &process,
   ensure_same_binning_(*it->second.data, *h, "add_process(" + channel + "," + process + ")");
   Process p;
   p.name = process;
-  p.is_signal = (is_signal || process == signal_label_);
+  p.is_signal = (is_signal || process == signal_label_ || signal_poi_.count(process));
   p.nominal = std::move(h);
   it->second.processes.emplace(process, std::move(p));
   all_channels_.insert(channel);
@@ -184,7 +248,7 @@ void Fitter::mark_signal_process(const std::string &process) {
   signal_label_ = process;
   for (auto &kv : channels_) {
     for (auto &pkv : kv.second.processes) {
-      pkv.second.is_signal = (pkv.first == signal_label_);
+      pkv.second.is_signal = (pkv.first == signal_label_ || signal_poi_.count(pkv.first));
     }
   }
 }
@@ -233,19 +297,8 @@ Fitter::FitResult Fitter::fit(const std::string &minimizer, const std::string &a
   if (channels_.empty()) throw std::runtime_error("fit: no channels added");
   if (!has_any_signal_()) throw std::runtime_error("fit: no signal process marked");
   build_parameter_indexing_();
-  std::unique_ptr<ROOT::Math::Minimizer> min{ROOT::Math::Factory::CreateMinimizer(minimizer.c_str(),
-                                                                                 algo.c_str())};
-  if (!min) throw std::runtime_error("failed to create ROOT::Math::Minimizer");
-  min->SetPrintLevel(verbose ? 1 : 0);
-  min->SetStrategy(1);
-  min->SetMaxFunctionCalls(100000);
-  min->SetMaxIterations(100000);
-  min->SetTolerance(1e-4);
-  ROOT::Math::Functor f(this, &Fitter::nll_, n_pars_);
-  min->SetFunction(f);
-  min->SetLimitedVariable(0, "mu", std::clamp(guess_mu_(), mu_lo_, mu_hi_), 0.1, mu_lo_, mu_hi_);
-  for (std::size_t i = 1; i < n_pars_; ++i)
-    min->SetVariable(static_cast<int>(i), par_names_[i].c_str(), 0.0, 0.1);
+  auto min = make_minimizer_(minimizer, algo, verbose, 100000);
+  define_variables_(*min, start_point_());
   bool ok = min->Minimize();
   FitResult fr;
   fr.status = min->Status();
@@ -255,13 +308,66 @@ Fitter::FitResult Fitter::fit(const std::string &minimizer, const std::string &a
   if (ok && xs) {
     fr.mu = xs[0];
     fr.mu_err_sym = (xe ? xe[0] : std::numeric_limits<double>::quiet_NaN());
-    for (std::size_t i = 1; i < n_pars_; ++i) {
+    for (std::size_t i = 0; i < n_poi_; ++i) {
+      fr.poi_names.push_back(par_names_[i]);
+      fr.poi_values.push_back(xs[i]);
+    }
+    for (std::size_t i = n_poi_; i < n_pars_; ++i) {
       fr.nuis_values[par_names_[i]] = xs[i];
       if (xe) fr.nuis_errors[par_names_[i]] = xe[i];
     }
   }
-  min->Hesse();
-  if (min->Errors()) fr.mu_err_sym = min->Errors()[0];
+  std::vector<double> cov;
+  const bool analytic = (ok && xs && analytic_covariance_(xs, cov));
+  if (!analytic || debug_) {
+    min->Hesse();
+    const double *he = min->Errors();
+    if (he && !analytic && ok && xs) {
+      cov.assign(n_pars_ * n_pars_, 0.0);
+      for (std::size_t i = 0; i < n_pars_; ++i)
+        for (std::size_t j = 0; j < n_pars_; ++j) cov[i * n_pars_ + j] = min->CovMatrix(i, j);
+      for (std::size_t i = 0; i < n_pars_; ++i)
+        if (!(cov[i * n_pars_ + i] > 0.0)) cov[i * n_pars_ + i] = he[i] * he[i];
+    }
+    if (he && analytic) {
+      double worst = 0.0;
+      std::size_t iworst = 0;
+      for (std::size_t i = 0; i < n_pars_; ++i) {
+        const double ea = std::sqrt(cov[i * n_pars_ + i]);
+        const double rel = std::abs(ea - he[i]) / std::max(std::abs(he[i]), 1e-12);
+        if (rel > worst) {
+          worst = rel;
+          iworst = i;
+        }
+      }
+      std::clog << "[Fitter] analytic vs numerical Hesse: max relative error difference " << worst << " ("
+                << par_names_[iworst] << ": " << std::sqrt(cov[iworst * n_pars_ + iworst]) << " vs "
+                << he[iworst] << ")" << std::endl;
+    }
+    if (!analytic && debug_)
+      std::clog << "[Fitter] analytic Hessian not positive definite, using numerical Hesse" << std::endl;
+  }
+  if (cov.size() == n_pars_ * n_pars_) {
+    fr.mu_err_sym = std::sqrt(cov[0]);
+    fr.poi_errors.resize(n_poi_);
+    fr.poi_covariance.resize(n_poi_ * n_poi_);
+    for (std::size_t i = 0; i < n_poi_; ++i) {
+      fr.poi_errors[i] = std::sqrt(cov[i * n_pars_ + i]);
+      for (std::size_t j = 0; j < n_poi_; ++j) fr.poi_covariance[i * n_poi_ + j] = cov[i * n_pars_ + j];
+    }
+    for (std::size_t i = n_poi_; i < n_pars_; ++i) fr.nuis_errors[par_names_[i]] = std::sqrt(cov[i * n_pars_ + i]);
+  }
+  if (asym_errors_ && ok && xs) {
+    const std::vector<double> x_hat(xs, xs + n_pars_);
+    const double step = (std::isfinite(fr.mu_err_sym) && fr.mu_err_sym > 0.0)
+                            ? fr.mu_err_sym
+                            : 0.1 * std::max(1.0, std::abs(fr.mu));
+    auto min_lo = make_minimizer_(minimizer, algo, false, 100000);
+    auto min_hi = make_minimizer_(minimizer, algo, false, 100000);
+    auto lo = std::async(std::launch::async, [&] { return find_crossing_(*min_lo, x_hat, fr.nll, step, -1); });
+    fr.mu_err_hi = find_crossing_(*min_hi, x_hat, fr.nll, step, +1);
+    fr.mu_err_lo = lo.get();
+  }
   return fr;
 }
 
@@ -272,21 +378,9 @@ std::vector<std::pair<double, double>> Fitter::scan_delta_nll(double mu_min, dou
   if (mu_min >= mu_max) throw std::invalid_argument("scan_delta_nll: mu_min < mu_max required");
   if (npts < 3) throw std::invalid_argument("scan_delta_nll: npts >= 3 required");
   build_parameter_indexing_();
-  std::unique_ptr<ROOT::Math::Minimizer> min{ROOT::Math::Factory::CreateMinimizer(minimizer.c_str(),
-                                                                                 algo.c_str())};
-  if (!min) throw std::runtime_error("failed to create ROOT::Math::Minimizer");
-  min->SetPrintLevel(verbose ? 1 : 0);
-  min->SetStrategy(1);
-  min->SetMaxFunctionCalls(200000);
-  min->SetMaxIterations(200000);
-  min->SetTolerance(1e-4);
-  ROOT::Math::Functor f(this, &Fitter::nll_, n_pars_);
-  min->SetFunction(f);
-  double mu0 = std::clamp(guess_mu_(), mu_lo_, mu_hi_);
-  min->SetLimitedVariable(0, "mu", mu0, 0.1, mu_lo_, mu_hi_);
+  auto min = make_minimizer_(minimizer, algo, verbose, 200000);
+  define_variables_(*min, start_point_());
   min->FixVariable(0);
-  for (std::size_t i = 1; i < n_pars_; ++i)
-    min->SetVariable(static_cast<int>(i), par_names_[i].c_str(), 0.0, 0.1);
   double nll_min_global = get_nll_min_free_mu_(minimizer, algo, verbose);
   std::vector<std::pair<double, double>> out;
   out.reserve(npts);
@@ -301,9 +395,144 @@ std::vector<std::pair<double, double>> Fitter::scan_delta_nll(double mu_min, dou
   return out;
 }
 
-double Fitter::cross_section_pb(const FitResult &fr) const { return fr.mu * sigma_ref_pb_; }
+Fitter::Sensitivity Fitter::expected_sensitivity(double mu_asimov, int scan_points, double scan_width,
+                                                 const std::string &minimizer, const std::string &algo) {
+  if (channels_.empty()) throw std::runtime_error("expected_sensitivity: no channels added");
+  if (!has_any_signal_()) throw std::runtime_error("expected_sensitivity: no signal process marked");
+  if (scan_points != 0 && scan_points < 3) throw std::invalid_argument("expected_sensitivity: scan_points >= 3 required");
+  build_parameter_indexing_();
+  std::vector<double> x0(n_pars_, 0.0);
+  for (std::size_t i = 0; i < n_poi_; ++i) {
+    if (mu_asimov < poi_pars_[i].lo || mu_asimov > poi_pars_[i].hi)
+      throw std::invalid_argument("expected_sensitivity: mu_asimov outside the bounds of " + poi_pars_[i].name);
+    x0[i] = mu_asimov;
+  }
+
+  // evaluate against an Asimov copy of the compiled model, restoring the observed one on exit
+  auto model = std::make_shared<Likelihood>(*model_);
+  model->set_data(model_->expected(x0.data()));
+  struct RestoreModel {
+    std::shared_ptr<const Likelihood> &slot;
+    std::shared_ptr<const Likelihood> saved;
+    ~RestoreModel() { slot = std::move(saved); }
+  } restore{model_, model_};
+  model_ = model;
+
+  Sensitivity out;
+  out.mu_asimov = mu_asimov;
+  std::vector<double> cov;
+  if (!analytic_covariance_(x0.data(), cov))
+    throw std::runtime_error("expected_sensitivity: Fisher information is singular");
+  out.mu_err = std::sqrt(cov[0]);
+  out.poi_errors.resize(n_poi_);
+  out.poi_covariance.resize(n_poi_ * n_poi_);
+  for (std::size_t i = 0; i < n_poi_; ++i) {
+    out.poi_names.push_back(par_names_[i]);
+    out.poi_errors[i] = std::sqrt(cov[i * n_pars_ + i]);
+    for (std::size_t j = 0; j < n_poi_; ++j) out.poi_covariance[i * n_poi_ + j] = cov[i * n_pars_ + j];
+  }
+
+  if (scan_points >= 3) {
+    const double nll_hat = model->nll(x0.data()) / 2.0;
+    const double lo = std::max(poi_pars_[0].lo, mu_asimov - scan_width * out.mu_err);
+    const double hi = std::min(poi_pars_[0].hi, mu_asimov + scan_width * out.mu_err);
+    auto min = make_minimizer_(minimizer, algo, false, 200000);
+    std::vector<double> x = x0;
+    out.scan.reserve(scan_points);
+    for (int ip = 0; ip < scan_points; ++ip) {
+      const double mu = lo + (hi - lo) * (double(ip) / double(scan_points - 1));
+      const double nll = profile_nll_(*min, mu, x);
+      out.scan.emplace_back(mu, std::max(0.0, nll - nll_hat));
+    }
+  }
+  return out;
+}
+
+std::vector<Fitter::Impact> Fitter::impacts(const FitResult &nominal, const std::string &minimizer,
+                                            const std::string &algo, int nthreads) {
+  if (!std::isfinite(nominal.mu)) throw std::invalid_argument("impacts: nominal fit result has no mu");
+  build_parameter_indexing_();
+  std::vector<double> x_hat(n_pars_, 0.0);
+  std::vector<double> sigma(n_pars_, 1.0);
+  x_hat[0] = nominal.mu;
+  if (nominal.poi_values.size() == n_poi_) std::copy(nominal.poi_values.begin(), nominal.poi_values.end(), x_hat.begin());
+  for (std::size_t i = n_poi_; i < n_pars_; ++i) {
+    auto v = nominal.nuis_values.find(par_names_[i]);
+    if (v == nominal.nuis_values.end())
+      throw std::invalid_argument("impacts: nominal fit result lacks " + par_names_[i]);
+    x_hat[i] = v->second;
+    auto e = nominal.nuis_errors.find(par_names_[i]);
+    if (e != nominal.nuis_errors.end() && std::isfinite(e->second) && e->second > 0.0) sigma[i] = e->second;
+  }
+
+  const std::size_t n_nuis = n_pars_ - n_poi_;
+  std::vector<double> shift(4 * n_nuis, std::numeric_limits<double>::quiet_NaN());
+  int nt = nthreads > 0 ? nthreads : static_cast<int>(std::thread::hardware_concurrency());
+  nt = std::max(1, std::min<int>(nt, static_cast<int>(shift.size())));
+
+  // minimizer creation goes through the plugin manager, so do it here rather than on the workers
+  std::vector<std::unique_ptr<ROOT::Math::Minimizer>> mins;
+  for (int t = 0; t < nt; ++t) mins.push_back(make_minimizer_(minimizer, algo, false, 100000));
+
+  std::atomic<std::size_t> next{0};
+  auto worker = [&](ROOT::Math::Minimizer &min) {
+    for (std::size_t k = next++; k < shift.size(); k = next++) {
+      const std::size_t par = n_poi_ + k / 4;
+      const int kind = static_cast<int>(k % 4);
+      const double width = (kind < 2 ? sigma[par] : 1.0);
+      const double value = x_hat[par] + ((kind % 2) == 0 ? width : -width);
+      shift[k] = fixed_nuisance_fit_(min, par, value, x_hat) - nominal.mu;
+    }
+  };
+  std::vector<std::thread> pool;
+  for (int t = 1; t < nt; ++t) pool.emplace_back(worker, std::ref(*mins[t]));
+  worker(*mins[0]);
+  for (auto &th : pool) th.join();
+
+  std::vector<Impact> out(n_nuis);
+  for (std::size_t i = 0; i < n_nuis; ++i) {
+    Impact &im = out[i];
+    im.name = par_names_[n_poi_ + i];
+    im.theta = x_hat[n_poi_ + i];
+    im.theta_err = sigma[n_poi_ + i];
+    im.post_fit_up = shift[4 * i];
+    im.post_fit_down = shift[4 * i + 1];
+    im.pre_fit_up = shift[4 * i + 2];
+    im.pre_fit_down = shift[4 * i + 3];
+  }
+  auto rank = [](const Impact &im) {
+    const double a = std::max(std::abs(im.post_fit_up), std::abs(im.post_fit_down));
+    return std::isfinite(a) ? a : -1.0;
+  };
+  std::stable_sort(out.begin(), out.end(), [&](const Impact &a, const Impact &b) { return rank(a) > rank(b); });
+  return out;
+}
+
+double Fitter::cross_section_pb(const FitResult &fr) const { return fr.mu * effective_pois_().front().sigma_ref_pb; }
+
+double Fitter::cross_section_err_sym_pb(const FitResult &fr) const {
+  return fr.mu_err_sym * effective_pois_().front().sigma_ref_pb;
+}
+
+std::vector<double> Fitter::cross_sections_pb(const FitResult &fr) const {
+  const auto pois = effective_pois_();
+  if (fr.poi_values.size() != pois.size()) throw std::invalid_argument("cross_sections_pb: POI count mismatch");
+  std::vector<double> out(pois.size());
+  for (std::size_t i = 0; i < pois.size(); ++i) out[i] = fr.poi_values[i] * pois[i].sigma_ref_pb;
+  return out;
+}
 
-double Fitter::cross_section_err_sym_pb(const FitResult &fr) const { return fr.mu_err_sym * sigma_ref_pb_; }
+std::vector<double> Fitter::cross_section_covariance_pb2(const FitResult &fr) const {
+  const auto pois = effective_pois_();
+  const std::size_t n = pois.size();
+  if (fr.poi_covariance.size() != n * n)
+    throw std::invalid_argument("cross_section_covariance_pb2: POI covariance missing or mismatched");
+  std::vector<double> out(n * n);
+  for (std::size_t i = 0; i < n; ++i)
+    for (std::size_t j = 0; j < n; ++j)
+      out[i * n + j] = fr.poi_covariance[i * n + j] * pois[i].sigma_ref_pb * pois[j].sigma_ref_pb;
+  return out;
+}
 
 TH1D *Fitter::clone_as_th1d_(const TH1 *h, const std::string &new_name) {
   if (!h) return nullptr;
@@ -345,6 +574,7 @@ bool Fitter::has_any_signal_() const {
 }
 
 void Fitter::clear_() {
+  model_.reset();
   channels_.clear();
   norm_nuis_.clear();
   shape_nuis_.clear();
@@ -352,14 +582,19 @@ void Fitter::clear_() {
   all_processes_.clear();
   par_names_.clear();
   par_is_norm_.clear();
+  poi_pars_.clear();
   n_pars_ = 0;
 }
 
 void Fitter::build_parameter_indexing_() {
   par_names_.clear();
   par_is_norm_.clear();
-  par_names_.push_back("mu");
-  par_is_norm_.push_back(0);
+  poi_pars_ = effective_pois_();
+  n_poi_ = poi_pars_.size();
+  for (const auto &p : poi_pars_) {
+    par_names_.push_back(p.name);
+    par_is_norm_.push_back(0);
+  }
   for (auto &kv : norm_nuis_) {
     kv.second.index = static_cast<int>(par_names_.size());
     par_names_.push_back("theta_norm_" + kv.first);
@@ -371,6 +606,70 @@ void Fitter::build_parameter_indexing_() {
     par_is_norm_.push_back(2);
   }
   n_pars_ = par_names_.size();
+  compile_();
+}
+
+void Fitter::compile_() {
+  std::vector<double> lo, hi;
+  for (const auto &p : poi_pars_) {
+    lo.push_back(p.lo);
+    hi.push_back(p.hi);
+  }
+  auto model = std::make_shared<Likelihood>(n_pars_, lo, hi, eps_);
+  model->set_thread_pool(pool_);
+  for (auto const &ckv : channels_) {
+    const Channel &ch = ckv.second;
+    std::vector<double> data(ch.nbins);
+    for (int ib = 1; ib <= ch.nbins; ++ib) data[ib - 1] = ch.data->GetBinContent(ib);
+    const int ic = model->add_channel(ch.name, data);
+    for (auto const &pkv : ch.processes) {
+      const Process &proc = pkv.second;
+      const CPKey key{ch.name, proc.name};
+      Likelihood::Term t;
+      t.channel = ic;
+      if (proc.is_signal) {
+        auto pit = signal_poi_.find(proc.name);
+        if (pit == signal_poi_.end()) {
+          if (!pois_.empty()) throw std::runtime_error("signal process " + proc.name + " is not bound to a POI");
+          t.poi = 0;
+        } else {
+          for (std::size_t i = 0; i < n_poi_; ++i)
+            if (poi_pars_[i].name == pit->second) t.poi = static_cast<int>(i);
+        }
+      }
+      t.nominal.resize(ch.nbins);
+      for (int ib = 1; ib <= ch.nbins; ++ib) t.nominal[ib - 1] = proc.nominal->GetBinContent(ib);
+      for (auto const &snkv : shape_nuis_) {
+        auto it = snkv.second.updown.find(key);
+        if (it == snkv.second.updown.end()) continue;
+        Likelihood::Shape sh;
+        sh.par = snkv.second.index;
+        sh.delta.resize(ch.nbins);
+        for (int ib = 1; ib <= ch.nbins; ++ib)
+          sh.delta[ib - 1] = 0.5 * (it->second.first->GetBinContent(ib) - it->second.second->GetBinContent(ib));
+        t.shapes.push_back(std::move(sh));
+      }
+      for (auto const &nnkv : norm_nuis_) {
+        auto it = nnkv.second.frac.find(key);
+        if (it == nnkv.second.frac.end()) continue;
+        t.norms.push_back(Likelihood::Norm{nnkv.second.index, it->second, nnkv.second.log_normal});
+      }
+      model->add_term(std::move(t));
+    }
+  }
+  model_ = std::move(model);
+}
+
+bool Fitter::analytic_covariance_(const double *x, std::vector<double> &cov) const {
+  if (!model_) return false;
+  model_->hessian(x, cov);
+  if (!Likelihood::invert_spd(cov, n_pars_)) {
+    cov.clear();
+    return false;
+  }
+  // nll_ is -2 lnL, so the covariance is 2 H^-1
+  for (double &c : cov) c *= 2.0;
+  return true;
 }
 
 double Fitter::guess_mu_() const {
@@ -389,81 +688,136 @@ double Fitter::guess_mu_() const {
   }
   double mu = (s > 0.0 ? (d - b) / s : 1.0);
   if (!std::isfinite(mu)) mu = 1.0;
-  return std::clamp(mu, mu_lo_, mu_hi_);
+  return mu;
 }
 
-double Fitter::nll_(const double *x) const {
-  const double mu = std::clamp(x[0], mu_lo_, mu_hi_);
-  double logl = 0.0;
-  for (auto const &kv : norm_nuis_) {
-    const double th = x[kv.second.index];
-    logl += -0.5 * th * th;
-  }
-  for (auto const &kv : shape_nuis_) {
-    const double th = x[kv.second.index];
-    logl += -0.5 * th * th;
-  }
-  for (auto const &ckv : channels_) {
-    const Channel &ch = ckv.second;
-    for (int ib = 1; ib <= ch.nbins; ++ib) {
-      double nu = 0.0;
-      for (auto const &pkv : ch.processes) {
-        const Process &proc = pkv.second;
-        double y = proc.nominal->GetBinContent(ib);
-        for (auto const &snkv : shape_nuis_) {
-          const ShapeNuisance &sn = snkv.second;
-          auto it = sn.updown.find(CPKey{ch.name, proc.name});
-          if (it != sn.updown.end()) {
-            const double th = x[sn.index];
-            const double yup = it->second.first->GetBinContent(ib);
-            const double ydn = it->second.second->GetBinContent(ib);
-            const double delta = 0.5 * (yup - ydn);
-            y += th * delta;
-          }
-        }
-        if (y < 0.0) y = 0.0;
-        double scale = 1.0;
-        for (auto const &nnkv : norm_nuis_) {
-          const NormNuisance &nn = nnkv.second;
-          auto it = nn.frac.find(CPKey{ch.name, proc.name});
-          if (it != nn.frac.end()) {
-            const double th = x[nn.index];
-            const double f = it->second;
-            if (nn.log_normal)
-              scale *= std::exp(std::log(1.0 + f) * th);
-            else
-              scale *= std::max(0.0, 1.0 + f * th);
-          }
-        }
-        const double term = (proc.is_signal ? mu * scale * y : scale * y);
-        nu += term;
-      }
-      const double nobs = ch.data->GetBinContent(ib);
-      const double ex = (nu > eps_ ? nu : eps_);
-      if (nobs > 0.0)
-        logl += nobs * std::log(ex) - ex;
-      else
-        logl += -ex;
-    }
+std::vector<Fitter::Poi> Fitter::effective_pois_() const {
+  if (!pois_.empty()) return pois_;
+  return {Poi{"mu", sigma_ref_pb_, mu_lo_, mu_hi_}};
+}
+
+std::vector<double> Fitter::start_point_() const {
+  std::vector<double> x(n_pars_, 0.0);
+  const double mu = guess_mu_();
+  for (std::size_t i = 0; i < n_poi_; ++i) x[i] = std::clamp(mu, poi_pars_[i].lo, poi_pars_[i].hi);
+  return x;
+}
+
+void Fitter::define_variables_(ROOT::Math::Minimizer &min, const std::vector<double> &x) const {
+  for (std::size_t i = 0; i < n_poi_; ++i) {
+    const Poi &p = poi_pars_[i];
+    min.SetLimitedVariable(static_cast<int>(i), p.name.c_str(), std::clamp(x[i], p.lo, p.hi), 0.1, p.lo, p.hi);
   }
-  return -2.0 * logl;
+  for (std::size_t i = n_poi_; i < n_pars_; ++i)
+    min.SetVariable(static_cast<int>(i), par_names_[i].c_str(), x[i], 0.1);
 }
 
+double Fitter::nll_(const double *x) const { return model_->nll(x); }
+
 double Fitter::get_nll_min_free_mu_(const std::string &minimizer, const std::string &algo, bool verbose) {
-  std::unique_ptr<ROOT::Math::Minimizer> min{ROOT::Math::Factory::CreateMinimizer(minimizer.c_str(),
-                                                                                 algo.c_str())};
+  auto min = make_minimizer_(minimizer, algo, verbose, 100000);
+  define_variables_(*min, start_point_());
+  min->Minimize();
+  return min->MinValue() / 2.0;
+}
+
+std::unique_ptr<ROOT::Math::Minimizer> Fitter::make_minimizer_(const std::string &minimizer, const std::string &algo,
+                                                               bool verbose, unsigned max_calls) const {
+  std::unique_ptr<ROOT::Math::Minimizer> min;
+  if (minimizer == "Native") {
+    auto native = std::make_unique<NativeMinimizer>(algo);
+    std::shared_ptr<const Likelihood> model = model_;
+    native->set_gradient([model](const double *x, double *g) { return model->nll_gradient(x, g); });
+    native->set_hessian([model](const double *x, std::vector<double> &H) { model->hessian(x, H); });
+    min = std::move(native);
+  } else {
+    min.reset(ROOT::Math::Factory::CreateMinimizer(minimizer.c_str(), algo.c_str()));
+  }
+  if (!min) throw std::runtime_error("failed to create ROOT::Math::Minimizer");
   min->SetPrintLevel(verbose ? 1 : 0);
   min->SetStrategy(1);
-  min->SetMaxFunctionCalls(100000);
-  min->SetMaxIterations(100000);
+  min->SetMaxFunctionCalls(max_calls);
+  min->SetMaxIterations(max_calls);
   min->SetTolerance(1e-4);
   ROOT::Math::Functor f(this, &Fitter::nll_, n_pars_);
   min->SetFunction(f);
-  min->SetLimitedVariable(0, "mu", std::clamp(guess_mu_(), mu_lo_, mu_hi_), 0.1, mu_lo_, mu_hi_);
-  for (std::size_t i = 1; i < n_pars_; ++i)
-    min->SetVariable(static_cast<int>(i), par_names_[i].c_str(), 0.0, 0.1);
-  min->Minimize();
-  return min->MinValue() / 2.0;
+  return min;
+}
+
+double Fitter::profile_nll_(ROOT::Math::Minimizer &min, double mu, std::vector<double> &x) const {
+  define_variables_(min, x);
+  min.SetFixedVariable(0, par_names_[0].c_str(), mu);
+  min.Minimize();
+  const double *xs = min.X();
+  if (xs) std::copy(xs, xs + n_pars_, x.begin());
+  x[0] = mu;
+  return min.MinValue() / 2.0;
+}
+
+double Fitter::fixed_nuisance_fit_(ROOT::Math::Minimizer &min, std::size_t par, double value,
+                                   std::vector<double> x) const {
+  x[par] = value;
+  define_variables_(min, x);
+  min.SetFixedVariable(static_cast<int>(par), par_names_[par].c_str(), value);
+  if (!min.Minimize() || !min.X()) return std::numeric_limits<double>::quiet_NaN();
+  return min.X()[0];
+}
+
+double Fitter::find_crossing_(ROOT::Math::Minimizer &min, const std::vector<double> &x_hat, double nll_hat,
+                              double step, int side) const {
+  constexpr double kTarget = 0.5;
+  constexpr int kMaxExpand = 12;
+  constexpr int kMaxIter = 40;
+  const double mu_hat = x_hat[0];
+  const double bound = (side > 0 ? poi_pars_[0].hi : poi_pars_[0].lo);
+  if (bound == mu_hat) return 0.0;
+
+  std::vector<double> x_in = x_hat;
+  double a = mu_hat, qa = -kTarget;
+  double b = mu_hat, qb = -kTarget;
+  std::vector<double> x_b = x_hat;
+  double h = step;
+  for (int it = 0; it <= kMaxExpand; ++it, h *= 2.0) {
+    const double mu = (side > 0 ? std::min(mu_hat + h, bound) : std::max(mu_hat - h, bound));
+    x_b = x_in;
+    const double q = profile_nll_(min, mu, x_b) - nll_hat - kTarget;
+    if (!std::isfinite(q)) return std::numeric_limits<double>::quiet_NaN();
+    b = mu;
+    qb = q;
+    if (qb >= 0.0) break;
+    a = b;
+    qa = qb;
+    x_in = x_b;
+    if (b == bound) return std::abs(bound - mu_hat);
+  }
+  if (qb < 0.0) return std::numeric_limits<double>::quiet_NaN();
+
+  const double tol = asym_tol_ * std::max(step, 1e-6);
+  int last = 0;
+  for (int it = 0; it < kMaxIter && std::abs(b - a) > tol; ++it) {
+    double mu = (a * qb - b * qa) / (qb - qa);
+    if (!(mu > std::min(a, b) && mu < std::max(a, b))) mu = 0.5 * (a + b);
+    std::vector<double> x_m = x_in;
+    const double q = profile_nll_(min, mu, x_m) - nll_hat - kTarget;
+    if (!std::isfinite(q)) break;
+    if (std::abs(q) < 1e-2 * asym_tol_) {
+      a = b = mu;
+      break;
+    }
+    if (q < 0.0) {
+      a = mu;
+      qa = q;
+      x_in = x_m;
+      if (last < 0) qb *= 0.5;
+      last = -1;
+    } else {
+      b = mu;
+      qb = q;
+      if (last > 0) qa *= 0.5;
+      last = +1;
+    }
+  }
+  return std::abs(0.5 * (a + b) - mu_hat);
 }
 
 } // namespace rarexsec::internal::fit
@@ -18,8 +18,15 @@
 class TH1;
 class TH1D;
 
+namespace ROOT::Math {
+class Minimizer;
+}
+
 namespace rarexsec::internal::fit {
 
+class Likelihood;
+class ThreadPool;
+
 class Fitter {
 public:
   struct FitResult {
@@ -31,6 +38,35 @@ public:
     double mu_err_hi = std::numeric_limits<double>::quiet_NaN();
     std::map<std::string, double> nuis_values;
     std::map<std::string, double> nuis_errors;
+    // One entry per parameter of interest in declaration order (mu is the first); row-major covariance.
+    std::vector<std::string> poi_names;
+    std::vector<double> poi_values;
+    std::vector<double> poi_errors;
+    std::vector<double> poi_covariance;
+  };
+
+  // Shift of mu when one nuisance is fixed at its post-fit (theta_hat +/- sigma_hat) or pre-fit
+  // (theta_hat +/- 1) variation and all other parameters are refitted.
+  struct Impact {
+    std::string name;
+    double theta = std::numeric_limits<double>::quiet_NaN();
+    double theta_err = std::numeric_limits<double>::quiet_NaN();
+    double post_fit_up = std::numeric_limits<double>::quiet_NaN();
+    double post_fit_down = std::numeric_limits<double>::quiet_NaN();
+    double pre_fit_up = std::numeric_limits<double>::quiet_NaN();
+    double pre_fit_down = std::numeric_limits<double>::quiet_NaN();
+  };
+
+  // Expected precision on the Asimov dataset of the nominal model (nuisances at 0, every POI at
+  // mu_asimov). Errors come from the inverse Fisher information; scan holds (mu, delta nll) pairs of
+  // the optional profiled scan, in the convention of scan_delta_nll.
+  struct Sensitivity {
+    double mu_asimov = std::numeric_limits<double>::quiet_NaN();
+    double mu_err = std::numeric_limits<double>::quiet_NaN();
+    std::vector<std::string> poi_names;
+    std::vector<double> poi_errors;
+    std::vector<double> poi_covariance;
+    std::vector<std::pair<double, double>> scan;
   };
 
   struct CPKey {
@@ -49,7 +85,22 @@ public:
   void set_sigma_ref(double sigma_ref_pb);
   double sigma_ref() const;
   void set_mu_bounds(double lo, double hi);
+  // Declares a signal-strength parameter, e.g. one per truth bin, and binds signal processes to it.
+  // With no POI declared the model has the single "mu" (set_mu_bounds/set_sigma_ref) scaling every
+  // signal process; once declared, every signal process must be bound with set_poi.
+  void add_poi(const std::string &poi, double sigma_ref_pb = 1.0, double lo = 0.0, double hi = 10.0);
+  void set_poi(const std::string &process, const std::string &poi);
+  std::vector<std::string> poi_names() const;
   void set_yield_floor(double eps);
+  // When enabled, fit() also fills mu_err_lo / mu_err_hi (as positive distances from mu) from the
+  // Delta(-2lnL) = 1 crossings of the profiled likelihood, searching both sides concurrently.
+  void set_asymmetric_errors(bool on, double tolerance = 1e-3);
+  // Uncertainties come from the inverse of the analytic Hessian of the compiled model. In debug
+  // mode fit() also runs the numerical Hesse and reports the largest relative disagreement.
+  void set_debug(bool on);
+  // Evaluates the likelihood on a persistent pool of nthreads (0 = hardware concurrency, 1 = serial).
+  // Results do not depend on the thread count.
+  void set_threads(unsigned nthreads);
 
   void add_channel(const std::string &channel, const TH1 *h_data);
   void add_process(const std::string &channel, const std::string &process, const TH1 *h_nominal,
@@ -64,6 +115,8 @@ public:
   void set_shape_effect(const std::string &name, const std::string &channel, const std::string &process,
                         const TH1 *h_up, const TH1 *h_down);
 
+  // minimizer is any ROOT::Math::Factory plugin, or "Native" for the built-in bounded solver using the
+  // analytic gradient and Hessian (algo "Newton", the default for it, or "LBFGS").
   FitResult fit(const std::string &minimizer = "Minuit2", const std::string &algo = "Migrad", bool verbose = false);
 
   std::vector<std::pair<double, double>> scan_delta_nll(double mu_min, double mu_max, int npts,
@@ -71,10 +124,39 @@ public:
                                                         const std::string &algo = "Migrad",
                                                         bool verbose = false);
 
+  // Impacts of every nuisance on mu, ranked by the larger post-fit shift. The 4 n_nuis refits share the
+  // compiled model and run on nthreads workers (0 = hardware concurrency), warm-started from nominal.
+  std::vector<Impact> impacts(const FitResult &nominal, const std::string &minimizer = "Minuit2",
+                              const std::string &algo = "Migrad", int nthreads = 0);
+
+  // Asimov sensitivity without fitting: the minimum is known, so only the analytic Hessian is
+  // needed. With scan_points >= 3 mu is also profiled over mu_asimov +/- scan_width * mu_err
+  // (clipped to the POI bounds), warm-started from the Asimov point; the scan's minimizer defaults
+  // to fit()'s, and "Native"/"Newton" is usually faster from such a close start.
+  Sensitivity expected_sensitivity(double mu_asimov = 1.0, int scan_points = 0, double scan_width = 3.0,
+                                   const std::string &minimizer = "Minuit2", const std::string &algo = "Migrad");
+
+  // Versioned binary snapshot of the full model (settings, POIs, channels, processes, nuisances and
+  // the parameter indexing), so fits and toys can run without the histogram-production stage.
+  // load_workspace maps the file read-only and rebuilds the Fitter from it; the fit works on TH1D
+  // templates, so each template's bins are copied once from the mapping rather than served from it.
+  void save_workspace(const std::string &path);
+  static Fitter load_workspace(const std::string &path);
+
   double cross_section_pb(const FitResult &fr) const;
   double cross_section_err_sym_pb(const FitResult &fr) const;
+  // Per-POI cross sections (mu_i * sigma_ref_i) and their covariance in pb^2, row-major.
+  std::vector<double> cross_sections_pb(const FitResult &fr) const;
+  std::vector<double> cross_section_covariance_pb2(const FitResult &fr) const;
 
 private:
+  struct Poi {
+    std::string name;
+    double sigma_ref_pb = 1.0;
+    double lo = 0.0;
+    double hi = 10.0;
+  };
+
   struct Process {
     std::string name;
     bool is_signal = false;
@@ -117,9 +199,21 @@ private:
   bool has_any_signal_() const;
   void clear_();
   void build_parameter_indexing_();
+  void compile_();
+  bool analytic_covariance_(const double *x, std::vector<double> &cov) const;
   double guess_mu_() const;
+  std::vector<Poi> effective_pois_() const;
+  std::vector<double> start_point_() const;
+  void define_variables_(ROOT::Math::Minimizer &min, const std::vector<double> &x) const;
   double nll_(const double *x) const;
   double get_nll_min_free_mu_(const std::string &minimizer, const std::string &algo, bool verbose);
+  std::unique_ptr<ROOT::Math::Minimizer> make_minimizer_(const std::string &minimizer, const std::string &algo,
+                                                         bool verbose, unsigned max_calls) const;
+  double profile_nll_(ROOT::Math::Minimizer &min, double mu, std::vector<double> &x) const;
+  double fixed_nuisance_fit_(ROOT::Math::Minimizer &min, std::size_t par, double value,
+                             std::vector<double> x) const;
+  double find_crossing_(ROOT::Math::Minimizer &min, const std::vector<double> &x_hat, double nll_hat,
+                        double step, int side) const;
 
   std::map<std::string, Channel> channels_;
   std::set<std::string> all_channels_;
@@ -127,13 +221,22 @@ private:
   std::map<std::string, NormNuisance> norm_nuis_;
   std::map<std::string, ShapeNuisance> shape_nuis_;
   std::string signal_label_;
+  std::vector<Poi> pois_;
+  std::map<std::string, std::string> signal_poi_;
   double sigma_ref_pb_ = 1.0;
   double mu_lo_ = 0.0;
   double mu_hi_ = 10.0;
   double eps_ = 1e-9;
+  bool asym_errors_ = false;
+  double asym_tol_ = 1e-3;
+  bool debug_ = false;
   std::size_t n_pars_ = 0;
+  std::size_t n_poi_ = 1;
+  std::vector<Poi> poi_pars_;
   std::vector<std::string> par_names_;
   std::vector<int> par_is_norm_;
+  std::shared_ptr<const Likelihood> model_;
+  std::shared_ptr<ThreadPool> pool_;
 };
 
 } // namespace rarexsec::internal::fit
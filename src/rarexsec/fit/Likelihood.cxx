@@ -0,0 +1,376 @@
+#include "rarexsec/fit/Likelihood.h"
+#include "rarexsec/fit/ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+namespace rarexsec::internal::fit {
+
+Likelihood::Likelihood(std::size_t n_pars, std::vector<double> poi_lo, std::vector<double> poi_hi, double eps)
+    : n_pars_(n_pars), poi_lo_(std::move(poi_lo)), poi_hi_(std::move(poi_hi)), eps_(eps) {
+  if (poi_lo_.size() != poi_hi_.size() || poi_lo_.empty() || poi_lo_.size() > n_pars_)
+    throw std::invalid_argument("Likelihood: inconsistent POI bounds");
+}
+
+int Likelihood::add_channel(const std::string &name, const std::vector<double> &data) {
+  Channel ch;
+  ch.name = name;
+  ch.offset = static_cast<int>(data_.size());
+  ch.nbins = static_cast<int>(data.size());
+  data_.insert(data_.end(), data.begin(), data.end());
+  channels_.push_back(std::move(ch));
+  return static_cast<int>(channels_.size()) - 1;
+}
+
+void Likelihood::add_term(Term term) {
+  if (term.channel < 0 || term.channel >= static_cast<int>(channels_.size()))
+    throw std::runtime_error("Likelihood::add_term: unknown channel");
+  Channel &ch = channels_[term.channel];
+  if (static_cast<int>(term.nominal.size()) != ch.nbins)
+    throw std::runtime_error("Likelihood::add_term: binning mismatch in " + ch.name);
+  auto use = [&](int par) {
+    if (par < 0 || par >= static_cast<int>(n_pars_))
+      throw std::runtime_error("Likelihood::add_term: parameter index out of range");
+    if (std::find(ch.pars.begin(), ch.pars.end(), par) == ch.pars.end()) ch.pars.push_back(par);
+  };
+  if (term.poi >= static_cast<int>(n_poi())) throw std::runtime_error("Likelihood::add_term: POI index out of range");
+  if (term.poi >= 0) use(term.poi);
+  for (const auto &sh : term.shapes) {
+    if (static_cast<int>(sh.delta.size()) != ch.nbins)
+      throw std::runtime_error("Likelihood::add_term: shape binning mismatch in " + ch.name);
+    use(sh.par);
+  }
+  for (const auto &nn : term.norms) use(nn.par);
+  std::sort(ch.pars.begin(), ch.pars.end());
+  ch.terms.push_back(static_cast<int>(terms_.size()));
+  terms_.push_back(std::move(term));
+}
+
+void Likelihood::set_data(std::vector<double> data) {
+  if (data.size() != data_.size()) throw std::runtime_error("Likelihood::set_data: bin count mismatch");
+  data_ = std::move(data);
+}
+
+void Likelihood::clamp_pois_(const double *x, std::vector<double> &mu) const {
+  mu.resize(poi_lo_.size());
+  for (std::size_t p = 0; p < mu.size(); ++p) mu[p] = std::clamp(x[p], poi_lo_[p], poi_hi_[p]);
+}
+
+std::size_t Likelihood::n_chunks() const { return std::max<std::size_t>(1, (data_.size() + kChunkBins - 1) / kChunkBins); }
+
+void Likelihood::for_chunks_(const std::function<void(std::size_t)> &fn) const {
+  const std::size_t nchunks = n_chunks();
+  if (pool_ && nchunks > 1) {
+    pool_->run(nchunks, fn);
+  } else {
+    for (std::size_t k = 0; k < nchunks; ++k) fn(k);
+  }
+}
+
+double Likelihood::nll(const double *x) const { return evaluate_(x, nullptr); }
+
+double Likelihood::nll_gradient(const double *x, double *g) const { return evaluate_(x, g); }
+
+double Likelihood::evaluate_(const double *x, double *g) const {
+  std::vector<double> mu;
+  clamp_pois_(x, mu);
+  double constraint = 0.0;
+  for (std::size_t i = n_poi(); i < n_pars_; ++i) constraint += -0.5 * x[i] * x[i];
+
+  // chunk 0 is seeded with the constraint terms so that a single chunk reproduces a plain sequential sum
+  const std::size_t n = n_pars_;
+  const std::size_t nchunks = n_chunks();
+  std::vector<double> part(nchunks, 0.0);
+  std::vector<double> gpart(g ? nchunks * n : 0, 0.0);
+  if (g)
+    for (std::size_t i = n_poi(); i < n; ++i) gpart[i] = 2.0 * x[i];
+  for_chunks_([&](std::size_t k) {
+    part[k] = accumulate_(k, x, mu.data(), k == 0 ? constraint : 0.0, g ? gpart.data() + k * n : nullptr);
+  });
+
+  double logl = part[0];
+  for (std::size_t k = 1; k < nchunks; ++k) logl += part[k];
+  if (g) {
+    std::copy(gpart.begin(), gpart.begin() + n, g);
+    for (std::size_t k = 1; k < nchunks; ++k)
+      for (std::size_t i = 0; i < n; ++i) g[i] += gpart[k * n + i];
+  }
+  return -2.0 * logl;
+}
+
+double Likelihood::accumulate_(std::size_t chunk, const double *x, const double *mu, double logl, double *g) const {
+  const std::size_t lo = chunk * kChunkBins;
+  const std::size_t hi = std::min(lo + kChunkBins, data_.size());
+  std::vector<double> scale;
+  std::vector<double> dscale;
+  std::vector<std::size_t> dofs;
+  for (const Channel &ch : channels_) {
+    const std::size_t off = static_cast<std::size_t>(ch.offset);
+    const std::size_t b0 = std::max(lo, off);
+    const std::size_t b1 = std::min(hi, off + static_cast<std::size_t>(ch.nbins));
+    if (b0 >= b1) continue;
+
+    scale.assign(ch.terms.size(), 1.0);
+    dofs.assign(ch.terms.size() + 1, 0);
+    for (std::size_t it = 0; it < ch.terms.size(); ++it) dofs[it + 1] = dofs[it] + terms_[ch.terms[it]].norms.size();
+    dscale.assign(dofs.back(), 0.0);
+    for (std::size_t it = 0; it < ch.terms.size(); ++it)
+      scale[it] = norm_scale_(terms_[ch.terms[it]], x, g ? dscale.data() + dofs[it] : nullptr);
+
+    for (std::size_t ib = b0 - off; ib < b1 - off; ++ib) {
+      double nu = 0.0;
+      for (std::size_t it = 0; it < ch.terms.size(); ++it) {
+        const Term &t = terms_[ch.terms[it]];
+        double y = t.nominal[ib];
+        for (const Shape &sh : t.shapes) y += x[sh.par] * sh.delta[ib];
+        if (y < 0.0) y = 0.0;
+        nu += (t.poi >= 0 ? mu[t.poi] * scale[it] * y : scale[it] * y);
+      }
+      const double nobs = data_[off + ib];
+      const double ex = (nu > eps_ ? nu : eps_);
+      if (nobs > 0.0)
+        logl += nobs * std::log(ex) - ex;
+      else
+        logl += -ex;
+      if (!g || !(nu > eps_)) continue;
+
+      const double w1 = -2.0 * (nobs / nu - 1.0);
+      for (std::size_t it = 0; it < ch.terms.size(); ++it) {
+        const Term &t = terms_[ch.terms[it]];
+        double y = t.nominal[ib];
+        for (const Shape &sh : t.shapes) y += x[sh.par] * sh.delta[ib];
+        const bool clamped = (y < 0.0);
+        if (clamped) y = 0.0;
+        const double m = (t.poi >= 0 ? mu[t.poi] : 1.0);
+        // d/dmu vanishes outside the bounds, where nll() clamps
+        if (t.poi >= 0 && mu[t.poi] == x[t.poi]) g[t.poi] += w1 * scale[it] * y;
+        const double *dS = dscale.data() + dofs[it];
+        for (std::size_t i = 0; i < t.norms.size(); ++i) g[t.norms[i].par] += w1 * m * dS[i] * y;
+        if (!clamped)
+          for (const Shape &sh : t.shapes) g[sh.par] += w1 * m * scale[it] * sh.delta[ib];
+      }
+    }
+  }
+  return logl;
+}
+
+double Likelihood::norm_scale_(const Term &t, const double *x, double *dS) const {
+  const std::size_t m = t.norms.size();
+  double S = 1.0;
+  for (std::size_t i = 0; i < m; ++i) {
+    const Norm &nn = t.norms[i];
+    const double th = x[nn.par];
+    double gi, g1;
+    if (nn.log_normal) {
+      const double k = std::log(1.0 + nn.frac);
+      gi = std::exp(k * th);
+      g1 = k * gi;
+    } else {
+      const double v = 1.0 + nn.frac * th;
+      gi = std::max(0.0, v);
+      g1 = (v > 0.0 ? nn.frac : 0.0);
+    }
+    // dS_j picks up g_i for every other factor, g'_i for its own
+    if (dS) {
+      for (std::size_t j = 0; j < i; ++j) dS[j] *= gi;
+      dS[i] = S * g1;
+    }
+    S *= gi;
+  }
+  return S;
+}
+
+Likelihood::NormFactors Likelihood::norm_factors_(const Term &t, const double *x) const {
+  const std::size_t m = t.norms.size();
+  std::vector<double> g(m), g1(m), g2(m);
+  for (std::size_t i = 0; i < m; ++i) {
+    const Norm &nn = t.norms[i];
+    const double th = x[nn.par];
+    if (nn.log_normal) {
+      const double k = std::log(1.0 + nn.frac);
+      g[i] = std::exp(k * th);
+      g1[i] = k * g[i];
+      g2[i] = k * k * g[i];
+    } else {
+      const double v = 1.0 + nn.frac * th;
+      g[i] = std::max(0.0, v);
+      g1[i] = (v > 0.0 ? nn.frac : 0.0);
+      g2[i] = 0.0;
+    }
+  }
+  NormFactors out;
+  out.dS.assign(m, 0.0);
+  out.d2S.assign(m * m, 0.0);
+  for (std::size_t i = 0; i < m; ++i) out.S *= g[i];
+  for (std::size_t i = 0; i < m; ++i) {
+    for (std::size_t j = i; j < m; ++j) {
+      double p = (i == j ? g2[i] : g1[i] * g1[j]);
+      for (std::size_t k = 0; k < m; ++k)
+        if (k != i && k != j) p *= g[k];
+      out.d2S[i * m + j] = out.d2S[j * m + i] = p;
+    }
+    double p = g1[i];
+    for (std::size_t k = 0; k < m; ++k)
+      if (k != i) p *= g[k];
+    out.dS[i] = p;
+  }
+  return out;
+}
+
+std::vector<double> Likelihood::expected(const double *x) const {
+  std::vector<double> mu;
+  clamp_pois_(x, mu);
+  std::vector<double> out(data_.size(), 0.0);
+  for (const Channel &ch : channels_) {
+    for (int it : ch.terms) {
+      const Term &t = terms_[it];
+      const double scale = norm_scale_(t, x, nullptr);
+      for (int ib = 0; ib < ch.nbins; ++ib) {
+        double y = t.nominal[ib];
+        for (const Shape &sh : t.shapes) y += x[sh.par] * sh.delta[ib];
+        if (y < 0.0) y = 0.0;
+        out[ch.offset + ib] += (t.poi >= 0 ? mu[t.poi] * scale * y : scale * y);
+      }
+    }
+  }
+  return out;
+}
+
+void Likelihood::hessian(const double *x, std::vector<double> &H) const {
+  const std::size_t n = n_pars_;
+  std::vector<double> mu;
+  clamp_pois_(x, mu);
+  const std::size_t nchunks = n_chunks();
+  std::vector<double> part(nchunks * n * n, 0.0);
+  for_chunks_([&](std::size_t k) { accumulate_hessian_(k, x, mu.data(), part.data() + k * n * n); });
+
+  H.assign(part.begin(), part.begin() + n * n);
+  for (std::size_t k = 1; k < nchunks; ++k)
+    for (std::size_t i = 0; i < n * n; ++i) H[i] += part[k * n * n + i];
+  for (std::size_t i = n_poi(); i < n; ++i) H[i * n + i] += 2.0;
+}
+
+void Likelihood::accumulate_hessian_(std::size_t chunk, const double *x, const double *mu, double *H) const {
+  const std::size_t n = n_pars_;
+  const std::size_t lo = chunk * kChunkBins;
+  const std::size_t hi = std::min(lo + kChunkBins, data_.size());
+  auto add = [&](int i, int j, double v) {
+    H[i * n + j] += v;
+    if (i != j) H[j * n + i] += v;
+  };
+
+  // dnu/dpar for the current bin, with the list of parameters it touches so the rank-one
+  // update stays proportional to the bin's own parameters rather than all POIs in the channel
+  std::vector<double> dnu(n, 0.0);
+  std::vector<char> seen(n, 0);
+  std::vector<int> touched;
+  auto bump = [&](int p, double v) {
+    if (!seen[p]) {
+      seen[p] = 1;
+      touched.push_back(p);
+    }
+    dnu[p] += v;
+  };
+  std::vector<NormFactors> nf;
+  for (const Channel &ch : channels_) {
+    const std::size_t off = static_cast<std::size_t>(ch.offset);
+    const std::size_t b0 = std::max(lo, off);
+    const std::size_t b1 = std::min(hi, off + static_cast<std::size_t>(ch.nbins));
+    if (b0 >= b1) continue;
+    nf.clear();
+    for (int it : ch.terms) nf.push_back(norm_factors_(terms_[it], x));
+
+    for (std::size_t ib = b0 - off; ib < b1 - off; ++ib) {
+      double nu = 0.0;
+      for (std::size_t k = 0; k < ch.terms.size(); ++k) {
+        const Term &t = terms_[ch.terms[k]];
+        double y = t.nominal[ib];
+        for (const Shape &sh : t.shapes) y += x[sh.par] * sh.delta[ib];
+        if (y < 0.0) y = 0.0;
+        nu += (t.poi >= 0 ? mu[t.poi] : 1.0) * nf[k].S * y;
+      }
+      if (!(nu > eps_)) continue;
+
+      const double nobs = data_[off + ib];
+      const double w1 = -2.0 * (nobs / nu - 1.0);
+      const double w2 = 2.0 * nobs / (nu * nu);
+      for (int p : touched) {
+        dnu[p] = 0.0;
+        seen[p] = 0;
+      }
+      touched.clear();
+
+      for (std::size_t k = 0; k < ch.terms.size(); ++k) {
+        const Term &t = terms_[ch.terms[k]];
+        const NormFactors &f = nf[k];
+        double y = t.nominal[ib];
+        for (const Shape &sh : t.shapes) y += x[sh.par] * sh.delta[ib];
+        const bool clamped = (y < 0.0);
+        if (clamped) y = 0.0;
+        const double m = (t.poi >= 0 ? mu[t.poi] : 1.0);
+        const std::size_t nn = t.norms.size();
+
+        if (t.poi >= 0) {
+          bump(t.poi, f.S * y);
+          for (std::size_t i = 0; i < nn; ++i) add(t.poi, t.norms[i].par, w1 * f.dS[i] * y);
+          if (!clamped)
+            for (const Shape &sh : t.shapes) add(t.poi, sh.par, w1 * f.S * sh.delta[ib]);
+        }
+        for (std::size_t i = 0; i < nn; ++i) {
+          const int pi = t.norms[i].par;
+          bump(pi, m * f.dS[i] * y);
+          for (std::size_t j = i; j < nn; ++j) add(pi, t.norms[j].par, w1 * m * f.d2S[i * nn + j] * y);
+          if (!clamped)
+            for (const Shape &sh : t.shapes) add(pi, sh.par, w1 * m * f.dS[i] * sh.delta[ib]);
+        }
+        if (!clamped)
+          for (const Shape &sh : t.shapes) bump(sh.par, m * f.S * sh.delta[ib]);
+      }
+
+      if (w2 != 0.0) {
+        for (std::size_t a = 0; a < touched.size(); ++a) {
+          const int pa = touched[a];
+          const double va = w2 * dnu[pa];
+          for (std::size_t b = a; b < touched.size(); ++b) add(pa, touched[b], va * dnu[touched[b]]);
+        }
+      }
+    }
+  }
+}
+
+bool Likelihood::invert_spd(std::vector<double> &A, std::size_t n) {
+  std::vector<double> L(n * n, 0.0);
+  for (std::size_t j = 0; j < n; ++j) {
+    double d = A[j * n + j];
+    for (std::size_t k = 0; k < j; ++k) d -= L[j * n + k] * L[j * n + k];
+    if (!(d > 0.0) || !std::isfinite(d)) return false;
+    L[j * n + j] = std::sqrt(d);
+    for (std::size_t i = j + 1; i < n; ++i) {
+      double s = A[i * n + j];
+      for (std::size_t k = 0; k < j; ++k) s -= L[i * n + k] * L[j * n + k];
+      L[i * n + j] = s / L[j * n + j];
+    }
+  }
+  // inverse of L (lower triangular), then A^-1 = L^-T L^-1
+  std::vector<double> Li(n * n, 0.0);
+  for (std::size_t j = 0; j < n; ++j) {
+    Li[j * n + j] = 1.0 / L[j * n + j];
+    for (std::size_t i = j + 1; i < n; ++i) {
+      double s = 0.0;
+      for (std::size_t k = j; k < i; ++k) s -= L[i * n + k] * Li[k * n + j];
+      Li[i * n + j] = s / L[i * n + i];
+    }
+  }
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = i; j < n; ++j) {
+      double s = 0.0;
+      for (std::size_t k = j; k < n; ++k) s += Li[k * n + i] * Li[k * n + j];
+      A[i * n + j] = A[j * n + i] = s;
+    }
+  }
+  return true;
+}
+
+} // namespace rarexsec::internal::fit
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rarexsec::internal::fit {
+
+class ThreadPool;
+
+// Flattened binned Poisson likelihood compiled from a Fitter model. Parameters [0, n_poi) are
+// signal strengths clamped to their bounds; all later parameters carry a unit Gaussian constraint.
+// nll() returns -2 lnL exactly as Fitter::nll_ did.
+//
+// Bins are evaluated in fixed chunks of kChunkBins consecutive (channel-concatenated) bins, optionally
+// spread over a thread pool; partial sums are reduced in chunk order, so results are bit-identical
+// for any number of threads.
+class Likelihood {
+public:
+  struct Norm {
+    int par = -1;
+    double frac = 0.0;
+    bool log_normal = true;
+  };
+
+  struct Shape {
+    int par = -1;
+    std::vector<double> delta;
+  };
+
+  struct Term {
+    int channel = -1;
+    int poi = -1; // signal-strength parameter scaling this term, -1 for background
+    std::vector<double> nominal;
+    std::vector<Shape> shapes;
+    std::vector<Norm> norms;
+  };
+
+  struct Channel {
+    std::string name;
+    int offset = 0;
+    int nbins = 0;
+    std::vector<int> terms;
+    std::vector<int> pars;
+  };
+
+  static constexpr std::size_t kChunkBins = 256;
+
+  Likelihood(std::size_t n_pars, std::vector<double> poi_lo, std::vector<double> poi_hi, double eps);
+
+  void set_thread_pool(std::shared_ptr<ThreadPool> pool) { pool_ = std::move(pool); }
+
+  int add_channel(const std::string &name, const std::vector<double> &data);
+  void add_term(Term term);
+  // Replaces the observed counts of every bin, e.g. with an Asimov dataset from expected().
+  void set_data(std::vector<double> data);
+
+  std::size_t n_pars() const { return n_pars_; }
+  std::size_t n_poi() const { return poi_lo_.size(); }
+  std::size_t n_bins() const { return data_.size(); }
+  std::size_t n_chunks() const;
+  const std::vector<Channel> &channels() const { return channels_; }
+  const std::vector<Term> &terms() const { return terms_; }
+  const std::vector<double> &data() const { return data_; }
+
+  double nll(const double *x) const;
+  // -2 lnL at x together with its gradient, written to g[0..n_pars).
+  double nll_gradient(const double *x, double *g) const;
+  // Second derivatives of -2 lnL at x, row-major n_pars x n_pars.
+  void hessian(const double *x, std::vector<double> &H) const;
+  // Expected yield of every (channel-concatenated) bin at x.
+  std::vector<double> expected(const double *x) const;
+
+  // In-place inverse of a symmetric positive-definite n x n matrix; false if not positive definite.
+  static bool invert_spd(std::vector<double> &A, std::size_t n);
+
+private:
+  struct NormFactors {
+    double S = 1.0;
+    std::vector<double> dS;
+    std::vector<double> d2S;
+  };
+
+  NormFactors norm_factors_(const Term &t, const double *x) const;
+  double norm_scale_(const Term &t, const double *x, double *dS) const;
+
+  void clamp_pois_(const double *x, std::vector<double> &mu) const;
+  void for_chunks_(const std::function<void(std::size_t)> &fn) const;
+  double evaluate_(const double *x, double *g) const;
+  double accumulate_(std::size_t chunk, const double *x, const double *mu, double logl, double *g) const;
+  void accumulate_hessian_(std::size_t chunk, const double *x, const double *mu, double *H) const;
+
+  std::size_t n_pars_ = 0;
+  std::vector<double> poi_lo_;
+  std::vector<double> poi_hi_;
+  double eps_ = 1e-9;
+  std::vector<Channel> channels_;
+  std::vector<Term> terms_;
+  std::vector<double> data_;
+  std::shared_ptr<ThreadPool> pool_;
+};
+
+} // namespace rarexsec::internal::fit
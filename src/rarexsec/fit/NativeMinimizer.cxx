@@ -0,0 +1,451 @@
+#include "rarexsec/fit/NativeMinimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace rarexsec::internal::fit {
+
+namespace {
+
+constexpr double kInf = std::numeric_limits<double>::infinity();
+constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+constexpr double kArmijo = 1e-4;
+constexpr int kMaxBacktrack = 40;
+constexpr std::size_t kMemory = 8;
+
+// In-place lower Cholesky factor of an n x n row-major matrix; false if not positive definite.
+bool cholesky(std::vector<double> &A, std::size_t n) {
+  for (std::size_t j = 0; j < n; ++j) {
+    double d = A[j * n + j];
+    for (std::size_t k = 0; k < j; ++k) d -= A[j * n + k] * A[j * n + k];
+    if (!(d > 0.0) || !std::isfinite(d)) return false;
+    A[j * n + j] = std::sqrt(d);
+    for (std::size_t i = j + 1; i < n; ++i) {
+      double s = A[i * n + j];
+      for (std::size_t k = 0; k < j; ++k) s -= A[i * n + k] * A[j * n + k];
+      A[i * n + j] = s / A[j * n + j];
+    }
+  }
+  return true;
+}
+
+// Solves L L^T v = b in place given the factor from cholesky().
+void cholesky_solve(const std::vector<double> &L, std::size_t n, std::vector<double> &b) {
+  for (std::size_t i = 0; i < n; ++i) {
+    double s = b[i];
+    for (std::size_t k = 0; k < i; ++k) s -= L[i * n + k] * b[k];
+    b[i] = s / L[i * n + i];
+  }
+  for (std::size_t i = n; i-- > 0;) {
+    double s = b[i];
+    for (std::size_t k = i + 1; k < n; ++k) s -= L[k * n + i] * b[k];
+    b[i] = s / L[i * n + i];
+  }
+}
+
+double dot(const std::vector<double> &a, const std::vector<double> &b) {
+  double s = 0.0;
+  for (std::size_t i = 0; i < a.size(); ++i) s += a[i] * b[i];
+  return s;
+}
+
+} // namespace
+
+NativeMinimizer::NativeMinimizer(const std::string &algo) : use_lbfgs_(algo == "LBFGS" || algo == "lbfgs") {}
+
+NativeMinimizer::~NativeMinimizer() = default;
+
+void NativeMinimizer::SetFunction(const ROOT::Math::IMultiGenFunction &func) {
+  func_.reset(func.Clone());
+  cov_valid_ = false;
+}
+
+void NativeMinimizer::set_gradient(Gradient g) {
+  gradient_ = std::move(g);
+  cov_valid_ = false;
+}
+
+void NativeMinimizer::set_hessian(Hessian h) {
+  hessian_ = std::move(h);
+  cov_valid_ = false;
+}
+
+void NativeMinimizer::grow_(unsigned int ivar) {
+  if (ivar < x_.size()) return;
+  x_.resize(ivar + 1, 0.0);
+  Variable v;
+  v.lo = -kInf;
+  v.hi = kInf;
+  vars_.resize(ivar + 1, v);
+}
+
+bool NativeMinimizer::SetVariable(unsigned int ivar, const std::string &name, double val, double) {
+  grow_(ivar);
+  vars_[ivar].name = name;
+  vars_[ivar].lo = -kInf;
+  vars_[ivar].hi = kInf;
+  vars_[ivar].fixed = false;
+  x_[ivar] = val;
+  cov_valid_ = false;
+  return true;
+}
+
+bool NativeMinimizer::SetLimitedVariable(unsigned int ivar, const std::string &name, double val, double,
+                                         double lower, double upper) {
+  if (!(lower < upper)) return false;
+  grow_(ivar);
+  vars_[ivar].name = name;
+  vars_[ivar].lo = lower;
+  vars_[ivar].hi = upper;
+  vars_[ivar].fixed = false;
+  x_[ivar] = std::clamp(val, lower, upper);
+  cov_valid_ = false;
+  return true;
+}
+
+bool NativeMinimizer::SetFixedVariable(unsigned int ivar, const std::string &name, double val) {
+  grow_(ivar);
+  vars_[ivar].name = name;
+  vars_[ivar].fixed = true;
+  x_[ivar] = val;
+  cov_valid_ = false;
+  return true;
+}
+
+bool NativeMinimizer::SetVariableValue(unsigned int ivar, double value) {
+  if (ivar >= x_.size()) return false;
+  x_[ivar] = vars_[ivar].fixed ? value : std::clamp(value, vars_[ivar].lo, vars_[ivar].hi);
+  cov_valid_ = false;
+  return true;
+}
+
+bool NativeMinimizer::FixVariable(unsigned int ivar) {
+  if (ivar >= x_.size()) return false;
+  vars_[ivar].fixed = true;
+  cov_valid_ = false;
+  return true;
+}
+
+bool NativeMinimizer::ReleaseVariable(unsigned int ivar) {
+  if (ivar >= x_.size()) return false;
+  vars_[ivar].fixed = false;
+  cov_valid_ = false;
+  return true;
+}
+
+bool NativeMinimizer::IsFixedVariable(unsigned int ivar) const { return ivar < vars_.size() && vars_[ivar].fixed; }
+
+unsigned int NativeMinimizer::NFree() const {
+  unsigned int n = 0;
+  for (const auto &v : vars_)
+    if (!v.fixed) ++n;
+  return n;
+}
+
+double NativeMinimizer::eval_(const double *x, double *g) const {
+  const std::size_t n = x_.size();
+  double f;
+  if (gradient_) {
+    ++ncalls_;
+    f = gradient_(x, g);
+  } else {
+    if (!func_) throw std::runtime_error("NativeMinimizer: no function set");
+    f = (*func_)(x);
+    std::vector<double> xp(x, x + n);
+    for (std::size_t i = 0; i < n; ++i) {
+      if (vars_[i].fixed) continue;
+      const double h = 1e-6 * std::max(1.0, std::abs(x[i]));
+      xp[i] = x[i] + h;
+      const double fp = (*func_)(xp.data());
+      xp[i] = x[i] - h;
+      const double fm = (*func_)(xp.data());
+      xp[i] = x[i];
+      g[i] = (fp - fm) / (2.0 * h);
+    }
+    ncalls_ += 1 + 2 * static_cast<unsigned int>(n);
+  }
+  for (std::size_t i = 0; i < n; ++i)
+    if (vars_[i].fixed) g[i] = 0.0;
+  return f;
+}
+
+void NativeMinimizer::project_(std::vector<double> &x) const {
+  for (std::size_t i = 0; i < x.size(); ++i)
+    if (!vars_[i].fixed) x[i] = std::clamp(x[i], vars_[i].lo, vars_[i].hi);
+}
+
+std::vector<std::size_t> NativeMinimizer::inactive_(const std::vector<double> &x, const std::vector<double> &g) const {
+  std::vector<std::size_t> idx;
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    const Variable &v = vars_[i];
+    if (v.fixed) continue;
+    if (x[i] <= v.lo && g[i] > 0.0) continue;
+    if (x[i] >= v.hi && g[i] < 0.0) continue;
+    idx.push_back(i);
+  }
+  return idx;
+}
+
+double NativeMinimizer::line_search_(std::vector<double> &x, double f, std::vector<double> &g,
+                                     const std::vector<double> &d) {
+  const std::size_t n = x.size();
+  std::vector<double> xt(n), gt(n);
+  double t = 1.0;
+  for (int k = 0; k < kMaxBacktrack; ++k, t *= 0.5) {
+    for (std::size_t i = 0; i < n; ++i) xt[i] = x[i] + t * d[i];
+    project_(xt);
+    double dec = 0.0;
+    for (std::size_t i = 0; i < n; ++i) dec += g[i] * (xt[i] - x[i]);
+    if (!(dec < 0.0)) continue;
+    const double ft = eval_(xt.data(), gt.data());
+    if (std::isfinite(ft) && ft <= f + kArmijo * dec) {
+      x.swap(xt);
+      g.swap(gt);
+      return ft;
+    }
+  }
+  return kNaN;
+}
+
+bool NativeMinimizer::newton_() {
+  const std::size_t n = x_.size();
+  const double edm_target = 2e-3 * Tolerance() * ErrorDef();
+  const unsigned int max_iter = MaxIterations() > 0 ? MaxIterations() : 1000;
+  const unsigned int max_calls = MaxFunctionCalls() > 0 ? MaxFunctionCalls() : 100000;
+
+  std::vector<double> g(n, 0.0), H, A, d(n), r;
+  double f = eval_(x_.data(), g.data());
+  for (unsigned int it = 0; it < max_iter && ncalls_ < max_calls; ++it) {
+    const auto idx = inactive_(x_, g);
+    const std::size_t m = idx.size();
+    if (m == 0) {
+      edm_ = 0.0;
+      break;
+    }
+    hessian_(x_.data(), H);
+    double scale = 0.0;
+    for (std::size_t a = 0; a < m; ++a) scale = std::max(scale, std::abs(H[idx[a] * n + idx[a]]));
+    scale = std::max(scale, 1.0);
+
+    bool solved = false;
+    for (double lambda = 0.0; lambda < 1e8 * scale; lambda = (lambda > 0.0 ? 10.0 * lambda : 1e-6 * scale)) {
+      A.assign(m * m, 0.0);
+      for (std::size_t a = 0; a < m; ++a) {
+        for (std::size_t b = 0; b < m; ++b) A[a * m + b] = H[idx[a] * n + idx[b]];
+        A[a * m + a] += lambda;
+      }
+      if (!cholesky(A, m)) continue;
+      r.resize(m);
+      for (std::size_t a = 0; a < m; ++a) r[a] = -g[idx[a]];
+      cholesky_solve(A, m, r);
+      solved = true;
+      break;
+    }
+    std::fill(d.begin(), d.end(), 0.0);
+    if (solved) {
+      for (std::size_t a = 0; a < m; ++a) d[idx[a]] = r[a];
+    } else {
+      for (std::size_t i : idx) d[i] = -g[i];
+    }
+    double gd = 0.0;
+    for (std::size_t i : idx) gd += g[i] * d[i];
+    edm_ = -0.5 * gd;
+    if (solved && edm_ < edm_target) break;
+
+    const double fn = line_search_(x_, f, g, d);
+    if (!std::isfinite(fn)) {
+      fStatus = (edm_ < 100.0 * edm_target ? 0 : 3);
+      fval_ = f;
+      grad_ = g;
+      return fStatus == 0;
+    }
+    f = fn;
+  }
+  fval_ = f;
+  grad_ = g;
+  fStatus = (edm_ >= 0.0 && edm_ < edm_target) ? 0 : 4;
+  return fStatus == 0;
+}
+
+bool NativeMinimizer::lbfgs_() {
+  const std::size_t n = x_.size();
+  const double edm_target = 2e-3 * Tolerance() * ErrorDef();
+  const unsigned int max_iter = MaxIterations() > 0 ? MaxIterations() : 10000;
+  const unsigned int max_calls = MaxFunctionCalls() > 0 ? MaxFunctionCalls() : 100000;
+
+  std::deque<std::pair<std::vector<double>, std::vector<double>>> mem;
+  std::vector<double> g(n, 0.0), q(n), d(n), x_old, g_old;
+  std::vector<double> alpha;
+  double f = eval_(x_.data(), g.data());
+  for (unsigned int it = 0; it < max_iter && ncalls_ < max_calls; ++it) {
+    const auto idx = inactive_(x_, g);
+    if (idx.empty()) {
+      edm_ = 0.0;
+      break;
+    }
+    std::fill(q.begin(), q.end(), 0.0);
+    for (std::size_t i : idx) q[i] = g[i];
+
+    // two-loop recursion restricted to the currently free, non-bound-blocked coordinates
+    alpha.assign(mem.size(), 0.0);
+    for (std::size_t k = mem.size(); k-- > 0;) {
+      const auto &[s, y] = mem[k];
+      alpha[k] = dot(s, q) / dot(y, s);
+      for (std::size_t i : idx) q[i] -= alpha[k] * y[i];
+    }
+    double gamma;
+    if (mem.empty()) {
+      double gmax = 0.0;
+      for (std::size_t i : idx) gmax = std::max(gmax, std::abs(g[i]));
+      gamma = 0.1 / std::max(gmax, 1e-12);
+    } else {
+      gamma = dot(mem.back().first, mem.back().second) / dot(mem.back().second, mem.back().second);
+    }
+    for (std::size_t i : idx) q[i] *= gamma;
+    for (std::size_t k = 0; k < mem.size(); ++k) {
+      const auto &[s, y] = mem[k];
+      const double beta = dot(y, q) / dot(y, s);
+      for (std::size_t i : idx) q[i] += s[i] * (alpha[k] - beta);
+    }
+    std::fill(d.begin(), d.end(), 0.0);
+    for (std::size_t i : idx) d[i] = -q[i];
+
+    double gd = 0.0;
+    for (std::size_t i : idx) gd += g[i] * d[i];
+    if (!(gd < 0.0)) {
+      mem.clear();
+      for (std::size_t i : idx) d[i] = -g[i];
+      gd = 0.0;
+      for (std::size_t i : idx) gd -= g[i] * g[i];
+    }
+    edm_ = -0.5 * gd;
+    if (!mem.empty() && edm_ < edm_target) break;
+
+    x_old = x_;
+    g_old = g;
+    const double fn = line_search_(x_, f, g, d);
+    if (!std::isfinite(fn)) {
+      if (!mem.empty()) {
+        mem.clear();
+        continue;
+      }
+      fStatus = (edm_ < 100.0 * edm_target ? 0 : 3);
+      fval_ = f;
+      grad_ = g;
+      return fStatus == 0;
+    }
+    f = fn;
+
+    std::vector<double> s(n), y(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      s[i] = x_[i] - x_old[i];
+      y[i] = g[i] - g_old[i];
+    }
+    const double sy = dot(s, y);
+    if (sy > 1e-12 * std::sqrt(dot(s, s) * dot(y, y))) {
+      mem.emplace_back(std::move(s), std::move(y));
+      if (mem.size() > kMemory) mem.pop_front();
+    }
+  }
+  fval_ = f;
+  grad_ = g;
+  fStatus = (edm_ >= 0.0 && edm_ < edm_target) ? 0 : 4;
+  return fStatus == 0;
+}
+
+bool NativeMinimizer::Minimize() {
+  if (!func_ && !gradient_) throw std::runtime_error("NativeMinimizer: no function set");
+  if (x_.empty()) throw std::runtime_error("NativeMinimizer: no variables defined");
+  ncalls_ = 0;
+  edm_ = -1.0;
+  cov_valid_ = false;
+  project_(x_);
+  const bool ok = (hessian_ && !use_lbfgs_) ? newton_() : lbfgs_();
+  if (PrintLevel() > 0) {
+    std::cout << "NativeMinimizer: " << (use_lbfgs_ || !hessian_ ? "LBFGS" : "Newton") << " status " << fStatus
+              << ", fval " << fval_ << ", edm " << edm_ << ", ncalls " << ncalls_ << std::endl;
+    for (std::size_t i = 0; i < x_.size(); ++i)
+      std::cout << "  " << vars_[i].name << " = " << x_[i] << (vars_[i].fixed ? " (fixed)" : "") << std::endl;
+  }
+  return ok;
+}
+
+bool NativeMinimizer::compute_covariance_() const {
+  const std::size_t n = x_.size();
+  std::vector<double> H;
+  if (hessian_) {
+    hessian_(x_.data(), H);
+  } else {
+    // central differences of the gradient, one-sided at a bound
+    H.assign(n * n, 0.0);
+    std::vector<double> xp = x_, gp(n), gm(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      if (vars_[i].fixed) continue;
+      const double h = 1e-4 * std::max(1.0, std::abs(x_[i]));
+      const double up = std::min(x_[i] + h, vars_[i].hi);
+      const double dn = std::max(x_[i] - h, vars_[i].lo);
+      xp[i] = up;
+      eval_(xp.data(), gp.data());
+      xp[i] = dn;
+      eval_(xp.data(), gm.data());
+      xp[i] = x_[i];
+      for (std::size_t j = 0; j < n; ++j) H[i * n + j] = (gp[j] - gm[j]) / (up - dn);
+    }
+    for (std::size_t i = 0; i < n; ++i)
+      for (std::size_t j = i + 1; j < n; ++j) H[i * n + j] = H[j * n + i] = 0.5 * (H[i * n + j] + H[j * n + i]);
+  }
+
+  std::vector<std::size_t> idx;
+  for (std::size_t i = 0; i < n; ++i)
+    if (!vars_[i].fixed) idx.push_back(i);
+  const std::size_t m = idx.size();
+  std::vector<double> L(m * m);
+  for (std::size_t a = 0; a < m; ++a)
+    for (std::size_t b = 0; b < m; ++b) L[a * m + b] = H[idx[a] * n + idx[b]];
+
+  cov_.assign(n * n, 0.0);
+  errors_.assign(n, 0.0);
+  const double up = 2.0 * ErrorDef();
+  const bool ok = cholesky(L, m);
+  if (ok) {
+    std::vector<double> col(m);
+    for (std::size_t b = 0; b < m; ++b) {
+      std::fill(col.begin(), col.end(), 0.0);
+      col[b] = 1.0;
+      cholesky_solve(L, m, col);
+      for (std::size_t a = 0; a < m; ++a) cov_[idx[a] * n + idx[b]] = up * col[a];
+    }
+    for (std::size_t i : idx) errors_[i] = std::sqrt(cov_[i * n + i]);
+  } else {
+    for (std::size_t i : idx) {
+      const double h = H[i * n + i];
+      errors_[i] = (h > 0.0 ? std::sqrt(up / h) : 0.0);
+      cov_[i * n + i] = errors_[i] * errors_[i];
+    }
+  }
+  cov_valid_ = true;
+  return ok;
+}
+
+bool NativeMinimizer::Hesse() {
+  if (x_.empty()) return false;
+  return compute_covariance_();
+}
+
+const double *NativeMinimizer::Errors() const {
+  if (!cov_valid_ && !x_.empty()) compute_covariance_();
+  return errors_.data();
+}
+
+double NativeMinimizer::CovMatrix(unsigned int i, unsigned int j) const {
+  if (i >= x_.size() || j >= x_.size()) return 0.0;
+  if (!cov_valid_) compute_covariance_();
+  return cov_[i * x_.size() + j];
+}
+
+} // namespace rarexsec::internal::fit
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Math/IFunction.h"
+#include "Math/Minimizer.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rarexsec::internal::fit {
+
+// Bounded quasi-Newton minimizer for small, smooth binned likelihoods. It implements the part of the
+// ROOT::Math::Minimizer interface that Fitter drives, so it can stand in for Minuit2 anywhere.
+//   algo "Newton" (default): damped projected Newton on the supplied Hessian, falling back to
+//                            L-BFGS if no Hessian callback is set;
+//   algo "LBFGS":            projected limited-memory BFGS.
+// Without a gradient callback the gradient is taken by central differences of the function.
+class NativeMinimizer : public ROOT::Math::Minimizer {
+public:
+  using Gradient = std::function<double(const double *x, double *g)>;
+  using Hessian = std::function<void(const double *x, std::vector<double> &H)>;
+
+  explicit NativeMinimizer(const std::string &algo = "Newton");
+  ~NativeMinimizer() override;
+
+  void SetFunction(const ROOT::Math::IMultiGenFunction &func) override;
+  void set_gradient(Gradient g);
+  void set_hessian(Hessian h);
+
+  bool SetVariable(unsigned int ivar, const std::string &name, double val, double step) override;
+  bool SetLimitedVariable(unsigned int ivar, const std::string &name, double val, double step, double lower,
+                          double upper) override;
+  bool SetFixedVariable(unsigned int ivar, const std::string &name, double val) override;
+  bool SetVariableValue(unsigned int ivar, double value) override;
+  bool FixVariable(unsigned int ivar) override;
+  bool ReleaseVariable(unsigned int ivar) override;
+  bool IsFixedVariable(unsigned int ivar) const override;
+
+  bool Minimize() override;
+  bool Hesse() override;
+
+  double MinValue() const override { return fval_; }
+  const double *X() const override { return x_.data(); }
+  double Edm() const override { return edm_; }
+  const double *MinGradient() const override { return grad_.data(); }
+  unsigned int NCalls() const override { return ncalls_; }
+  unsigned int NDim() const override { return static_cast<unsigned int>(x_.size()); }
+  unsigned int NFree() const override;
+  bool ProvidesError() const override { return true; }
+  const double *Errors() const override;
+  double CovMatrix(unsigned int i, unsigned int j) const override;
+
+private:
+  struct Variable {
+    std::string name;
+    double lo;
+    double hi;
+    bool fixed = false;
+  };
+
+  void grow_(unsigned int ivar);
+  double eval_(const double *x, double *g) const;
+  void project_(std::vector<double> &x) const;
+  std::vector<std::size_t> inactive_(const std::vector<double> &x, const std::vector<double> &g) const;
+  double line_search_(std::vector<double> &x, double f, std::vector<double> &g, const std::vector<double> &d);
+  bool newton_();
+  bool lbfgs_();
+  bool compute_covariance_() const;
+
+  bool use_lbfgs_ = false;
+  std::unique_ptr<ROOT::Math::IMultiGenFunction> func_;
+  Gradient gradient_;
+  Hessian hessian_;
+  std::vector<Variable> vars_;
+  std::vector<double> x_;
+  std::vector<double> grad_;
+  double fval_ = 0.0;
+  double edm_ = -1.0;
+  mutable unsigned int ncalls_ = 0;
+  mutable bool cov_valid_ = false;
+  mutable std::vector<double> cov_;
+  mutable std::vector<double> errors_;
+};
+
+} // namespace rarexsec::internal::fit
@@ -0,0 +1,61 @@
+#include "rarexsec/fit/ThreadPool.h"
+
+namespace rarexsec::internal::fit {
+
+ThreadPool::ThreadPool(unsigned nthreads) {
+  unsigned nt = nthreads > 0 ? nthreads : std::thread::hardware_concurrency();
+  if (nt == 0) nt = 1;
+  workers_.reserve(nt - 1);
+  for (unsigned t = 1; t < nt; ++t) workers_.emplace_back([this] { worker_loop_(); });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lk(m_);
+    stop_ = true;
+  }
+  start_cv_.notify_all();
+  for (auto &th : workers_) th.join();
+}
+
+void ThreadPool::run(std::size_t n, const std::function<void(std::size_t)> &fn) {
+  if (n == 0) return;
+  std::unique_lock<std::mutex> busy(run_mutex_, std::try_to_lock);
+  if (!busy.owns_lock() || workers_.empty() || n == 1) {
+    for (std::size_t i = 0; i < n; ++i) fn(i);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lk(m_);
+    job_ = &fn;
+    n_ = n;
+    next_ = 0;
+    active_ = workers_.size();
+    ++generation_;
+  }
+  start_cv_.notify_all();
+  drain_();
+  std::unique_lock<std::mutex> lk(m_);
+  done_cv_.wait(lk, [this] { return active_ == 0; });
+  job_ = nullptr;
+}
+
+void ThreadPool::drain_() {
+  for (std::size_t i = next_++; i < n_; i = next_++) (*job_)(i);
+}
+
+void ThreadPool::worker_loop_() {
+  std::size_t seen = 0;
+  for (;;) {
+    std::unique_lock<std::mutex> lk(m_);
+    start_cv_.wait(lk, [&] { return stop_ || generation_ != seen; });
+    if (stop_) return;
+    seen = generation_;
+    lk.unlock();
+    drain_();
+    lk.lock();
+    if (--active_ == 0) done_cv_.notify_one();
+  }
+}
+
+} // namespace rarexsec::internal::fit
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rarexsec::internal::fit {
+
+// Persistent workers for short, repeated parallel loops such as one likelihood evaluation. run()
+// blocks until every index is done and the caller works alongside the pool. A run() issued while
+// another is in flight (e.g. from concurrent fits) executes inline on its own thread instead.
+class ThreadPool {
+public:
+  // nthreads counts the calling thread; 0 means hardware concurrency.
+  explicit ThreadPool(unsigned nthreads = 0);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  unsigned size() const { return static_cast<unsigned>(workers_.size()) + 1; }
+  void run(std::size_t n, const std::function<void(std::size_t)> &fn);
+
+private:
+  void worker_loop_();
+  void drain_();
+
+  std::vector<std::thread> workers_;
+  std::mutex run_mutex_;
+  std::mutex m_;
+  std::condition_variable start_cv_;
+  std::condition_variable done_cv_;
+  const std::function<void(std::size_t)> *job_ = nullptr;
+  std::size_t n_ = 0;
+  std::atomic<std::size_t> next_{0};
+  std::size_t active_ = 0;
+  std::size_t generation_ = 0;
+  bool stop_ = false;
+};
+
+} // namespace rarexsec::internal::fit
@@ -0,0 +1,249 @@
+#include "rarexsec/fit/Fitter.h"
+#include "rarexsec/io/Binary.h"
+
+#include "TH1.h"
+#include "TH1D.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+// Workspace layout (native endianness, checked on load):
+//   "RXWS" | u32 version | u32 byte-order mark
+//   settings | declared POIs | signal->POI bindings | channels (edges, data, processes)
+//   norm nuisances | shape nuisances (up/down contents) | parameter names
+//   u64 FNV-1a checksum of everything before it
+// Strings are u32 length + bytes, arrays are u32 count + raw doubles.
+
+namespace rarexsec::internal::fit {
+
+namespace {
+
+constexpr char kMagic[4] = {'R', 'X', 'W', 'S'};
+constexpr std::uint32_t kVersion = 1;
+constexpr std::uint32_t kByteOrder = 0x01020304u;
+
+using rarexsec::io::binary::fnv1a;
+using rarexsec::io::binary::MappedFile;
+using rarexsec::io::binary::Reader;
+using rarexsec::io::binary::Writer;
+
+void put_contents(Writer &w, const TH1D &h) {
+  const int nb = h.GetNbinsX();
+  w.pod<std::uint32_t>(static_cast<std::uint32_t>(nb));
+  for (int i = 1; i <= nb; ++i) w.pod<double>(h.GetBinContent(i));
+}
+
+// Copies the stored contents straight from the mapping into bins 1..n of h.
+void fill(Reader &r, TH1D &h, const std::string &path) {
+  const auto n = r.pod<std::uint32_t>();
+  if (static_cast<int>(n) != h.GetNbinsX()) throw std::runtime_error("load_workspace: bin count mismatch in " + path);
+  r.bytes(h.GetArray() + 1, std::size_t(n) * sizeof(double));
+}
+
+std::vector<double> bin_edges(const TH1D &h) {
+  const int nb = h.GetNbinsX();
+  std::vector<double> e(nb + 1);
+  for (int i = 1; i <= nb + 1; ++i) e[i - 1] = h.GetXaxis()->GetBinLowEdge(i);
+  return e;
+}
+
+std::unique_ptr<TH1D> make_hist(const std::string &name, const std::vector<double> &edges) {
+  auto h = std::make_unique<TH1D>(name.c_str(), "", static_cast<int>(edges.size()) - 1, edges.data());
+  h->SetDirectory(nullptr);
+  return h;
+}
+
+} // namespace
+
+void Fitter::save_workspace(const std::string &path) {
+  build_parameter_indexing_();
+  Writer w;
+  w.buffer().append(kMagic, sizeof(kMagic));
+  w.pod<std::uint32_t>(kVersion);
+  w.pod<std::uint32_t>(kByteOrder);
+
+  w.str(signal_label_);
+  w.pod<double>(sigma_ref_pb_);
+  w.pod<double>(mu_lo_);
+  w.pod<double>(mu_hi_);
+  w.pod<double>(eps_);
+  w.pod<std::uint8_t>(asym_errors_ ? 1 : 0);
+  w.pod<double>(asym_tol_);
+
+  w.pod<std::uint32_t>(static_cast<std::uint32_t>(pois_.size()));
+  for (const auto &p : pois_) {
+    w.str(p.name);
+    w.pod<double>(p.sigma_ref_pb);
+    w.pod<double>(p.lo);
+    w.pod<double>(p.hi);
+  }
+  w.pod<std::uint32_t>(static_cast<std::uint32_t>(signal_poi_.size()));
+  for (const auto &kv : signal_poi_) {
+    w.str(kv.first);
+    w.str(kv.second);
+  }
+
+  w.pod<std::uint32_t>(static_cast<std::uint32_t>(channels_.size()));
+  for (const auto &ckv : channels_) {
+    const Channel &ch = ckv.second;
+    w.str(ch.name);
+    const auto edges = bin_edges(*ch.data);
+    w.doubles(edges.data(), edges.size());
+    put_contents(w, *ch.data);
+    w.pod<std::uint32_t>(static_cast<std::uint32_t>(ch.processes.size()));
+    for (const auto &pkv : ch.processes) {
+      w.str(pkv.second.name);
+      w.pod<std::uint8_t>(pkv.second.is_signal ? 1 : 0);
+      put_contents(w, *pkv.second.nominal);
+    }
+  }
+
+  w.pod<std::uint32_t>(static_cast<std::uint32_t>(norm_nuis_.size()));
+  for (const auto &kv : norm_nuis_) {
+    w.str(kv.second.name);
+    w.pod<std::uint8_t>(kv.second.log_normal ? 1 : 0);
+    w.pod<std::uint32_t>(static_cast<std::uint32_t>(kv.second.frac.size()));
+    for (const auto &e : kv.second.frac) {
+      w.str(e.first.ch);
+      w.str(e.first.pr);
+      w.pod<double>(e.second);
+    }
+  }
+  w.pod<std::uint32_t>(static_cast<std::uint32_t>(shape_nuis_.size()));
+  for (const auto &kv : shape_nuis_) {
+    w.str(kv.second.name);
+    w.pod<std::uint32_t>(static_cast<std::uint32_t>(kv.second.updown.size()));
+    for (const auto &e : kv.second.updown) {
+      w.str(e.first.ch);
+      w.str(e.first.pr);
+      put_contents(w, *e.second.first);
+      put_contents(w, *e.second.second);
+    }
+  }
+
+  w.pod<std::uint32_t>(static_cast<std::uint32_t>(par_names_.size()));
+  for (const auto &n : par_names_) w.str(n);
+
+  auto &buf = w.buffer();
+  w.pod<std::uint64_t>(fnv1a(buf.data(), buf.size()));
+
+  const std::string tmp = path + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("save_workspace: cannot open " + tmp);
+    out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+    if (!out) throw std::runtime_error("save_workspace: write failed for " + tmp);
+  }
+  if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+    std::remove(tmp.c_str());
+    throw std::runtime_error("save_workspace: cannot rename " + tmp + " to " + path);
+  }
+}
+
+Fitter Fitter::load_workspace(const std::string &path) {
+  MappedFile file(path, "load_workspace");
+  constexpr std::size_t kHeader = sizeof(kMagic) + 2 * sizeof(std::uint32_t);
+  if (file.size() < kHeader + sizeof(std::uint64_t) || std::memcmp(file.data(), kMagic, sizeof(kMagic)) != 0)
+    throw std::runtime_error("load_workspace: not a workspace file: " + path);
+  const std::size_t body = file.size() - sizeof(std::uint64_t);
+  std::uint64_t stored;
+  std::memcpy(&stored, file.data() + body, sizeof(stored));
+  if (stored != fnv1a(file.data(), body)) throw std::runtime_error("load_workspace: checksum mismatch in " + path);
+
+  Reader r(file.data() + sizeof(kMagic), body - sizeof(kMagic), "load_workspace", path);
+  const auto version = r.pod<std::uint32_t>();
+  if (version != kVersion)
+    throw std::runtime_error("load_workspace: unsupported version " + std::to_string(version) + " in " + path);
+  if (r.pod<std::uint32_t>() != kByteOrder) throw std::runtime_error("load_workspace: byte order mismatch in " + path);
+
+  Fitter f(r.str());
+  f.sigma_ref_pb_ = r.pod<double>();
+  f.mu_lo_ = r.pod<double>();
+  f.mu_hi_ = r.pod<double>();
+  f.eps_ = r.pod<double>();
+  f.asym_errors_ = r.pod<std::uint8_t>() != 0;
+  f.asym_tol_ = r.pod<double>();
+
+  for (auto n = r.pod<std::uint32_t>(); n > 0; --n) {
+    Poi p;
+    p.name = r.str();
+    p.sigma_ref_pb = r.pod<double>();
+    p.lo = r.pod<double>();
+    p.hi = r.pod<double>();
+    f.pois_.push_back(std::move(p));
+  }
+  for (auto n = r.pod<std::uint32_t>(); n > 0; --n) {
+    std::string proc = r.str();
+    f.signal_poi_[proc] = r.str();
+  }
+
+  std::map<std::string, std::vector<double>> edges_of;
+  for (auto n = r.pod<std::uint32_t>(); n > 0; --n) {
+    Channel ch;
+    ch.name = r.str();
+    const auto edges = r.doubles();
+    if (edges.size() < 2) throw std::runtime_error("load_workspace: bad binning for channel " + ch.name);
+    ch.data = make_hist(ch.name + "__data", edges);
+    fill(r, *ch.data, path);
+    ch.nbins = ch.data->GetNbinsX();
+    for (auto np = r.pod<std::uint32_t>(); np > 0; --np) {
+      Process p;
+      p.name = r.str();
+      p.is_signal = r.pod<std::uint8_t>() != 0;
+      p.nominal = make_hist(ch.name + "__" + p.name + "__nom", edges);
+      fill(r, *p.nominal, path);
+      f.all_processes_.insert(p.name);
+      ch.processes.emplace(p.name, std::move(p));
+    }
+    if (!ch.processes.empty()) f.all_channels_.insert(ch.name);
+    edges_of[ch.name] = edges;
+    const std::string name = ch.name;
+    f.channels_.emplace(name, std::move(ch));
+  }
+
+  for (auto n = r.pod<std::uint32_t>(); n > 0; --n) {
+    NormNuisance nn;
+    nn.name = r.str();
+    nn.log_normal = r.pod<std::uint8_t>() != 0;
+    for (auto ne = r.pod<std::uint32_t>(); ne > 0; --ne) {
+      CPKey key;
+      key.ch = r.str();
+      key.pr = r.str();
+      nn.frac[key] = r.pod<double>();
+      if (!f.has_proc_(key.ch, key.pr))
+        throw std::runtime_error("load_workspace: norm effect on unknown (channel, process) " + key.ch + "," + key.pr);
+    }
+    const std::string name = nn.name;
+    f.norm_nuis_.emplace(name, std::move(nn));
+  }
+  for (auto n = r.pod<std::uint32_t>(); n > 0; --n) {
+    ShapeNuisance sn;
+    sn.name = r.str();
+    for (auto ne = r.pod<std::uint32_t>(); ne > 0; --ne) {
+      CPKey key;
+      key.ch = r.str();
+      key.pr = r.str();
+      if (!f.has_proc_(key.ch, key.pr))
+        throw std::runtime_error("load_workspace: shape effect on unknown (channel, process) " + key.ch + "," + key.pr);
+      const auto &edges = edges_of.at(key.ch);
+      const std::string stem = key.ch + "__" + key.pr + "__" + sn.name;
+      auto up = make_hist(stem + "__up", edges);
+      auto dn = make_hist(stem + "__down", edges);
+      fill(r, *up, path);
+      fill(r, *dn, path);
+      sn.updown[key] = std::make_pair(std::move(up), std::move(dn));
+    }
+    const std::string name = sn.name;
+    f.shape_nuis_.emplace(name, std::move(sn));
+  }
+
+  std::vector<std::string> names;
+  for (auto n = r.pod<std::uint32_t>(); n > 0; --n) names.push_back(r.str());
+  f.build_parameter_indexing_();
+  if (names != f.par_names_) throw std::runtime_error("load_workspace: parameter indexing mismatch in " + path);
+  return f;
+}
+
+} // namespace rarexsec::internal::fit
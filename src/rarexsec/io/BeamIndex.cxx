@@ -0,0 +1,397 @@
+#include "rarexsec/io/BeamIndex.h"
+#include "rarexsec/io/Binary.h"
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr char kMagic[4] = {'R', 'X', 'B', 'I'};
+constexpr std::uint32_t kVersion = 1;
+constexpr std::uint32_t kByteOrder = 0x01020304u;
+
+std::int64_t iso_to_utc(const unsigned char* s)
+{
+    if (!s)
+        return 0;
+    std::tm tm{};
+    if (!strptime(reinterpret_cast<const char*>(s), "%Y-%m-%dT%H:%M:%S", &tm))
+        return 0;
+    return static_cast<std::int64_t>(timegm(&tm));
+}
+
+std::array<std::string, 4> source_paths(const rarexsec::io::BeamSources& src)
+{
+    return {src.run_db, src.bnb_db, src.numi_db, src.numi_v4_db};
+}
+
+void append(std::string& out, const void* p, std::size_t n) { out.append(static_cast<const char*>(p), n); }
+
+template <class T>
+void append_pod(std::string& out, const T& v)
+{
+    append(out, &v, sizeof(T));
+}
+
+void pad8(std::string& out) { out.append((8 - out.size() % 8) % 8, '\0'); }
+
+// Header: magic, version, byte order, then per source the path and its stamp; padded to 8 bytes.
+std::string header(const rarexsec::io::BeamSources& src)
+{
+    std::string out(kMagic, sizeof(kMagic));
+    append_pod(out, kVersion);
+    append_pod(out, kByteOrder);
+    for (const auto& path : source_paths(src)) {
+        const auto st = path.empty() ? std::nullopt : rarexsec::io::stamp(path);
+        append_pod(out, static_cast<std::uint32_t>(path.size()));
+        out += path;
+        append_pod(out, st ? st->size : std::uint64_t(0));
+        append_pod(out, st ? st->mtime_ns : std::int64_t(0));
+    }
+    pad8(out);
+    return out;
+}
+
+class Db {
+  public:
+    explicit Db(const std::string& path)
+    {
+        if (sqlite3_open_v2(path.c_str(), &db_, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+            const std::string msg = db_ ? sqlite3_errmsg(db_) : "out of memory";
+            sqlite3_close(db_);
+            throw std::runtime_error("BeamIndex: cannot open " + path + ": " + msg);
+        }
+    }
+    ~Db() { sqlite3_close(db_); }
+    Db(const Db&) = delete;
+    Db& operator=(const Db&) = delete;
+
+    void exec(const std::string& sql)
+    {
+        char* err = nullptr;
+        if (sqlite3_exec(db_, sql.c_str(), nullptr, nullptr, &err) != SQLITE_OK) {
+            const std::string msg = err ? err : sqlite3_errmsg(db_);
+            sqlite3_free(err);
+            throw std::runtime_error("BeamIndex: " + msg);
+        }
+    }
+    sqlite3* get() const { return db_; }
+
+  private:
+    sqlite3* db_ = nullptr;
+};
+
+std::string quoted(const std::string& s)
+{
+    std::string out = "'";
+    for (char c : s)
+        out += c == '\'' ? std::string("''") : std::string(1, c);
+    return out + "'";
+}
+
+}
+
+//____________________________________________________________________________
+rarexsec::io::BeamTotals& rarexsec::io::BeamTotals::operator+=(const BeamRecord& r)
+{
+    pot_bnb += r.pot_bnb;
+    pot_fhc += r.pot_fhc;
+    pot_rhc += r.pot_rhc;
+    tortgt_wcut += r.tortgt_wcut;
+    ea9cnt_wcut += r.ea9cnt_wcut;
+    e1dcnt += r.e1dcnt;
+    ext_triggers += r.ext_triggers;
+    gate2_triggers += r.gate2_triggers;
+    ++subruns;
+    return *this;
+}
+//____________________________________________________________________________
+rarexsec::io::BeamTotals& rarexsec::io::BeamTotals::operator+=(const BeamTotals& o)
+{
+    pot_bnb += o.pot_bnb;
+    pot_fhc += o.pot_fhc;
+    pot_rhc += o.pot_rhc;
+    tortgt_wcut += o.tortgt_wcut;
+    ea9cnt_wcut += o.ea9cnt_wcut;
+    e1dcnt += o.e1dcnt;
+    ext_triggers += o.ext_triggers;
+    gate2_triggers += o.gate2_triggers;
+    subruns += o.subruns;
+    return *this;
+}
+//____________________________________________________________________________
+rarexsec::io::BeamTotals& rarexsec::io::BeamTotals::operator-=(const BeamTotals& o)
+{
+    pot_bnb -= o.pot_bnb;
+    pot_fhc -= o.pot_fhc;
+    pot_rhc -= o.pot_rhc;
+    tortgt_wcut -= o.tortgt_wcut;
+    ea9cnt_wcut -= o.ea9cnt_wcut;
+    e1dcnt -= o.e1dcnt;
+    ext_triggers -= o.ext_triggers;
+    gate2_triggers -= o.gate2_triggers;
+    subruns -= o.subruns;
+    return *this;
+}
+//____________________________________________________________________________
+rarexsec::io::BeamSources rarexsec::io::BeamSources::from_dir(const std::string& db_root, const std::string& slip_dir)
+{
+    namespace fs = std::filesystem;
+    auto pick = [&](const char* v2, const char* v1) {
+        const auto p = fs::path(db_root) / v2;
+        return (fs::exists(p) ? p : fs::path(db_root) / v1).string();
+    };
+    BeamSources src;
+    src.run_db = (fs::path(db_root) / "run.db").string();
+    src.bnb_db = pick("bnb_v2.db", "bnb_v1.db");
+    src.numi_db = pick("numi_v2.db", "numi_v1.db");
+    if (!slip_dir.empty())
+        src.numi_v4_db = (fs::path(slip_dir) / "numi_v4.db").string();
+    for (auto* p : {&src.bnb_db, &src.numi_db, &src.numi_v4_db})
+        if (!p->empty() && !fs::exists(*p))
+            p->clear();
+    return src;
+}
+//____________________________________________________________________________
+void rarexsec::io::BeamIndex::build(const BeamSources& src, const std::string& path)
+{
+    if (src.run_db.empty())
+        throw std::runtime_error("BeamIndex::build: no run database");
+    Db db(src.run_db);
+    const bool bnb = !src.bnb_db.empty(), numi = !src.numi_db.empty(), n4 = !src.numi_v4_db.empty();
+    if (bnb)
+        db.exec("ATTACH DATABASE " + quoted(src.bnb_db) + " AS bnb;");
+    if (numi)
+        db.exec("ATTACH DATABASE " + quoted(src.numi_db) + " AS numi;");
+    if (n4)
+        db.exec("ATTACH DATABASE " + quoted(src.numi_v4_db) + " AS n4;");
+
+    // beam databases can hold repeated (run, subrun) rows; they are collapsed with MAX
+    std::string sql =
+        "SELECT r.run, r.subrun, r.begin_time, r.end_time, IFNULL(r.EXTTrig,0), IFNULL(r.Gate2Trig,0), "
+        "IFNULL(r.E1DCNT,0), IFNULL(r.tor860,0), IFNULL(r.tor875,0), ";
+    sql += bnb ? "b.run IS NOT NULL, IFNULL(b.E1DCNT,0), IFNULL(b.tor860,0), IFNULL(b.tor875,0), "
+               : "0, 0, 0, 0, ";
+    sql += n4 ? "IFNULL(f.EA9CNT_fhc,0), IFNULL(f.tortgt_fhc,0), IFNULL(f.tor101_fhc,0), "
+                "IFNULL(f.EA9CNT_rhc,0), IFNULL(f.tortgt_rhc,0), IFNULL(f.tor101_rhc,0), "
+              : "0, 0, 0, 0, 0, 0, ";
+    sql += numi ? "n.run IS NOT NULL, IFNULL(n.EA9CNT_wcut,0), IFNULL(n.tortgt_wcut,0) " : "0, 0, 0 ";
+    sql += "FROM runinfo r ";
+    if (bnb)
+        sql += "LEFT JOIN (SELECT run, subrun, MAX(E1DCNT) AS E1DCNT, MAX(tor860) AS tor860, MAX(tor875) AS tor875 "
+               "FROM bnb.bnb GROUP BY run, subrun) b ON r.run=b.run AND r.subrun=b.subrun ";
+    if (n4)
+        sql += "LEFT JOIN (SELECT run, subrun, MAX(EA9CNT_fhc) AS EA9CNT_fhc, MAX(tortgt_fhc) AS tortgt_fhc, "
+               "MAX(tor101_fhc) AS tor101_fhc, MAX(EA9CNT_rhc) AS EA9CNT_rhc, MAX(tortgt_rhc) AS tortgt_rhc, "
+               "MAX(tor101_rhc) AS tor101_rhc FROM n4.numi GROUP BY run, subrun) f "
+               "ON r.run=f.run AND r.subrun=f.subrun ";
+    if (numi)
+        sql += "LEFT JOIN (SELECT run, subrun, MAX(EA9CNT_wcut) AS EA9CNT_wcut, MAX(tortgt_wcut) AS tortgt_wcut "
+               "FROM numi.numi GROUP BY run, subrun) n ON r.run=n.run AND r.subrun=n.subrun ";
+    sql += "ORDER BY r.run, r.subrun;";
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db.get(), sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+        throw std::runtime_error(std::string("BeamIndex::build: ") + sqlite3_errmsg(db.get()));
+
+    std::vector<BeamRecord> records;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        auto d = [&](int i) { return sqlite3_column_double(stmt, i); };
+        BeamRecord r;
+        r.run = static_cast<std::uint32_t>(sqlite3_column_int64(stmt, 0));
+        r.subrun = static_cast<std::uint32_t>(sqlite3_column_int64(stmt, 1));
+        if (!records.empty() && records.back().run == r.run && records.back().subrun == r.subrun)
+            continue;
+        r.begin_time = iso_to_utc(sqlite3_column_text(stmt, 2));
+        r.end_time = iso_to_utc(sqlite3_column_text(stmt, 3));
+        r.ext_triggers = d(4);
+        r.gate2_triggers = d(5);
+
+        const bool in_bnb = sqlite3_column_int(stmt, 9) != 0;
+        r.e1dcnt = in_bnb ? d(10) : d(6);
+        const double tor875 = d(12) > 0 ? d(12) : d(8);
+        const double tor860 = d(11) > 0 ? d(11) : d(7);
+        r.pot_bnb = 1e12 * (tor875 > 0 ? tor875 : tor860);
+
+        if (d(13) > 0)
+            r.pot_fhc = 1e12 * (d(14) > 0 ? d(14) : d(15));
+        if (d(16) > 0)
+            r.pot_rhc = 1e12 * (d(17) > 0 ? d(17) : d(18));
+
+        const bool in_numi = sqlite3_column_int(stmt, 19) != 0;
+        r.ea9cnt_wcut = d(20);
+        r.tortgt_wcut = d(21);
+
+        r.flags = (r.pot_bnb > 0 ? BeamRecord::Bnb : 0u) | (r.pot_fhc > 0 ? BeamRecord::Fhc : 0u) |
+                  (r.pot_rhc > 0 ? BeamRecord::Rhc : 0u) | (in_bnb ? BeamRecord::BnbDb : 0u) |
+                  (in_numi ? BeamRecord::NumiDb : 0u);
+        records.push_back(r);
+    }
+    const std::string err = rc == SQLITE_DONE ? "" : sqlite3_errmsg(db.get());
+    sqlite3_finalize(stmt);
+    if (!err.empty())
+        throw std::runtime_error("BeamIndex::build: " + err);
+
+    std::string out = header(src);
+    append_pod(out, static_cast<std::uint64_t>(records.size()));
+    append(out, records.data(), records.size() * sizeof(BeamRecord));
+    BeamTotals sum;
+    append_pod(out, sum);
+    for (const auto& r : records) {
+        sum += r;
+        append_pod(out, sum);
+    }
+
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary);
+        if (!f)
+            throw std::runtime_error("BeamIndex::build: cannot open " + tmp);
+        f.write(out.data(), static_cast<std::streamsize>(out.size()));
+        if (!f)
+            throw std::runtime_error("BeamIndex::build: write failed for " + tmp);
+    }
+    std::filesystem::rename(tmp, path);
+}
+//____________________________________________________________________________
+struct rarexsec::io::BeamIndex::Mapping : rarexsec::io::binary::MappedFile {
+    explicit Mapping(const std::string& path) : MappedFile(path, "BeamIndex") {}
+};
+//____________________________________________________________________________
+rarexsec::io::BeamIndex rarexsec::io::BeamIndex::load(const std::string& path)
+{
+    auto map = std::make_shared<const Mapping>(path);
+    const unsigned char* p = map->data();
+    const std::size_t size = map->size();
+    auto bad = [&](const char* what) { return std::runtime_error("BeamIndex::load: " + path + ": " + what); };
+
+    std::uint32_t version = 0, order = 0;
+    if (size < sizeof(kMagic) + 8 || std::memcmp(p, kMagic, sizeof(kMagic)) != 0)
+        throw bad("not a beam index");
+    std::memcpy(&version, p + 4, 4);
+    std::memcpy(&order, p + 8, 4);
+    if (version != kVersion)
+        throw bad("unsupported version");
+    if (order != kByteOrder)
+        throw bad("written with a different byte order");
+
+    std::size_t off = 12;
+    for (int i = 0; i < 4; ++i) {
+        std::uint32_t len = 0;
+        if (off + 4 > size)
+            throw bad("truncated header");
+        std::memcpy(&len, p + off, 4);
+        off += 4 + std::size_t(len) + 16;
+    }
+    off += (8 - off % 8) % 8;
+    std::uint64_t n = 0;
+    if (off + 8 > size)
+        throw bad("truncated header");
+    std::memcpy(&n, p + off, 8);
+    off += 8;
+    if (size != off + n * sizeof(BeamRecord) + (n + 1) * sizeof(BeamTotals))
+        throw bad("size does not match record count");
+
+    BeamIndex idx;
+    idx.rec_ = reinterpret_cast<const BeamRecord*>(p + off);
+    idx.prefix_ = reinterpret_cast<const BeamTotals*>(p + off + n * sizeof(BeamRecord));
+    idx.n_ = static_cast<std::size_t>(n);
+    idx.map_ = std::move(map);
+    return idx;
+}
+//____________________________________________________________________________
+bool rarexsec::io::BeamIndex::current(const std::string& path, const BeamSources& src)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    const std::string want = header(src);
+    std::string have(want.size(), '\0');
+    in.read(have.data(), static_cast<std::streamsize>(have.size()));
+    return in && have == want;
+}
+//____________________________________________________________________________
+rarexsec::io::BeamIndex rarexsec::io::BeamIndex::open(const std::string& path, const BeamSources& src)
+{
+    if (current(path, src)) {
+        try {
+            return load(path);
+        } catch (const std::runtime_error&) {
+            // rebuilt below
+        }
+    }
+    build(src, path);
+    return load(path);
+}
+//____________________________________________________________________________
+std::size_t rarexsec::io::BeamIndex::lower(const Key& k) const noexcept
+{
+    return static_cast<std::size_t>(std::lower_bound(rec_, rec_ + n_, k, [](const BeamRecord& r, const Key& key) {
+                                        return Key(r.run, r.subrun) < key;
+                                    }) - rec_);
+}
+//____________________________________________________________________________
+const rarexsec::io::BeamRecord* rarexsec::io::BeamIndex::find(std::uint32_t run, std::uint32_t subrun) const noexcept
+{
+    const std::size_t i = lower({run, subrun});
+    return i < n_ && rec_[i].run == run && rec_[i].subrun == subrun ? rec_ + i : nullptr;
+}
+//____________________________________________________________________________
+rarexsec::io::BeamTotals rarexsec::io::BeamIndex::runs(std::uint32_t first, std::uint32_t last) const noexcept
+{
+    if (n_ == 0 || last < first)
+        return {};
+    const std::size_t lo = lower({first, 0});
+    const std::size_t hi = last == UINT32_MAX ? n_ : lower({last + 1, 0});
+    BeamTotals t = prefix_[hi];
+    t -= prefix_[lo];
+    return t;
+}
+//____________________________________________________________________________
+rarexsec::io::BeamTotals rarexsec::io::BeamIndex::runs(const std::vector<std::uint32_t>& runs_in) const
+{
+    std::vector<std::uint32_t> rs(runs_in);
+    std::sort(rs.begin(), rs.end());
+    rs.erase(std::unique(rs.begin(), rs.end()), rs.end());
+    BeamTotals t;
+    for (auto r : rs)
+        t += runs(r, r);
+    return t;
+}
+//____________________________________________________________________________
+rarexsec::io::BeamTotals rarexsec::io::BeamIndex::subruns(std::vector<Key> keys, std::vector<Key>* missing) const
+{
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    BeamTotals t;
+    std::size_t i = 0;
+    for (const auto& k : keys) {
+        // keys are sorted, so each search starts where the previous one ended
+        i = static_cast<std::size_t>(std::lower_bound(rec_ + i, rec_ + n_, k, [](const BeamRecord& r, const Key& key) {
+                                         return Key(r.run, r.subrun) < key;
+                                     }) - rec_);
+        if (i < n_ && rec_[i].run == k.first && rec_[i].subrun == k.second)
+            t += rec_[i];
+        else if (missing)
+            missing->push_back(k);
+    }
+    return t;
+}
+//____________________________________________________________________________
+rarexsec::io::BeamTotals rarexsec::io::BeamIndex::between(std::int64_t t0, std::int64_t t1) const noexcept
+{
+    BeamTotals t;
+    for (const BeamRecord* r = rec_; r != rec_ + n_; ++r)
+        if (r->begin_time >= t0 && r->begin_time < t1)
+            t += *r;
+    return t;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include "rarexsec/io/EntryIndex.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace rarexsec::io {
+
+// One (run, subrun) of the beam databases. POT are in protons (toroid counts x 1e12) and follow
+// the POT timeline: BNB prefers tor875 over tor860 and the bnb DB over runinfo; NuMI prefers
+// tortgt over tor101 and is zero unless EA9CNT for that horn mode is positive. tortgt_wcut and
+// ea9cnt_wcut are the beam-quality-cut NuMI counts in database units.
+struct BeamRecord {
+    enum Flag : std::uint32_t { Bnb = 1u << 0, Fhc = 1u << 1, Rhc = 1u << 2, BnbDb = 1u << 3, NumiDb = 1u << 4 };
+
+    std::uint32_t run = 0;
+    std::uint32_t subrun = 0;
+    std::int64_t begin_time = 0;
+    std::int64_t end_time = 0;
+    double pot_bnb = 0.0;
+    double pot_fhc = 0.0;
+    double pot_rhc = 0.0;
+    double tortgt_wcut = 0.0;
+    double ea9cnt_wcut = 0.0;
+    double e1dcnt = 0.0;
+    double ext_triggers = 0.0;
+    double gate2_triggers = 0.0;
+    std::uint32_t flags = 0;
+    std::uint32_t reserved = 0;
+};
+static_assert(std::is_trivially_copyable_v<BeamRecord> && sizeof(BeamRecord) == 96);
+
+struct BeamTotals {
+    double pot_bnb = 0.0;
+    double pot_fhc = 0.0;
+    double pot_rhc = 0.0;
+    double tortgt_wcut = 0.0;
+    double ea9cnt_wcut = 0.0;
+    double e1dcnt = 0.0;
+    double ext_triggers = 0.0;
+    double gate2_triggers = 0.0;
+    std::uint64_t subruns = 0;
+
+    BeamTotals& operator+=(const BeamRecord& r);
+    BeamTotals& operator+=(const BeamTotals& o);
+    BeamTotals& operator-=(const BeamTotals& o);
+};
+static_assert(std::is_trivially_copyable_v<BeamTotals>);
+
+// Local copies of the beam databases; any may be empty except run_db.
+struct BeamSources {
+    std::string run_db;
+    std::string bnb_db;
+    std::string numi_db;
+    std::string numi_v4_db;
+
+    // The layout of the uboonebeam beamdb directory (bnb_v2/numi_v2 falling back to v1), with
+    // numi_v4.db taken from slip_dir when given.
+    static BeamSources from_dir(const std::string& db_root, const std::string& slip_dir = "");
+};
+
+// Sorted (run, subrun) table built once from the beam databases and memory-mapped afterwards.
+// Prefix sums are stored with the records, so run-range totals are two binary searches and
+// subrun lists cost one search per entry.
+class BeamIndex {
+  public:
+    using Key = std::pair<std::uint32_t, std::uint32_t>;
+
+    // Maps path, rebuilding it first when it is missing, unreadable or built from other files.
+    static BeamIndex open(const std::string& path, const BeamSources& src);
+    // Queries the databases and writes the index to a temporary renamed into place; throws
+    // std::runtime_error on database or I/O errors.
+    static void build(const BeamSources& src, const std::string& path);
+    // Throws std::runtime_error when path is not a valid index.
+    static BeamIndex load(const std::string& path);
+
+    std::size_t size() const noexcept { return n_; }
+    const BeamRecord* begin() const noexcept { return rec_; }
+    const BeamRecord* end() const noexcept { return rec_ + n_; }
+    const BeamRecord* find(std::uint32_t run, std::uint32_t subrun) const noexcept;
+
+    // Inclusive run range.
+    BeamTotals runs(std::uint32_t first, std::uint32_t last) const noexcept;
+    BeamTotals runs(const std::vector<std::uint32_t>& runs) const;
+    // Duplicates count once; pairs absent from the index are appended to missing when given.
+    BeamTotals subruns(std::vector<Key> keys, std::vector<Key>* missing = nullptr) const;
+    // Subruns whose begin_time lies in [t0, t1), UTC seconds; a linear scan.
+    BeamTotals between(std::int64_t t0, std::int64_t t1) const noexcept;
+
+  private:
+    struct Mapping;
+    static bool current(const std::string& path, const BeamSources& src);
+    std::size_t lower(const Key& k) const noexcept;
+
+    std::shared_ptr<const Mapping> map_;
+    const BeamRecord* rec_ = nullptr;
+    const BeamTotals* prefix_ = nullptr;
+    std::size_t n_ = 0;
+};
+
+}
@@ -0,0 +1,184 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Helpers shared by the library's own file formats and file names, so that their hashes and
+// encodings cannot drift apart. Internal: not part of the dictionary.
+namespace rarexsec::io::binary {
+
+// 64-bit FNV-1a. Unlike std::hash it is the same for every compiler and standard library, so it
+// can name and check files that outlive a build.
+inline std::uint64_t fnv1a(const void* data, std::size_t n)
+{
+    const auto* p = static_cast<const unsigned char*>(data);
+    std::uint64_t h = 0xcbf29ce484222325ull;
+    for (std::size_t i = 0; i < n; ++i) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+inline std::uint64_t fnv1a(const std::string& s) { return fnv1a(s.data(), s.size()); }
+
+// 16 lower-case hex digits.
+inline std::string hex(std::uint64_t v)
+{
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(v));
+    return buf;
+}
+
+// Tag of the directory holding file, for files derived from it that are collected in one
+// directory: keeps those of same-named files from different directories apart.
+inline std::string dir_tag(const std::string& file)
+{
+    return hex(fnv1a(std::filesystem::absolute(std::filesystem::path(file)).parent_path().string()));
+}
+
+// Unsigned LEB128.
+inline void put_varint(std::string& out, std::uint64_t v)
+{
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+// false when in ends inside the varint or it exceeds 64 bits.
+inline bool get_varint(const std::string& in, std::size_t& pos, std::uint64_t& v)
+{
+    v = 0;
+    for (int shift = 0; shift < 64 && pos < in.size(); shift += 7) {
+        const auto byte = static_cast<unsigned char>(in[pos++]);
+        v |= std::uint64_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+// Appends the fixed-layout records of the checksummed formats (native endianness): PODs as their
+// bytes, strings as u32 length + bytes, arrays as u32 count + raw doubles.
+class Writer {
+  public:
+    template <typename T> void pod(T v) { buf_.append(reinterpret_cast<const char*>(&v), sizeof(T)); }
+    void str(const std::string& s)
+    {
+        pod<std::uint32_t>(static_cast<std::uint32_t>(s.size()));
+        buf_.append(s);
+    }
+    void doubles(const double* v, std::size_t n)
+    {
+        pod<std::uint32_t>(static_cast<std::uint32_t>(n));
+        buf_.append(reinterpret_cast<const char*>(v), n * sizeof(double));
+    }
+    std::string& buffer() { return buf_; }
+
+  private:
+    std::string buf_;
+};
+
+// Reads what Writer wrote from n bytes at p, throwing "<what>: truncated file <path>" on a short
+// read. Does not own the bytes.
+class Reader {
+  public:
+    Reader(const void* p, std::size_t n, std::string what, std::string path)
+        : p_(static_cast<const char*>(p)), end_(p_ + n), what_(std::move(what)), path_(std::move(path)) {}
+    template <typename T> T pod()
+    {
+        T v;
+        bytes(&v, sizeof(T));
+        return v;
+    }
+    std::string str()
+    {
+        const auto n = pod<std::uint32_t>();
+        need_(n);
+        std::string s(p_, n);
+        p_ += n;
+        return s;
+    }
+    std::vector<double> doubles()
+    {
+        const auto n = pod<std::uint32_t>();
+        std::vector<double> v(n);
+        bytes(v.data(), std::size_t(n) * sizeof(double));
+        return v;
+    }
+    // Copies the next n bytes to out, e.g. straight into a histogram's bin array.
+    void bytes(void* out, std::size_t n)
+    {
+        need_(n);
+        std::memcpy(out, p_, n);
+        p_ += n;
+    }
+    bool done() const { return p_ == end_; }
+
+  private:
+    void need_(std::size_t n) const
+    {
+        if (static_cast<std::size_t>(end_ - p_) < n)
+            throw std::runtime_error(what_ + ": truncated file " + path_);
+    }
+    const char* p_;
+    const char* end_;
+    std::string what_;
+    std::string path_;
+};
+
+// Read-only mapping of a whole file, unmapped on destruction; failures throw "<what>: cannot
+// open|stat|map <path>".
+class MappedFile {
+  public:
+    MappedFile(const std::string& path, const std::string& what)
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error(what + ": cannot open " + path);
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error(what + ": cannot stat " + path);
+        }
+        size_ = static_cast<std::size_t>(st.st_size);
+        if (size_ > 0) {
+            void* m = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error(what + ": cannot map " + path);
+            }
+            data_ = static_cast<const unsigned char*>(m);
+        }
+        ::close(fd);
+    }
+    ~MappedFile()
+    {
+        if (data_)
+            ::munmap(const_cast<unsigned char*>(data_), size_);
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+  private:
+    const unsigned char* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+}
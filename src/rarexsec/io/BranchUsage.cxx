@@ -0,0 +1,141 @@
+#include "rarexsec/io/BranchUsage.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+bool is_ident_start(char c) { return std::isalpha(static_cast<unsigned char>(c)) || c == '_'; }
+bool is_ident(char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; }
+
+// RDataFrame's own columns and this library's temporaries are never input branches
+bool is_internal(const std::string& name) { return name.rfind("rdf", 0) == 0 || name.rfind("_rx_", 0) == 0; }
+}
+
+//____________________________________________________________________________
+void rarexsec::io::BranchUsage::request(const std::string& column)
+{
+    if (column.empty() || is_internal(column))
+        return;
+    std::lock_guard<std::mutex> lk(m_);
+    requested_.insert(column);
+}
+//____________________________________________________________________________
+void rarexsec::io::BranchUsage::request(const std::vector<std::string>& columns)
+{
+    for (const auto& c : columns)
+        request(c);
+}
+//____________________________________________________________________________
+void rarexsec::io::BranchUsage::request_expression(const std::string& expr)
+{
+    for (std::size_t i = 0; i < expr.size();) {
+        if (expr[i] == '"' || expr[i] == '\'') {
+            const char q = expr[i++];
+            while (i < expr.size() && expr[i] != q)
+                i += (expr[i] == '\\' ? 2 : 1);
+            ++i;
+        } else if (is_ident_start(expr[i]) &&
+                   (i == 0 || !(is_ident(expr[i - 1]) || expr[i - 1] == '.' || expr[i - 1] == ':' ||
+                                (expr[i - 1] == '>' && i >= 2 && expr[i - 2] == '-')))) {
+            std::size_t j = i;
+            while (j < expr.size() && is_ident(expr[j]))
+                ++j;
+            // skip namespace qualifiers; qualified and member names are excluded above
+            if (!(j + 1 < expr.size() && expr[j] == ':' && expr[j + 1] == ':'))
+                request(expr.substr(i, j - i));
+            i = j;
+        } else {
+            ++i;
+        }
+    }
+}
+//____________________________________________________________________________
+void rarexsec::io::BranchUsage::define(const std::string& column, const std::vector<std::string>& inputs)
+{
+    std::lock_guard<std::mutex> lk(m_);
+    defined_[column] = inputs;
+}
+//____________________________________________________________________________
+std::set<std::string> rarexsec::io::BranchUsage::resolve() const
+{
+    std::lock_guard<std::mutex> lk(m_);
+    std::set<std::string> out, seen;
+    std::vector<std::string> todo(requested_.begin(), requested_.end());
+    while (!todo.empty()) {
+        const std::string c = std::move(todo.back());
+        todo.pop_back();
+        if (!seen.insert(c).second)
+            continue;
+        auto it = defined_.find(c);
+        if (it == defined_.end()) {
+            if (!is_internal(c))
+                out.insert(c);
+            continue;
+        }
+        todo.insert(todo.end(), it->second.begin(), it->second.end());
+    }
+    return out;
+}
+//____________________________________________________________________________
+std::set<std::string> rarexsec::io::BranchUsage::definition_inputs() const
+{
+    std::lock_guard<std::mutex> lk(m_);
+    std::set<std::string> out;
+    for (const auto& kv : defined_)
+        for (const auto& c : kv.second)
+            if (!defined_.count(c) && !is_internal(c))
+                out.insert(c);
+    return out;
+}
+//____________________________________________________________________________
+void rarexsec::io::BranchUsage::append_log(const std::string& path, const std::string& job) const
+{
+    const auto branches = resolve();
+    if (branches.empty())
+        return;
+    std::ofstream out(path, std::ios::app);
+    if (!out)
+        throw std::runtime_error("BranchUsage: cannot open " + path);
+    for (const auto& b : branches)
+        out << job << '\t' << b << '\n';
+}
+//____________________________________________________________________________
+rarexsec::io::BranchUsage::~BranchUsage()
+{
+    const char* path = std::getenv("RAREXSEC_USAGE_LOG");
+    if (!path || !*path)
+        return;
+    const char* job = std::getenv("RAREXSEC_JOB");
+    try {
+        append_log(path, (job && *job) ? job : "default");
+    } catch (const std::exception& ex) {
+        std::cerr << "[BranchUsage] " << ex.what() << std::endl;
+    }
+}
+//____________________________________________________________________________
+rarexsec::io::BranchUsage& rarexsec::io::branch_usage()
+{
+    static BranchUsage usage;
+    return usage;
+}
+//____________________________________________________________________________
+std::set<std::string> rarexsec::io::read_usage_log(const std::string& path, const std::vector<std::string>& jobs)
+{
+    std::ifstream in(path);
+    if (!in)
+        throw std::runtime_error("read_usage_log: cannot open " + path);
+    const std::set<std::string> wanted(jobs.begin(), jobs.end());
+    std::set<std::string> out;
+    std::string line;
+    while (std::getline(in, line)) {
+        const auto tab = line.find('\t');
+        if (tab == std::string::npos)
+            continue;
+        if (wanted.empty() || wanted.count(line.substr(0, tab)))
+            out.insert(line.substr(tab + 1));
+    }
+    return out;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace rarexsec::io {
+
+// Process-wide record of the columns a job asks for, at the points where this library hands
+// column names or expressions to RDataFrame (selections, Processor definitions, histogram specs,
+// snapshots). Defined columns are expanded through their recorded inputs, so resolve() yields the
+// input-tree branches the job can read. Unknown identifiers are harmless: consumers intersect the
+// result with the real branch list.
+//
+// With RAREXSEC_USAGE_LOG set, the resolved set is appended to that file at exit as
+// "<job>\t<branch>" lines; the job label is RAREXSEC_JOB, or "default".
+class BranchUsage {
+  public:
+    void request(const std::string& column);
+    void request(const std::vector<std::string>& columns);
+    // Every identifier in a JIT expression is treated as a requested column.
+    void request_expression(const std::string& expr);
+    void define(const std::string& column, const std::vector<std::string>& inputs);
+
+    std::set<std::string> resolve() const;
+    // Inputs of every defined column that are not themselves defined, i.e. the branches the
+    // recorded definitions need to exist.
+    std::set<std::string> definition_inputs() const;
+    void append_log(const std::string& path, const std::string& job) const;
+
+    ~BranchUsage();
+
+  private:
+    mutable std::mutex m_;
+    std::set<std::string> requested_;
+    std::unordered_map<std::string, std::vector<std::string>> defined_;
+};
+
+BranchUsage& branch_usage();
+
+// Union of the branches logged for the given jobs (all jobs when empty).
+std::set<std::string> read_usage_log(const std::string& path, const std::vector<std::string>& jobs = {});
+
+}
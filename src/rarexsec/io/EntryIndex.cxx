@@ -0,0 +1,150 @@
+#include "rarexsec/io/EntryIndex.h"
+#include "rarexsec/io/Binary.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <sys/stat.h>
+
+namespace {
+constexpr char kMagic[4] = {'R', 'X', 'E', 'I'};
+constexpr std::uint32_t kFormatVersion = 1;
+
+using rarexsec::io::binary::put_varint;
+using rarexsec::io::binary::get_varint;
+
+std::string header(const rarexsec::io::FileStamp& st, const std::string& preset, unsigned processor_version)
+{
+    std::string h(kMagic, sizeof(kMagic));
+    put_varint(h, kFormatVersion);
+    put_varint(h, processor_version);
+    put_varint(h, preset.size());
+    h += preset;
+    put_varint(h, st.size);
+    put_varint(h, static_cast<std::uint64_t>(st.mtime_ns));
+    return h;
+}
+}
+
+//____________________________________________________________________________
+rarexsec::io::EntryRanges rarexsec::io::EntryRanges::from_entries(std::vector<std::uint64_t> entries)
+{
+    std::sort(entries.begin(), entries.end());
+    EntryRanges out;
+    for (std::uint64_t e : entries) {
+        if (!out.ranges_.empty() && e < out.ranges_.back().second)
+            continue;
+        if (!out.ranges_.empty() && e == out.ranges_.back().second)
+            ++out.ranges_.back().second;
+        else
+            out.ranges_.emplace_back(e, e + 1);
+    }
+    return out;
+}
+//____________________________________________________________________________
+std::uint64_t rarexsec::io::EntryRanges::count() const noexcept
+{
+    std::uint64_t n = 0;
+    for (const auto& r : ranges_)
+        n += r.second - r.first;
+    return n;
+}
+//____________________________________________________________________________
+std::string rarexsec::io::EntryRanges::encode() const
+{
+    std::string out;
+    put_varint(out, ranges_.size());
+    std::uint64_t prev = 0;
+    for (const auto& r : ranges_) {
+        put_varint(out, r.first - prev);
+        put_varint(out, r.second - r.first);
+        prev = r.second;
+    }
+    return out;
+}
+//____________________________________________________________________________
+rarexsec::io::EntryRanges rarexsec::io::EntryRanges::decode(const std::string& bytes)
+{
+    EntryRanges out;
+    std::size_t pos = 0;
+    std::uint64_t n = 0;
+    if (!get_varint(bytes, pos, n))
+        throw std::runtime_error("EntryRanges::decode: truncated range count");
+    std::uint64_t prev = 0;
+    for (std::uint64_t i = 0; i < n; ++i) {
+        std::uint64_t gap = 0, len = 0;
+        if (!get_varint(bytes, pos, gap) || !get_varint(bytes, pos, len))
+            throw std::runtime_error("EntryRanges::decode: truncated range list");
+        if (len == 0 || (i > 0 && gap == 0))
+            throw std::runtime_error("EntryRanges::decode: malformed range list");
+        const std::uint64_t begin = prev + gap;
+        out.ranges_.emplace_back(begin, begin + len);
+        prev = begin + len;
+    }
+    if (pos != bytes.size())
+        throw std::runtime_error("EntryRanges::decode: trailing bytes");
+    return out;
+}
+//____________________________________________________________________________
+std::optional<rarexsec::io::FileStamp> rarexsec::io::stamp(const std::string& file)
+{
+    struct stat st;
+    if (file.find("://") != std::string::npos || ::stat(file.c_str(), &st) != 0)
+        return std::nullopt;
+    FileStamp out;
+    out.size = static_cast<std::uint64_t>(st.st_size);
+    out.mtime_ns = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+    return out;
+}
+//____________________________________________________________________________
+std::string rarexsec::io::index_path(const std::string& file, const std::string& preset,
+                                     unsigned processor_version, const std::string& dir)
+{
+    const std::filesystem::path in(file);
+    const std::string name = in.filename().string() + "." + preset + ".v" + std::to_string(processor_version) +
+                             ".rxidx";
+    if (dir.empty())
+        return (in.parent_path() / name).string();
+    return (std::filesystem::path(dir) / (binary::dir_tag(file) + "." + name)).string();
+}
+//____________________________________________________________________________
+std::optional<rarexsec::io::EntryRanges>
+rarexsec::io::read_index(const std::string& path, const FileStamp& st, const std::string& preset,
+                         unsigned processor_version)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return std::nullopt;
+    const std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    const std::string expect = header(st, preset, processor_version);
+    if (bytes.size() < expect.size() || bytes.compare(0, expect.size(), expect) != 0)
+        return std::nullopt;
+    try {
+        return EntryRanges::decode(bytes.substr(expect.size()));
+    } catch (const std::runtime_error&) {
+        return std::nullopt;
+    }
+}
+//____________________________________________________________________________
+void rarexsec::io::write_index(const std::string& path, const FileStamp& st, const std::string& preset,
+                               unsigned processor_version, const EntryRanges& ranges)
+{
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out)
+            throw std::runtime_error("write_index: cannot open " + tmp);
+        const std::string bytes = header(st, preset, processor_version) + ranges.encode();
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        if (!out)
+            throw std::runtime_error("write_index: write failed for " + tmp);
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        throw std::runtime_error("write_index: cannot rename " + tmp + " to " + path);
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rarexsec::io {
+
+// Sorted, disjoint half-open [begin, end) ranges of tree entry numbers within one input file.
+class EntryRanges {
+  public:
+    using Range = std::pair<std::uint64_t, std::uint64_t>;
+
+    // entries need not be sorted; duplicates are dropped.
+    static EntryRanges from_entries(std::vector<std::uint64_t> entries);
+
+    const std::vector<Range>& ranges() const noexcept { return ranges_; }
+    std::uint64_t count() const noexcept;
+    bool empty() const noexcept { return ranges_.empty(); }
+
+    // LEB128 varints of (gap to previous end, length) per range.
+    std::string encode() const;
+    static EntryRanges decode(const std::string& bytes);
+
+  private:
+    std::vector<Range> ranges_;
+};
+
+// Identity of an input file at indexing time; a stale stamp invalidates the index.
+struct FileStamp {
+    std::uint64_t size = 0;
+    std::int64_t mtime_ns = 0;
+    bool operator==(const FileStamp& o) const { return size == o.size && mtime_ns == o.mtime_ns; }
+};
+
+// nullopt for files that cannot be stat'ed locally (e.g. remote URLs).
+std::optional<FileStamp> stamp(const std::string& file);
+
+// Sidecar path for (file, preset, processor version): next to the file, or in dir when non-empty.
+std::string index_path(const std::string& file, const std::string& preset, unsigned processor_version,
+                       const std::string& dir = "");
+
+// nullopt when the index is missing, corrupt or was built for a different stamp or key.
+std::optional<EntryRanges> read_index(const std::string& path, const FileStamp& st, const std::string& preset,
+                                      unsigned processor_version);
+// Written to a temporary and renamed into place; throws std::runtime_error on I/O failure.
+void write_index(const std::string& path, const FileStamp& st, const std::string& preset,
+                 unsigned processor_version, const EntryRanges& ranges);
+
+}
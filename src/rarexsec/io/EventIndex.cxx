@@ -0,0 +1,222 @@
+#include "rarexsec/io/EventIndex.h"
+#include "rarexsec/io/Binary.h"
+#include "rarexsec/io/EntryIndex.h"
+
+#include <TBranch.h>
+#include <TFile.h>
+#include <TLeaf.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+
+namespace {
+constexpr char kMagic[4] = {'R', 'X', 'E', 'V'};
+constexpr std::uint64_t kFormatVersion = 1;
+
+using Keys = std::vector<rarexsec::io::EventKey>;
+
+using rarexsec::io::binary::get_varint;
+using rarexsec::io::binary::put_varint;
+
+// consecutive entries mostly share run and sub and step evt by a little
+std::uint64_t zigzag(std::int64_t v) { return (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63); }
+std::int64_t unzigzag(std::uint64_t v) { return static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1); }
+
+std::string header(const rarexsec::io::FileStamp& st, const std::string& tree,
+                   const rarexsec::io::EventColumns& cols)
+{
+    std::string h(kMagic, sizeof(kMagic));
+    put_varint(h, kFormatVersion);
+    for (const std::string* s : {&tree, &cols.run, &cols.sub, &cols.evt}) {
+        put_varint(h, s->size());
+        h += *s;
+    }
+    put_varint(h, st.size);
+    put_varint(h, static_cast<std::uint64_t>(st.mtime_ns));
+    return h;
+}
+
+std::optional<Keys> read_keys(const std::string& path, const std::string& expect)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return std::nullopt;
+    const std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (bytes.size() < expect.size() || bytes.compare(0, expect.size(), expect) != 0)
+        return std::nullopt;
+    std::size_t pos = expect.size();
+    std::uint64_t n = 0;
+    if (!get_varint(bytes, pos, n) || n > bytes.size())
+        return std::nullopt;
+    Keys keys(static_cast<std::size_t>(n));
+    std::int64_t prev[3] = {0, 0, 0};
+    for (auto& k : keys) {
+        int* dst[3] = {&k.run, &k.sub, &k.evt};
+        for (int c = 0; c < 3; ++c) {
+            std::uint64_t v = 0;
+            if (!get_varint(bytes, pos, v))
+                return std::nullopt;
+            prev[c] += unzigzag(v);
+            *dst[c] = static_cast<int>(prev[c]);
+        }
+    }
+    if (pos != bytes.size())
+        return std::nullopt;
+    return keys;
+}
+
+void write_keys(const std::string& path, const std::string& head, const Keys& keys)
+{
+    std::string bytes = head;
+    put_varint(bytes, keys.size());
+    std::int64_t prev[3] = {0, 0, 0};
+    for (const auto& k : keys) {
+        const std::int64_t cur[3] = {k.run, k.sub, k.evt};
+        for (int c = 0; c < 3; ++c) {
+            put_varint(bytes, zigzag(cur[c] - prev[c]));
+            prev[c] = cur[c];
+        }
+    }
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out)
+            throw std::runtime_error("EventIndex: cannot open " + tmp);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        if (!out)
+            throw std::runtime_error("EventIndex: write failed for " + tmp);
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        throw std::runtime_error("EventIndex: cannot rename " + tmp + " to " + path);
+    }
+}
+
+// Only the baskets of the three key branches are read; the leaves convert whatever integer type
+// they were written with.
+Keys scan_keys(const std::string& file, const std::string& tree_name, const rarexsec::io::EventColumns& cols)
+{
+    std::unique_ptr<TFile> in(TFile::Open(file.c_str(), "READ"));
+    if (!in || in->IsZombie())
+        throw std::runtime_error("EventIndex: cannot open " + file);
+    auto* tree = in->Get<TTree>(tree_name.c_str());
+    if (!tree)
+        throw std::runtime_error("EventIndex: no " + tree_name + " in " + file);
+    TBranch* branch[3];
+    TLeaf* leaf[3];
+    const std::string* names[3] = {&cols.run, &cols.sub, &cols.evt};
+    for (int c = 0; c < 3; ++c) {
+        branch[c] = tree->GetBranch(names[c]->c_str());
+        leaf[c] = branch[c] ? branch[c]->GetLeaf(names[c]->c_str()) : nullptr;
+        if (!leaf[c])
+            throw std::runtime_error("EventIndex: no " + *names[c] + " branch in " + file);
+    }
+    Keys keys(static_cast<std::size_t>(tree->GetEntries()));
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        int* dst[3] = {&keys[i].run, &keys[i].sub, &keys[i].evt};
+        for (int c = 0; c < 3; ++c) {
+            branch[c]->GetEntry(static_cast<Long64_t>(i));
+            *dst[c] = static_cast<int>(leaf[c]->GetValue());
+        }
+    }
+    return keys;
+}
+
+// (key, entry) sorted by key then entry
+using Table = std::vector<std::pair<rarexsec::io::EventKey, std::uint64_t>>;
+
+std::shared_ptr<const Table> sorted(const Keys& keys)
+{
+    auto t = std::make_shared<Table>();
+    t->reserve(keys.size());
+    for (std::size_t i = 0; i < keys.size(); ++i)
+        t->emplace_back(keys[i], static_cast<std::uint64_t>(i));
+    std::stable_sort(t->begin(), t->end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    return t;
+}
+
+struct Cached {
+    rarexsec::io::FileStamp stamp;
+    std::string head;
+    std::shared_ptr<const Table> table;
+};
+
+std::mutex g_mutex;
+std::map<std::string, Cached> g_cache;
+
+std::shared_ptr<const Table> file_table(const std::string& file, const std::string& tree,
+                                        const rarexsec::io::EventColumns& cols, const std::string& dir)
+{
+    const auto st = rarexsec::io::stamp(file);
+    if (!st)
+        return sorted(scan_keys(file, tree, cols));
+    const std::string head = header(*st, tree, cols);
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        auto it = g_cache.find(file);
+        if (it != g_cache.end() && it->second.stamp == *st && it->second.head == head)
+            return it->second.table;
+    }
+    const std::string path = rarexsec::io::event_index_path(file, dir);
+    auto keys = read_keys(path, head);
+    if (!keys) {
+        keys = scan_keys(file, tree, cols);
+        try {
+            write_keys(path, head, *keys);
+        } catch (const std::exception& ex) {
+            std::cerr << "[EventIndex] " << ex.what() << "; keeping the index in memory only" << std::endl;
+        }
+    }
+    auto table = sorted(*keys);
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_cache[file] = Cached{*st, head, table};
+    return table;
+}
+}
+
+//____________________________________________________________________________
+rarexsec::io::EventIndex rarexsec::io::EventIndex::open(const std::vector<std::string>& files, const std::string& tree,
+                                                        const EventColumns& cols, const std::string& dir)
+{
+    if (!dir.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+    }
+    EventIndex out;
+    out.files_ = files;
+    out.tables_.reserve(files.size());
+    for (const auto& file : files) {
+        out.tables_.push_back(file_table(file, tree, cols, dir));
+        out.size_ += out.tables_.back()->size();
+    }
+    return out;
+}
+//____________________________________________________________________________
+std::optional<rarexsec::io::EventIndex::Location> rarexsec::io::EventIndex::find(const EventKey& key) const
+{
+    for (std::size_t f = 0; f < tables_.size(); ++f) {
+        const auto& t = *tables_[f];
+        auto it = std::lower_bound(t.begin(), t.end(), key, [](const auto& r, const EventKey& k) { return r.first < k; });
+        if (it != t.end() && it->first == key)
+            return Location{f, it->second};
+    }
+    return std::nullopt;
+}
+//____________________________________________________________________________
+std::string rarexsec::io::event_index_path(const std::string& file, const std::string& dir)
+{
+    const std::filesystem::path in(file);
+    const std::string name = in.filename().string() + ".rxevi";
+    if (dir.empty())
+        return (in.parent_path() / name).string();
+    return (std::filesystem::path(dir) / (rarexsec::io::binary::dir_tag(file) + "." + name)).string();
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace rarexsec::io {
+
+struct EventKey {
+    int run = 0;
+    int sub = 0;
+    int evt = 0;
+    bool operator<(const EventKey& o) const { return std::tie(run, sub, evt) < std::tie(o.run, o.sub, o.evt); }
+    bool operator==(const EventKey& o) const { return run == o.run && sub == o.sub && evt == o.evt; }
+};
+
+// Branches holding the key.
+struct EventColumns {
+    std::string run = "run";
+    std::string sub = "sub";
+    std::string evt = "evt";
+};
+
+// (run, sub, evt) -> (file, tree entry) over the files of one sample. Each file's keys are read
+// once from its tree and kept in a sidecar stamped with the file's size and mtime, then cached in
+// memory for the life of the process, so lookups cost a binary search rather than an event loop.
+class EventIndex {
+  public:
+    struct Location {
+        std::size_t file = 0;
+        std::uint64_t entry = 0;
+    };
+
+    // Sidecars live next to each file, or in dir when non-empty; missing or stale ones are
+    // rebuilt (one pass over the three key branches) and kept in memory only when the sidecar
+    // cannot be written. Files that cannot be stat'ed are indexed without a sidecar. Throws
+    // std::runtime_error when a file or its tree cannot be read.
+    static EventIndex open(const std::vector<std::string>& files, const std::string& tree,
+                           const EventColumns& cols = {}, const std::string& dir = "");
+
+    // The first entry with this key, in file then entry order; one binary search per file.
+    std::optional<Location> find(const EventKey& key) const;
+    const std::vector<std::string>& files() const noexcept { return files_; }
+    std::size_t size() const noexcept { return size_; }
+
+  private:
+    std::vector<std::string> files_;
+    // per file, (key, entry) sorted by key; shared with the process-wide cache
+    std::vector<std::shared_ptr<const std::vector<std::pair<EventKey, std::uint64_t>>>> tables_;
+    std::size_t size_ = 0;
+};
+
+// Sidecar path for a file: next to it, or in dir when non-empty.
+std::string event_index_path(const std::string& file, const std::string& dir = "");
+
+}
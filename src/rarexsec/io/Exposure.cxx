@@ -0,0 +1,210 @@
+#include "rarexsec/io/Exposure.h"
+
+#include <TBranch.h>
+#include <TFile.h>
+#include <TLeaf.h>
+#include <TROOT.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+using json = nlohmann::json;
+
+namespace {
+const std::string kSubRunTree = "nuselection/SubRun";
+}
+
+//____________________________________________________________________________
+rarexsec::io::ExposureCache::ExposureCache(std::string path) : path_(std::move(path))
+{
+    std::ifstream in(path_);
+    if (!in)
+        return;
+    json j;
+    try {
+        in >> j;
+        if (j.at("version").get<int>() != 1)
+            return;
+        for (const auto& f : j.at("files")) {
+            Item it;
+            it.stamp.size = f.at("size").get<std::uint64_t>();
+            it.stamp.mtime_ns = f.at("mtime_ns").get<std::int64_t>();
+            it.exposure.pot = f.at("pot").get<double>();
+            it.exposure.subruns = f.at("subruns").get<std::uint64_t>();
+            items_[f.at("file").get<std::string>()] = it;
+        }
+    } catch (const std::exception&) {
+        // an unreadable cache is rebuilt from the ntuples
+        items_.clear();
+    }
+}
+//____________________________________________________________________________
+const rarexsec::io::Exposure* rarexsec::io::ExposureCache::find(const std::string& file,
+                                                                const FileStamp& st) const
+{
+    auto it = items_.find(file);
+    return it != items_.end() && it->second.stamp == st ? &it->second.exposure : nullptr;
+}
+//____________________________________________________________________________
+void rarexsec::io::ExposureCache::put(const std::string& file, const FileStamp& st, const Exposure& e)
+{
+    items_[file] = Item{st, e};
+    dirty_ = true;
+}
+//____________________________________________________________________________
+void rarexsec::io::ExposureCache::save()
+{
+    if (path_.empty())
+        throw std::runtime_error("ExposureCache::save: no path");
+    json arr = json::array();
+    for (const auto& [file, it] : items_)
+        arr.push_back({{"file", file},
+                       {"size", it.stamp.size},
+                       {"mtime_ns", it.stamp.mtime_ns},
+                       {"pot", it.exposure.pot},
+                       {"subruns", it.exposure.subruns}});
+    const json j = {{"version", 1}, {"files", arr}};
+    const std::string tmp = path_ + ".tmp";
+    {
+        std::ofstream out(tmp);
+        if (!out)
+            throw std::runtime_error("ExposureCache::save: cannot open " + tmp);
+        out << j.dump(1) << '\n';
+        if (!out)
+            throw std::runtime_error("ExposureCache::save: write failed for " + tmp);
+    }
+    std::filesystem::rename(tmp, path_);
+    dirty_ = false;
+}
+//____________________________________________________________________________
+rarexsec::io::Exposure rarexsec::io::read_exposure(const std::string& file)
+{
+    std::unique_ptr<TFile> in(TFile::Open(file.c_str(), "READ"));
+    if (!in || in->IsZombie())
+        throw std::runtime_error("read_exposure: cannot open " + file);
+    auto* tree = in->Get<TTree>(kSubRunTree.c_str());
+    if (!tree)
+        throw std::runtime_error("read_exposure: no " + kSubRunTree + " in " + file);
+    TBranch* branch = tree->GetBranch("pot");
+    TLeaf* leaf = branch ? branch->GetLeaf("pot") : nullptr;
+    if (!leaf)
+        throw std::runtime_error("read_exposure: no pot branch in " + file);
+
+    // only the pot baskets are read; the leaf converts whatever type it was written with
+    Exposure e;
+    const Long64_t n = tree->GetEntries();
+    for (Long64_t i = 0; i < n; ++i) {
+        branch->GetEntry(i);
+        e.pot += leaf->GetValue();
+    }
+    e.subruns = static_cast<std::uint64_t>(n);
+    return e;
+}
+//____________________________________________________________________________
+std::vector<std::pair<std::uint32_t, std::uint32_t>> rarexsec::io::read_subruns(const std::string& file)
+{
+    std::unique_ptr<TFile> in(TFile::Open(file.c_str(), "READ"));
+    if (!in || in->IsZombie())
+        throw std::runtime_error("read_subruns: cannot open " + file);
+    auto* tree = in->Get<TTree>(kSubRunTree.c_str());
+    if (!tree)
+        throw std::runtime_error("read_subruns: no " + kSubRunTree + " in " + file);
+
+    TLeaf* run = nullptr;
+    TLeaf* subrun = nullptr;
+    for (auto* obj : *tree->GetListOfLeaves()) {
+        auto* leaf = static_cast<TLeaf*>(obj);
+        std::string name = leaf->GetName();
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+        if (name == "run")
+            run = leaf;
+        else if (name == "subrun")
+            subrun = leaf;
+    }
+    if (!run || !subrun)
+        throw std::runtime_error("read_subruns: no run/subrun branches in " + file);
+
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> out;
+    const Long64_t n = tree->GetEntries();
+    out.reserve(static_cast<std::size_t>(n));
+    for (Long64_t i = 0; i < n; ++i) {
+        run->GetBranch()->GetEntry(i);
+        subrun->GetBranch()->GetEntry(i);
+        out.emplace_back(static_cast<std::uint32_t>(run->GetValue()), static_cast<std::uint32_t>(subrun->GetValue()));
+    }
+    return out;
+}
+//____________________________________________________________________________
+std::vector<rarexsec::io::Exposure> rarexsec::io::file_exposures(const std::vector<std::string>& files,
+                                                                 ExposureCache* cache, unsigned nthreads)
+{
+    std::vector<Exposure> out(files.size());
+    std::vector<std::optional<FileStamp>> stamps(files.size());
+    std::vector<std::size_t> todo;
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        stamps[i] = stamp(files[i]);
+        const Exposure* hit = cache && stamps[i] ? cache->find(files[i], *stamps[i]) : nullptr;
+        if (hit)
+            out[i] = *hit;
+        else
+            todo.push_back(i);
+    }
+    if (todo.empty())
+        return out;
+
+    if (nthreads == 0)
+        nthreads = std::max(1u, std::thread::hardware_concurrency());
+    nthreads = static_cast<unsigned>(std::min<std::size_t>(nthreads, todo.size()));
+    if (nthreads > 1)
+        ROOT::EnableThreadSafety();
+
+    std::atomic<std::size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto work = [&] {
+        for (std::size_t k; (k = next.fetch_add(1)) < todo.size();) {
+            try {
+                out[todo[k]] = read_exposure(files[todo[k]]);
+            } catch (...) {
+                std::lock_guard<std::mutex> lk(error_mutex);
+                if (!error)
+                    error = std::current_exception();
+                next = todo.size();
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < nthreads; ++t)
+        workers.emplace_back(work);
+    work();
+    for (auto& w : workers)
+        w.join();
+    if (error)
+        std::rethrow_exception(error);
+
+    if (cache)
+        for (std::size_t i : todo)
+            if (stamps[i])
+                cache->put(files[i], *stamps[i], out[i]);
+    return out;
+}
+//____________________________________________________________________________
+rarexsec::io::Exposure rarexsec::io::total_exposure(const std::vector<std::string>& files, ExposureCache* cache,
+                                                    unsigned nthreads)
+{
+    Exposure total;
+    for (const auto& e : file_exposures(files, cache, nthreads))
+        total += e;
+    return total;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "rarexsec/io/EntryIndex.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rarexsec::io {
+
+// Exposure recorded in one ntuple's SubRun tree. EXT trigger counts are not in the ntuples; they
+// still come from the run database through the catalogue.
+struct Exposure {
+    double pot = 0.0;
+    std::uint64_t subruns = 0;
+
+    Exposure& operator+=(const Exposure& o)
+    {
+        pot += o.pot;
+        subruns += o.subruns;
+        return *this;
+    }
+};
+
+// Per-file totals keyed by path and FileStamp, so only added or rewritten files are read again.
+// Files that cannot be stamped (remote URLs) are never cached.
+class ExposureCache {
+  public:
+    ExposureCache() = default;
+    // Loads path when it exists; save() writes back to it.
+    explicit ExposureCache(std::string path);
+
+    const Exposure* find(const std::string& file, const FileStamp& st) const;
+    void put(const std::string& file, const FileStamp& st, const Exposure& e);
+    bool dirty() const { return dirty_; }
+    // Written to a temporary and renamed into place; throws std::runtime_error on I/O failure.
+    void save();
+
+  private:
+    struct Item {
+        FileStamp stamp;
+        Exposure exposure;
+    };
+    std::string path_;
+    std::map<std::string, Item> items_;
+    bool dirty_ = false;
+};
+
+// Sums the pot branch of nuselection/SubRun; throws std::runtime_error when it cannot be read.
+Exposure read_exposure(const std::string& file);
+
+// (run, subrun) pairs of nuselection/SubRun, for beam-database lookups; the branch names are
+// matched case-insensitively. Throws std::runtime_error when they cannot be read.
+std::vector<std::pair<std::uint32_t, std::uint32_t>> read_subruns(const std::string& file);
+
+// Per-file exposures in input order, reading uncached files on nthreads workers (0 = hardware
+// concurrency). New totals are added to cache when given.
+std::vector<Exposure> file_exposures(const std::vector<std::string>& files, ExposureCache* cache = nullptr,
+                                     unsigned nthreads = 0);
+
+Exposure total_exposure(const std::vector<std::string>& files, ExposureCache* cache = nullptr,
+                        unsigned nthreads = 0);
+
+}
@@ -0,0 +1,124 @@
+#include "rarexsec/io/ReadAhead.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//____________________________________________________________________________
+rarexsec::io::ReadAhead::ReadAhead(std::size_t head_bytes, std::size_t tail_bytes)
+    : head_bytes_(head_bytes), tail_bytes_(tail_bytes), worker_([this] { worker_loop(); })
+{
+}
+//____________________________________________________________________________
+rarexsec::io::ReadAhead::~ReadAhead()
+{
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        stop_ = true;
+        queue_.clear();
+    }
+    cv_.notify_all();
+    worker_.join();
+}
+//____________________________________________________________________________
+std::size_t rarexsec::io::ReadAhead::add_group(const std::string& stream, std::vector<std::string> files)
+{
+    std::lock_guard<std::mutex> lk(m_);
+    const std::size_t id = groups_.size();
+    groups_.push_back(Group{std::move(files)});
+    auto it = last_in_stream_.find(stream);
+    if (it != last_in_stream_.end())
+        groups_[it->second].next = id;
+    last_in_stream_[stream] = id;
+    return id;
+}
+//____________________________________________________________________________
+void rarexsec::io::ReadAhead::started(std::size_t group)
+{
+    std::size_t next = npos;
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        if (group < groups_.size())
+            next = groups_[group].next;
+    }
+    if (next != npos)
+        warm(next);
+}
+//____________________________________________________________________________
+void rarexsec::io::ReadAhead::warm(std::size_t group)
+{
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        if (group >= groups_.size() || groups_[group].queued)
+            return;
+        groups_[group].queued = true;
+        queue_.push_back(group);
+    }
+    cv_.notify_one();
+}
+//____________________________________________________________________________
+void rarexsec::io::ReadAhead::worker_loop()
+{
+    for (;;) {
+        std::vector<std::string> files;
+        {
+            std::unique_lock<std::mutex> lk(m_);
+            cv_.wait(lk, [this] { return stop_ || !queue_.empty(); });
+            if (stop_)
+                return;
+            files = groups_[queue_.front()].files;
+            queue_.pop_front();
+        }
+        for (const auto& f : files) {
+            {
+                std::lock_guard<std::mutex> lk(m_);
+                if (stop_)
+                    return;
+            }
+            bytes_.fetch_add(warm_file(f), std::memory_order_relaxed);
+        }
+    }
+}
+//____________________________________________________________________________
+std::uint64_t rarexsec::io::ReadAhead::warm_file(const std::string& path) const
+{
+    if (path.find("://") != std::string::npos)
+        return 0;
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return 0;
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return 0;
+    }
+    const auto size = static_cast<std::uint64_t>(st.st_size);
+    const std::uint64_t head = std::min<std::uint64_t>(head_bytes_, size);
+    const std::uint64_t tail_begin = size - std::min<std::uint64_t>(tail_bytes_, size - head);
+
+    // the hint lets local filesystems read ahead asynchronously; the reads make sure network
+    // filesystems, which often ignore it, actually pull the pages in
+    ::posix_fadvise(fd, 0, static_cast<off_t>(head), POSIX_FADV_WILLNEED);
+    ::posix_fadvise(fd, static_cast<off_t>(tail_begin), static_cast<off_t>(size - tail_begin), POSIX_FADV_WILLNEED);
+
+    constexpr std::size_t kChunk = std::size_t(1) << 20;
+    std::vector<char> buf(kChunk);
+    std::uint64_t total = 0;
+    auto pull = [&](std::uint64_t begin, std::uint64_t end) {
+        while (begin < end) {
+            const auto n = ::pread(fd, buf.data(), std::min<std::uint64_t>(kChunk, end - begin),
+                                   static_cast<off_t>(begin));
+            if (n <= 0)
+                return;
+            begin += static_cast<std::uint64_t>(n);
+            total += static_cast<std::uint64_t>(n);
+        }
+    };
+    pull(0, head);
+    pull(tail_begin, size);
+    ::close(fd);
+    return total;
+}
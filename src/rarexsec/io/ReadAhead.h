@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace rarexsec::io {
+
+// Background page-cache warmer for the files of samples that are processed one after another.
+// Each registered group (one sample's files) belongs to a stream (e.g. nominal samples, or one
+// detector variation); when a group's event loop starts, the next group of the same stream is
+// warmed: the first head_bytes of every file, where the first clusters' baskets live, and the last
+// tail_bytes, which hold the keys list and streamer info ROOT reads on open. Remote URLs are skipped.
+class ReadAhead {
+  public:
+    explicit ReadAhead(std::size_t head_bytes, std::size_t tail_bytes = std::size_t(1) << 20);
+    ~ReadAhead();
+    ReadAhead(const ReadAhead&) = delete;
+    ReadAhead& operator=(const ReadAhead&) = delete;
+
+    std::size_t add_group(const std::string& stream, std::vector<std::string> files);
+    void started(std::size_t group);
+    void warm(std::size_t group);
+
+    std::uint64_t bytes_warmed() const { return bytes_.load(std::memory_order_relaxed); }
+
+  private:
+    struct Group {
+        std::vector<std::string> files;
+        std::size_t next = npos;
+        bool queued = false;
+    };
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    void worker_loop();
+    std::uint64_t warm_file(const std::string& path) const;
+
+    std::size_t head_bytes_;
+    std::size_t tail_bytes_;
+    std::mutex m_;
+    std::condition_variable cv_;
+    std::vector<Group> groups_;
+    std::unordered_map<std::string, std::size_t> last_in_stream_;
+    std::deque<std::size_t> queue_;
+    bool stop_ = false;
+    std::atomic<std::uint64_t> bytes_{0};
+    std::thread worker_;
+};
+
+}
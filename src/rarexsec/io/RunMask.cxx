@@ -0,0 +1,98 @@
+#include "rarexsec/io/RunMask.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+//____________________________________________________________________________
+rarexsec::io::RunMask::RunMask(std::vector<Range> ranges)
+{
+    std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) {
+        return a.run != b.run ? a.run < b.run : a.first < b.first;
+    });
+    for (std::size_t i = 0; i < ranges.size();) {
+        // merge overlapping or adjacent intervals of this run
+        std::vector<Range> merged;
+        const std::uint32_t run = ranges[i].run;
+        for (; i < ranges.size() && ranges[i].run == run; ++i) {
+            if (!merged.empty() && (merged.back().last == all || ranges[i].first <= merged.back().last + 1))
+                merged.back().last = std::max(merged.back().last, ranges[i].last);
+            else
+                merged.push_back(ranges[i]);
+        }
+        const std::uint32_t top = merged.back().last;
+        Run r{run, false, 0, 0};
+        if (merged.size() >= min_bitset_intervals && top != all && top / 64 < max_words) {
+            r.bitset = true;
+            r.begin = static_cast<std::uint32_t>(words_.size());
+            r.count = top / 64 + 1;
+            words_.resize(words_.size() + r.count, 0);
+            for (const auto& m : merged)
+                for (std::uint32_t s = m.first; s <= m.last; ++s)
+                    words_[r.begin + s / 64] |= std::uint64_t(1) << (s % 64);
+        } else {
+            r.begin = static_cast<std::uint32_t>(spans_.size());
+            r.count = static_cast<std::uint32_t>(merged.size());
+            spans_.insert(spans_.end(), merged.begin(), merged.end());
+        }
+        runs_.push_back(r);
+    }
+}
+//____________________________________________________________________________
+rarexsec::io::RunMask rarexsec::io::RunMask::parse(const std::string& text, const std::string& origin)
+{
+    std::vector<Range> ranges;
+    std::istringstream in(text);
+    std::string line;
+    for (int lineno = 1; std::getline(in, line); ++lineno) {
+        const auto hash = line.find('#');
+        if (hash != std::string::npos)
+            line.erase(hash);
+        std::istringstream fields(line);
+        std::vector<long long> v;
+        long long x;
+        while (fields >> x)
+            v.push_back(x);
+        if (!fields.eof() || v.size() > 3 ||
+            std::any_of(v.begin(), v.end(), [](long long y) { return y < 0 || y >= all; }))
+            throw std::runtime_error(origin + ":" + std::to_string(lineno) + ": expected 'run [first [last]]'");
+        if (v.empty())
+            continue;
+        Range r;
+        r.run = static_cast<std::uint32_t>(v[0]);
+        if (v.size() > 1)
+            r.first = r.last = static_cast<std::uint32_t>(v[1]);
+        if (v.size() > 2)
+            r.last = static_cast<std::uint32_t>(v[2]);
+        if (r.last < r.first)
+            throw std::runtime_error(origin + ":" + std::to_string(lineno) + ": last subrun before first");
+        ranges.push_back(r);
+    }
+    return RunMask(std::move(ranges));
+}
+//____________________________________________________________________________
+rarexsec::io::RunMask rarexsec::io::RunMask::read(const std::string& path)
+{
+    std::ifstream in(path);
+    if (!in)
+        throw std::runtime_error("RunMask: cannot open " + path);
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return parse(ss.str(), path);
+}
+//____________________________________________________________________________
+bool rarexsec::io::RunMask::contains(std::uint32_t run, std::uint32_t subrun) const noexcept
+{
+    auto it = std::lower_bound(runs_.begin(), runs_.end(), run, [](const Run& r, std::uint32_t x) { return r.run < x; });
+    if (it == runs_.end() || it->run != run)
+        return false;
+    if (it->bitset) {
+        const std::uint32_t w = subrun / 64;
+        return w < it->count && (words_[it->begin + w] >> (subrun % 64) & 1u);
+    }
+    const Range* b = spans_.data() + it->begin;
+    const Range* e = b + it->count;
+    const Range* s = std::upper_bound(b, e, subrun, [](std::uint32_t x, const Range& r) { return x < r.first; });
+    return s != b && subrun <= (s - 1)->last;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace rarexsec::io {
+
+// Good-run list compiled into a sorted run table with one container per run, in the manner of
+// roaring bitmaps: a subrun bitset for fragmented runs with small subrun numbers, otherwise
+// merged subrun intervals. Lookups are a binary search over runs and then a bit test or a short
+// search over intervals, cheap enough for a per-event filter.
+class RunMask {
+  public:
+    static constexpr std::uint32_t all = std::numeric_limits<std::uint32_t>::max();
+
+    // Inclusive subrun range of one run; first = 0, last = all selects the whole run.
+    struct Range {
+        std::uint32_t run = 0;
+        std::uint32_t first = 0;
+        std::uint32_t last = all;
+    };
+
+    RunMask() = default;
+    explicit RunMask(std::vector<Range> ranges);
+
+    // One "run", "run subrun" or "run first last" per line; '#' starts a comment. Throws
+    // std::runtime_error naming the line on malformed input.
+    static RunMask parse(const std::string& text, const std::string& origin = "good-run list");
+    static RunMask read(const std::string& path);
+
+    bool contains(std::uint32_t run, std::uint32_t subrun) const noexcept;
+    bool empty() const noexcept { return runs_.empty(); }
+    std::size_t runs() const noexcept { return runs_.size(); }
+
+  private:
+    // a bitset pays off once a run has this many intervals and fits in max_words
+    static constexpr std::size_t min_bitset_intervals = 4;
+    static constexpr std::uint32_t max_words = 64;
+
+    struct Run {
+        std::uint32_t run;
+        bool bitset;
+        // into words_ or spans_
+        std::uint32_t begin;
+        std::uint32_t count;
+    };
+    std::vector<Run> runs_;
+    std::vector<std::uint64_t> words_;
+    std::vector<Range> spans_;
+};
+
+}
@@ -0,0 +1,169 @@
+#include "rarexsec/io/Skim.h"
+#include "rarexsec/Processor.h"
+#include "rarexsec/io/Binary.h"
+#include "rarexsec/io/BranchUsage.h"
+#include "rarexsec/proc/Selection.h"
+
+#include <ROOT/RDataFrame.hxx>
+#include <ROOT/RSnapshotOptions.hxx>
+#include <TFile.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <set>
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+namespace {
+const std::string kEventTree = "nuselection/EventSelectionFilter";
+const std::string kSubRunTree = "nuselection/SubRun";
+
+std::string skim_path(const std::string& outdir, const std::string& file)
+{
+    const std::filesystem::path in(file);
+    return (std::filesystem::path(outdir) / (rarexsec::io::binary::dir_tag(file) + "." + in.stem().string() +
+                                             ".skim.root")).string();
+}
+
+void copy_subrun_tree(const std::string& from, const std::string& to)
+{
+    std::unique_ptr<TFile> in(TFile::Open(from.c_str(), "READ"));
+    if (!in || in->IsZombie())
+        return;
+    auto* tree = in->Get<TTree>(kSubRunTree.c_str());
+    if (!tree)
+        return;
+    std::unique_ptr<TFile> out(TFile::Open(to.c_str(), "UPDATE"));
+    if (!out || out->IsZombie())
+        throw std::runtime_error("write_skims: cannot update " + to);
+    const auto slash = kSubRunTree.find('/');
+    auto* dir = out->GetDirectory(kSubRunTree.substr(0, slash).c_str());
+    if (!dir)
+        dir = out->mkdir(kSubRunTree.substr(0, slash).c_str());
+    dir->cd();
+    auto* copy = tree->CloneTree(-1, "fast");
+    copy->Write("", TObject::kOverwrite);
+}
+
+rarexsec::io::SkimInfo write_one(const rarexsec::Entry& rec, const std::string& file,
+                                 const rarexsec::io::SkimOptions& opt)
+{
+    ROOT::RDataFrame df(kEventTree, file);
+    const auto available = df.GetColumnNames();
+    const std::set<std::string> have(available.begin(), available.end());
+
+    ROOT::RDF::RNode node = df;
+    node = rarexsec::processor().run(node, rec);
+    for (const auto& name : opt.preselection)
+        node = rarexsec::selection::apply(node, rarexsec::selection::preset_from_name(name), rec);
+
+    std::set<std::string> wanted(opt.branches.begin(), opt.branches.end());
+    const auto needed = rarexsec::io::branch_usage().definition_inputs();
+    wanted.insert(needed.begin(), needed.end());
+    std::vector<std::string> columns;
+    for (const auto& b : wanted)
+        if (have.count(b))
+            columns.push_back(b);
+    if (columns.empty())
+        throw std::runtime_error("write_skims: none of the requested branches exist in " + file);
+
+    rarexsec::io::SkimInfo info;
+    info.source = file;
+    info.file = skim_path(opt.outdir, file);
+    info.branches = columns;
+    info.source_branches.assign(have.begin(), have.end());
+    info.preselection = opt.preselection;
+    info.processor_version = rarexsec::Processor::version;
+    if (auto st = rarexsec::io::stamp(file))
+        info.source_stamp = *st;
+
+    const std::string tmp = info.file + ".tmp.root";
+    ROOT::RDF::RSnapshotOptions sopt;
+    sopt.fMode = "RECREATE";
+    node.Snapshot(kEventTree, tmp, columns, sopt).GetValue();
+    copy_subrun_tree(file, tmp);
+    std::filesystem::rename(tmp, info.file);
+    return info;
+}
+}
+
+//____________________________________________________________________________
+std::string rarexsec::io::write_skims(const std::vector<const Entry*>& samples, const SkimOptions& opt)
+{
+    std::filesystem::create_directories(opt.outdir);
+    const std::filesystem::path overlay_path = std::filesystem::path(opt.overlay).is_absolute()
+                                                   ? std::filesystem::path(opt.overlay)
+                                                   : std::filesystem::path(opt.outdir) / opt.overlay;
+    auto overlay = read_skim_overlay(overlay_path.string());
+
+    // a file shared by several samples (e.g. beam and strangeness slices) is written once
+    std::set<std::string> done;
+    for (const Entry* e : samples) {
+        if (!e)
+            continue;
+        for (const auto& file : e->files) {
+            if (done.insert(file).second)
+                overlay[file] = write_one(*e, file, opt);
+        }
+    }
+
+    write_skim_overlay(overlay_path.string(), overlay);
+    return overlay_path.string();
+}
+//____________________________________________________________________________
+std::map<std::string, rarexsec::io::SkimInfo> rarexsec::io::read_skim_overlay(const std::string& path)
+{
+    std::map<std::string, SkimInfo> out;
+    std::ifstream in(path);
+    if (!in)
+        return out;
+    json j;
+    in >> j;
+    if (j.value("version", 0) != 1)
+        throw std::runtime_error("read_skim_overlay: unsupported overlay version in " + path);
+    for (const auto& s : j.at("skims")) {
+        SkimInfo info;
+        info.source = s.at("source").get<std::string>();
+        info.file = s.at("file").get<std::string>();
+        info.branches = s.at("branches").get<std::vector<std::string>>();
+        info.source_branches = s.value("source_branches", std::vector<std::string>{});
+        info.preselection = s.value("preselection", std::vector<std::string>{});
+        info.processor_version = s.value("processor_version", 0u);
+        info.source_stamp.size = s.value("source_size", std::uint64_t{0});
+        info.source_stamp.mtime_ns = s.value("source_mtime_ns", std::int64_t{0});
+        out.emplace(info.source, std::move(info));
+    }
+    return out;
+}
+//____________________________________________________________________________
+void rarexsec::io::write_skim_overlay(const std::string& path, const std::map<std::string, SkimInfo>& skims)
+{
+    json arr = json::array();
+    for (const auto& kv : skims) {
+        const SkimInfo& s = kv.second;
+        arr.push_back({{"source", s.source},
+                       {"file", s.file},
+                       {"branches", s.branches},
+                       {"source_branches", s.source_branches},
+                       {"preselection", s.preselection},
+                       {"processor_version", s.processor_version},
+                       {"source_size", s.source_stamp.size},
+                       {"source_mtime_ns", s.source_stamp.mtime_ns}});
+    }
+    const json j = {{"version", 1}, {"skims", arr}};
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp);
+        if (!out)
+            throw std::runtime_error("write_skim_overlay: cannot open " + tmp);
+        out << j.dump(2) << '\n';
+        if (!out)
+            throw std::runtime_error("write_skim_overlay: write failed for " + tmp);
+    }
+    std::filesystem::rename(tmp, path);
+}
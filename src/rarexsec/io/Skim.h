@@ -0,0 +1,46 @@
+#pragma once
+#include "rarexsec/io/EntryIndex.h"
+#include "rarexsec/proc/DataModel.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace rarexsec::io {
+
+// One slimmed copy of an input file, as recorded in the catalogue overlay.
+struct SkimInfo {
+    std::string source;
+    std::string file;
+    std::vector<std::string> branches;
+    // Event-tree branches of the source, so that names which are not branches of it (JIT
+    // identifiers from the usage log, branches of other sample kinds) can be told apart from
+    // branches the skim dropped.
+    std::vector<std::string> source_branches;
+    // Presets applied when writing, in order; empty for a pure slim.
+    std::vector<std::string> preselection;
+    unsigned processor_version = 0;
+    FileStamp source_stamp;
+};
+
+struct SkimOptions {
+    std::string outdir = "skims";
+    // Input branches to keep, e.g. from read_usage_log; the inputs of Processor's definitions are
+    // always kept so that skims can be processed like the originals.
+    std::vector<std::string> branches;
+    // Preset names to pre-select with, e.g. {"Trigger", "Slice"}.
+    std::vector<std::string> preselection;
+    // Catalogue overlay, created or updated in place; relative paths are taken inside outdir.
+    std::string overlay = "skims.json";
+};
+
+// Writes one skim per nominal input file of every sample, together with its SubRun tree, and
+// records them in the overlay. Returns the overlay path.
+std::string write_skims(const std::vector<const Entry*>& samples, const SkimOptions& opt = {});
+
+// Overlay entries keyed by source file; an absent overlay is empty.
+std::map<std::string, SkimInfo> read_skim_overlay(const std::string& path);
+void write_skim_overlay(const std::string& path, const std::map<std::string, SkimInfo>& skims);
+
+}
@@ -4,22 +4,67 @@
 #include <array>
 #include <atomic>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <mutex>
 #include <numeric>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <system_error>
+#include <tuple>
 #include <utility>
 
 #include <ROOT/RConfig.h>
+#include <TFile.h>
 #include <TStyle.h>
+#include <TTree.h>
 #include <nlohmann/json.hpp>
 
 #include "rarexsec/plot/Plotter.h"
+#include "rarexsec/plot/Raster.h"
+#include "rarexsec/proc/DataModel.h"
+
+namespace {
+
+constexpr int kSemanticClasses = 15;
+
+// Same colours as the ROOT palette of draw_semantic, and ASCII forms of its legend labels
+constexpr std::array<std::uint32_t, kSemanticClasses> kSemanticRGB = {
+    0xe6e6e6, 0x666666, 0xe41a1c, 0x377eb8, 0x4daf4a, 0xff7f00, 0x984ea3, 0xffff33,
+    0x1b9e77, 0xf781bf, 0xa65628, 0x66a61e, 0xe6ab02, 0xa6cee3, 0xb15928};
+constexpr std::array<const char*, kSemanticClasses> kSemanticAscii = {
+    "none", "Cosmic", "mu", "e-", "gamma", "pi+-", "pi0", "n", "p",
+    "K+-", "K0", "Lambda", "Sigma+-", "Sigma0", "Other"};
+
+// ROOT's default kBird palette (9 stops interpolated to 255 colours), as used by COL
+const std::array<std::uint32_t, 255>& bird_palette()
+{
+    static const std::array<std::uint32_t, 255> lut = [] {
+        constexpr double r[9] = {0.2082, 0.0592, 0.0780, 0.0232, 0.1802, 0.5301, 0.8186, 0.9956, 0.9764};
+        constexpr double g[9] = {0.1664, 0.3599, 0.5041, 0.6419, 0.7178, 0.7492, 0.7328, 0.7862, 0.9832};
+        constexpr double b[9] = {0.5293, 0.8684, 0.8385, 0.7914, 0.6425, 0.4662, 0.3499, 0.1968, 0.0539};
+        std::array<std::uint32_t, 255> out{};
+        for (int i = 0; i < 255; ++i) {
+            const double t = 8.0 * i / 254.0;
+            const int k = std::min(7, static_cast<int>(t));
+            const double f = t - k;
+            auto c = [&](const double* v) {
+                return static_cast<std::uint32_t>(std::lround(255.0 * (v[k] + f * (v[k + 1] - v[k]))));
+            };
+            out[i] = rarexsec::plot::Raster::pixel((c(r) << 16) | (c(g) << 8) | c(b));
+        }
+        return out;
+    }();
+    return lut;
+}
+
+}
 //____________________________________________________________________________
 rarexsec::plot::EventDisplay::EventDisplay(Spec spec, Options opt, DetectorData data)
     : spec_(std::move(spec)), opt_(std::move(opt)), data_(std::move(data)), plot_name_(rarexsec::plot::Plotter::sanitise(spec_.id)), output_directory_(opt_.out_dir) {}
@@ -48,19 +93,18 @@ void rarexsec::plot::EventDisplay::draw(TCanvas& canvas)
 //____________________________________________________________________________
 void rarexsec::plot::EventDisplay::draw_and_save(const std::string& image_format) 
 {
-    std::filesystem::create_directories(output_directory_);
-    TCanvas canvas(plot_name_.c_str(), spec_.title.c_str(),
-                   opt_.canvas_size, opt_.canvas_size);
-    draw(canvas);
-
-    const std::string fmt = image_format.empty() ? "png" : image_format;
-    canvas.SaveAs((output_directory_ + "/" + plot_name_ + "." + fmt).c_str());
+    draw_and_save(image_format, "");
 }
 //____________________________________________________________________________
 void rarexsec::plot::EventDisplay::draw_and_save(const std::string& image_format,
                                                  const std::string& file_override) 
 {
     std::filesystem::create_directories(output_directory_);
+    const std::string fmt = image_format.empty() ? "png" : image_format;
+    if (opt_.raster_png && fmt == "png") {
+        render_png(file_override.empty() ? output_directory_ + "/" + plot_name_ + ".png" : file_override);
+        return;
+    }
     TCanvas canvas(plot_name_.c_str(), spec_.title.c_str(),
                    opt_.canvas_size, opt_.canvas_size);
     draw(canvas);
@@ -68,11 +112,125 @@ void rarexsec::plot::EventDisplay::draw_and_save(const std::string& image_format
     if (!file_override.empty()) {
         canvas.SaveAs(file_override.c_str());
     } else {
-        const std::string fmt = image_format.empty() ? "png" : image_format;
         canvas.SaveAs((output_directory_ + "/" + plot_name_ + "." + fmt).c_str());
     }
 }
 //____________________________________________________________________________
+void rarexsec::plot::EventDisplay::render_png(const std::string& path) const
+{
+    const int S = std::max(64, opt_.canvas_size);
+    const double m = std::clamp(opt_.margin, 0.02, 0.25);
+    const auto [W, H] = std::visit([&](auto const& vec) {
+        return deduce_grid(spec_.grid_w, spec_.grid_h, vec.size());
+    },
+                                   data_);
+    const bool semantic = spec_.mode == Mode::Semantic;
+    const std::uint32_t frame_bg = Raster::pixel(semantic ? kSemanticRGB[0] : 0xffffff);
+
+    // one colour per image cell, rows bottom to top as in the histogram
+    std::vector<std::uint32_t> cells(static_cast<std::size_t>(W) * H, frame_bg);
+    std::array<int, kSemanticClasses> counts{};
+    if (!semantic) {
+        const auto& v = std::get<DetectorData>(data_);
+        const auto& lut = bird_palette();
+        const int ncol = static_cast<int>(lut.size());
+        const double lo = opt_.use_log_z ? std::log(std::max(opt_.det_min, 1e-12)) : opt_.det_min;
+        double hi = opt_.use_log_z ? std::log(std::max(opt_.det_max, 1e-12)) : opt_.det_max;
+        if (!(hi > lo))
+            hi = lo + 1.0;
+        const double k = ncol / (hi - lo);
+        const float threshold = static_cast<float>(opt_.det_threshold);
+        const std::size_t n = std::min(cells.size(), v.size());
+        for (std::size_t i = 0; i < n; ++i) {
+            const float x = v[i];
+            if (!(x >= threshold) || (opt_.use_log_z && x <= 0.0f))
+                continue;
+            const double z = opt_.use_log_z ? std::log(static_cast<double>(x)) : x;
+            const int idx = static_cast<int>((z - lo) * k);
+            cells[i] = lut[std::clamp(idx, 0, ncol - 1)];
+        }
+    } else {
+        const auto& v = std::get<SemanticData>(data_);
+        std::array<std::uint32_t, kSemanticClasses> lut{};
+        for (int c = 0; c < kSemanticClasses; ++c)
+            lut[c] = Raster::pixel(kSemanticRGB[c]);
+        const std::size_t n = std::min(cells.size(), v.size());
+        for (std::size_t i = 0; i < n; ++i) {
+            const int c = v[i];
+            if (c >= 0 && c < kSemanticClasses) {
+                cells[i] = lut[c];
+                ++counts[c];
+            }
+        }
+    }
+
+    // nearest-neighbour scaling into the square frame; repeated source rows are copied
+    Raster img(S, S, 0xffffff);
+    const int f0 = static_cast<int>(std::lround(m * S));
+    const int fs = S - 2 * f0;
+    std::vector<int> col(fs);
+    for (int px = 0; px < fs; ++px)
+        col[px] = static_cast<int>(static_cast<long long>(px) * W / fs);
+    int prev = -1;
+    for (int py = 0; py < fs; ++py) {
+        const int r = H - 1 - static_cast<int>(static_cast<long long>(py) * H / fs);
+        std::uint32_t* dst = img.row(f0 + py) + f0;
+        if (r == prev) {
+            std::memcpy(dst, img.row(f0 + py - 1) + f0, sizeof(std::uint32_t) * fs);
+            continue;
+        }
+        const std::uint32_t* src = cells.data() + static_cast<std::size_t>(r) * W;
+        for (int px = 0; px < fs; ++px)
+            dst[px] = src[col[px]];
+        prev = r;
+    }
+
+    const int scale = std::max(1, static_cast<int>(std::lround(S * 0.025 / 16.0)));
+    const int th = Raster::text_height(scale);
+    img.text((S - Raster::text_width(spec_.title, scale)) / 2, std::max(0, (f0 - th) / 3), spec_.title, scale,
+             0x000000);
+    const std::string xt = "Local Wire Coordinate", yt = "Local Drift Coordinate";
+    img.text((S - Raster::text_width(xt, scale)) / 2, f0 + fs + std::max(0, (f0 - th) / 2), xt, scale, 0x000000);
+    img.text_vertical(std::max(0, (f0 - th) / 2), (S + Raster::text_width(yt, scale)) / 2, yt, scale, 0x000000);
+
+    if (semantic && opt_.show_legend) {
+        std::vector<int> order(kSemanticClasses - 1);
+        std::iota(order.begin(), order.end(), 1);
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return counts[a] > counts[b]; });
+
+        const int lx = static_cast<int>(0.12 * S), lw = static_cast<int>(0.95 * S) - lx;
+        const int ly = static_cast<int>((1.0 - 0.975) * S), lh = static_cast<int>((0.975 - 0.86) * S);
+        img.fill_rect(lx, ly, lw, lh, kSemanticRGB[0]);
+        const int ncols = std::max(1, opt_.legend_cols);
+        const int nrows = (static_cast<int>(order.size()) + ncols - 1) / ncols;
+        const int cw = lw / ncols, ch = lh / nrows;
+        const int box = std::max(2, ch * 6 / 10);
+        const int pad = cw / 20, room = cw - pad - box - box / 3;
+
+        std::vector<std::string> labels(order.size());
+        std::size_t longest = 1;
+        for (std::size_t i = 0; i < order.size(); ++i) {
+            if (counts[order[i]] == 0)
+                continue;
+            labels[i] = std::string(kSemanticAscii[order[i]]) + " (" + std::to_string(counts[order[i]]) + ")";
+            longest = std::max(longest, labels[i].size());
+        }
+        // one text size for the whole legend, as large as the cells allow
+        const int ls = std::max(1, std::min({scale, box / 16, room / (8 * static_cast<int>(longest))}));
+        const std::size_t fit = static_cast<std::size_t>(std::max(0, room / (8 * ls)));
+        for (std::size_t i = 0; i < order.size(); ++i) {
+            if (labels[i].empty())
+                continue;
+            const int x = lx + static_cast<int>(i) % ncols * cw + pad;
+            const int y = ly + static_cast<int>(i) / ncols * ch;
+            img.fill_rect(x, y + (ch - box) / 2, box, box, kSemanticRGB[order[i]]);
+            img.text(x + box + box / 3, y + (ch - Raster::text_height(ls)) / 2, labels[i].substr(0, fit), ls, 0x000000);
+        }
+    }
+
+    img.write_png(path);
+}
+//____________________________________________________________________________
 void rarexsec::plot::EventDisplay::setup_canvas(TCanvas& c) const 
 {
     c.SetCanvasSize(opt_.canvas_size, opt_.canvas_size);
@@ -328,7 +486,32 @@ static std::string format_tag(std::string pattern, const std::string& plane, int
     return pattern;
 }
 //____________________________________________________________________________
-void rarexsec::plot::EventDisplay::render_from_rdf(ROOT::RDF::RNode df, const BatchOptions& opt) 
+// Output side of a batch: one display per requested plane, the combined PDF's page markers and
+// the manifest.
+struct rarexsec::plot::EventDisplay::Batch {
+    Batch(const BatchOptions& o, std::size_t n_events);
+
+    void render(int run, int sub, int evt, const std::array<const DetectorData*, 3>& images);
+    void render(int run, int sub, int evt, const std::array<const SemanticData*, 3>& images);
+    void finish() const;
+
+    static std::size_t plane_index(const std::string& plane) { return plane == "U" ? 0 : plane == "V" ? 1 : 2; }
+
+  private:
+    void save(EventDisplay& ed, const std::string& tag, const std::string& plane, int run, int sub, int evt);
+
+    const BatchOptions& opt;
+    Options display;
+    bool use_combined_pdf;
+    std::filesystem::path combined_path;
+    std::size_t total_pages = 0;
+    std::atomic<std::size_t> page_idx{0};
+    nlohmann::json manifest = nlohmann::json::array();
+    std::mutex manifest_mutex;
+};
+//____________________________________________________________________________
+rarexsec::plot::EventDisplay::Batch::Batch(const BatchOptions& o, std::size_t n_events)
+    : opt(o), display(o.display), use_combined_pdf(!o.combined_pdf.empty() && o.image_format == "pdf")
 {
     std::error_code ec;
     std::filesystem::create_directories(opt.out_dir, ec);
@@ -336,7 +519,136 @@ void rarexsec::plot::EventDisplay::render_from_rdf(ROOT::RDF::RNode df, const Ba
         std::cerr << "[EventDisplay] Failed to create output directory '"
                   << opt.out_dir << "': " << ec.message() << '\n';
     }
+    display.out_dir = opt.out_dir;
+
+    if (use_combined_pdf) {
+        combined_path = std::filesystem::path(opt.out_dir) / opt.combined_pdf;
+        total_pages   = n_events * opt.planes.size();
+
+#if defined(R__HAS_IMPLICITMT)
+        if (ROOT::IsImplicitMTEnabled()) {
+            ROOT::DisableImplicitMT();
+            std::clog << "[EventDisplay] Implicit MT disabled for stable combined PDF output." << '\n';
+        }
+#else
+        if (ROOT::IsImplicitMTEnabled()) {
+            ROOT::DisableImplicitMT();
+            std::clog << "[EventDisplay] ROOT built without R__HAS_IMPLICITMT; disabling MT for combined PDF." << '\n';
+        }
+#endif
+    }
+}
+//____________________________________________________________________________
+void rarexsec::plot::EventDisplay::Batch::render(int run, int sub, int evt,
+                                                 const std::array<const DetectorData*, 3>& images)
+{
+    std::clog << "[EventDisplay] Rendering detector images for "
+              << "run=" << run
+              << " sub=" << sub
+              << " evt=" << evt
+              << '\n';
 
+    for (const auto& plane : opt.planes) {
+        const auto& img = *images[plane_index(plane)];
+
+        auto plane_opts = display;
+        if (!img.empty()) {
+            std::vector<float> vals;
+            vals.reserve(img.size());
+            for (float v : img)
+                if (v > 0.0f)
+                    vals.push_back(v);
+
+            if (!vals.empty()) {
+                std::sort(vals.begin(), vals.end());
+                auto q = [&](double f) -> float {
+                    std::size_t idx = std::min(vals.size() - 1,
+                                               static_cast<std::size_t>(f * vals.size()));
+                    return vals[idx];
+                };
+
+                const float min_pos = q(0.02);
+                const float max_val = q(0.995);
+
+                plane_opts.det_min = std::max(min_pos, 1e-4f);
+                plane_opts.det_max = max_val;
+            }
+        }
+        const std::string tag = format_tag(opt.file_pattern, plane, run, sub, evt);
+        const std::string title =
+            "Detector Image, Plane " + plane +
+            " - Run " + std::to_string(run) +
+            ", Subrun " + std::to_string(sub) +
+            ", Event " + std::to_string(evt);
+
+        rarexsec::plot::EventDisplay::Spec spec{tag, title, Mode::Detector};
+        EventDisplay ed(spec, plane_opts, img);
+        save(ed, tag, plane, run, sub, evt);
+    }
+}
+//____________________________________________________________________________
+void rarexsec::plot::EventDisplay::Batch::render(int run, int sub, int evt,
+                                                 const std::array<const SemanticData*, 3>& images)
+{
+    std::clog << "[EventDisplay] Rendering semantic images for "
+              << "run=" << run
+              << " sub=" << sub
+              << " evt=" << evt
+              << '\n';
+
+    for (const auto& plane : opt.planes) {
+        const auto& img = *images[plane_index(plane)];
+        const std::string tag = format_tag(opt.file_pattern, plane, run, sub, evt);
+        const std::string title =
+            "Semantic Image, Plane " + plane +
+            " - Run " + std::to_string(run) +
+            ", Subrun " + std::to_string(sub) +
+            ", Event " + std::to_string(evt);
+
+        rarexsec::plot::EventDisplay::Spec spec{tag, title, Mode::Semantic};
+        EventDisplay ed(spec, display, img);
+        save(ed, tag, plane, run, sub, evt);
+    }
+}
+//____________________________________________________________________________
+void rarexsec::plot::EventDisplay::Batch::save(EventDisplay& ed, const std::string& tag, const std::string& plane,
+                                               int run, int sub, int evt)
+{
+    if (use_combined_pdf) {
+        const std::size_t idx = page_idx++;
+        std::string target = combined_path.string();
+        if (idx == 0)
+            target += "(";
+        else if (idx + 1 == total_pages)
+            target += ")";
+        ed.draw_and_save("pdf", target);
+        if (!opt.manifest_path.empty()) {
+            std::lock_guard<std::mutex> lock(manifest_mutex);
+            manifest.push_back({{"run", run}, {"sub", sub}, {"evt", evt}, {"plane", plane}, {"file", combined_path.string()}});
+        }
+    } else {
+        ed.draw_and_save(opt.image_format);
+        if (!opt.manifest_path.empty()) {
+            const std::string file = (std::filesystem::path(opt.out_dir) /
+                                      (rarexsec::plot::Plotter::sanitise(tag) + "." + opt.image_format))
+                                         .string();
+            std::lock_guard<std::mutex> lock(manifest_mutex);
+            manifest.push_back({{"run", run}, {"sub", sub}, {"evt", evt}, {"plane", plane}, {"file", file}});
+        }
+    }
+}
+//____________________________________________________________________________
+void rarexsec::plot::EventDisplay::Batch::finish() const
+{
+    if (!opt.manifest_path.empty()) {
+        std::ofstream ofs(opt.manifest_path);
+        ofs << manifest.dump(2);
+        std::clog << "[EventDisplay] Wrote event display manifest: " << opt.manifest_path << '\n';
+    }
+}
+//____________________________________________________________________________
+void rarexsec::plot::EventDisplay::render_from_rdf(ROOT::RDF::RNode df, const BatchOptions& opt) 
+{
     auto filtered = df;
     if (!opt.selection_expr.empty())
         filtered = filtered.Filter(opt.selection_expr);
@@ -359,120 +671,20 @@ void rarexsec::plot::EventDisplay::render_from_rdf(ROOT::RDF::RNode df, const Ba
               << " rows; rendering up to " << n_to_render << " events."
               << '\n';
 
+    Batch batch(opt, n_to_render);
     auto limited = filtered.Range(static_cast<ULong64_t>(n_to_render));
 
-    const bool use_combined_pdf = (!opt.combined_pdf.empty() && opt.image_format == "pdf");
-    std::filesystem::path combined_path;
-    std::size_t total_pages = 0;
-    if (use_combined_pdf) {
-        combined_path = std::filesystem::path(opt.out_dir) / opt.combined_pdf;
-        total_pages   = n_to_render * opt.planes.size();
-
-#if defined(R__HAS_IMPLICITMT)
-        if (ROOT::IsImplicitMTEnabled()) {
-            ROOT::DisableImplicitMT();
-            std::clog << "[EventDisplay] Implicit MT disabled for stable combined PDF output." << '\n';
-        }
-#else
-        if (ROOT::IsImplicitMTEnabled()) {
-            ROOT::DisableImplicitMT();
-            std::clog << "[EventDisplay] ROOT built without R__HAS_IMPLICITMT; disabling MT for combined PDF." << '\n';
-        }
-#endif
-    }
-
-    using nlohmann::json;
-    json manifest = json::array();
-    std::mutex manifest_mutex;
-
-    auto display_opts = opt.display;
-    display_opts.out_dir = opt.out_dir;
-
     if (opt.mode == Mode::Detector) {
         const std::vector<std::string> cols{
             opt.cols.run, opt.cols.sub, opt.cols.evt,
             opt.cols.det_u, opt.cols.det_v, opt.cols.det_w};
 
-        std::atomic<std::size_t> page_idx{0};
         limited.Foreach(
             [&](int run, int sub, int evt,
                 const std::vector<float>& det_u,
                 const std::vector<float>& det_v,
                 const std::vector<float>& det_w) {
-                std::clog << "[EventDisplay] Rendering detector images for "
-                          << "run=" << run
-                          << " sub=" << sub
-                          << " evt=" << evt
-                          << '\n';
-
-                auto pick = [&](const std::string& plane) -> const std::vector<float>& {
-                    if (plane == "U")
-                        return det_u;
-                    else if (plane == "V")
-                        return det_v;
-                    else
-                        return det_w;
-                };
-
-                for (const auto& plane : opt.planes) {
-                    const auto& img = pick(plane);
-
-                    auto plane_opts = display_opts;
-                    if (!img.empty()) {
-                        std::vector<float> vals;
-                        vals.reserve(img.size());
-                        for (float v : img)
-                            if (v > 0.0f)
-                                vals.push_back(v);
-
-                        if (!vals.empty()) {
-                            std::sort(vals.begin(), vals.end());
-                            auto q = [&](double f) -> float {
-                                std::size_t idx = std::min(vals.size() - 1,
-                                                           static_cast<std::size_t>(f * vals.size()));
-                                return vals[idx];
-                            };
-
-                            const float min_pos = q(0.02);
-                            const float max_val = q(0.995);
-
-                            plane_opts.det_min = std::max(min_pos, 1e-4f);
-                            plane_opts.det_max = max_val;
-                        }
-                    }
-                    const std::string tag = format_tag(opt.file_pattern, plane, run, sub, evt);
-                    const std::string title =
-                        "Detector Image, Plane " + plane +
-                        " - Run " + std::to_string(run) +
-                        ", Subrun " + std::to_string(sub) +
-                        ", Event " + std::to_string(evt);
-
-                    rarexsec::plot::EventDisplay::Spec spec{tag, title, Mode::Detector};
-                    EventDisplay ed(spec, plane_opts, img);
-
-                    if (use_combined_pdf) {
-                        const std::size_t idx = page_idx++;
-                        std::string target = combined_path.string();
-                        if (idx == 0)
-                            target += "(";
-                        else if (idx + 1 == total_pages)
-                            target += ")";
-                        ed.draw_and_save("pdf", target);
-                        if (!opt.manifest_path.empty()) {
-                            std::lock_guard<std::mutex> lock(manifest_mutex);
-                            manifest.push_back({{"run", run}, {"sub", sub}, {"evt", evt}, {"plane", plane}, {"file", combined_path.string()}});
-                        }
-                    } else {
-                        ed.draw_and_save(opt.image_format);
-                        if (!opt.manifest_path.empty()) {
-                            const std::string file = (std::filesystem::path(opt.out_dir) /
-                                                      (rarexsec::plot::Plotter::sanitise(tag) + "." + opt.image_format))
-                                                         .string();
-                            std::lock_guard<std::mutex> lock(manifest_mutex);
-                            manifest.push_back({{"run", run}, {"sub", sub}, {"evt", evt}, {"plane", plane}, {"file", file}});
-                        }
-                    }
-                }
+                batch.render(run, sub, evt, {&det_u, &det_v, &det_w});
             },
             cols);
     } else {
@@ -480,69 +692,96 @@ void rarexsec::plot::EventDisplay::render_from_rdf(ROOT::RDF::RNode df, const Ba
             opt.cols.run, opt.cols.sub, opt.cols.evt,
             opt.cols.sem_u, opt.cols.sem_v, opt.cols.sem_w};
 
-        std::atomic<std::size_t> page_idx{0};
         limited.Foreach(
             [&](int run, int sub, int evt,
                 const std::vector<int>& sem_u,
                 const std::vector<int>& sem_v,
                 const std::vector<int>& sem_w) {
-                std::clog << "[EventDisplay] Rendering semantic images for "
-                          << "run=" << run
-                          << " sub=" << sub
-                          << " evt=" << evt
-                          << '\n';
-
-                auto pick = [&](const std::string& plane) -> const std::vector<int>& {
-                    if (plane == "U")
-                        return sem_u;
-                    else if (plane == "V")
-                        return sem_v;
-                    else
-                        return sem_w;
-                };
-
-                for (const auto& plane : opt.planes) {
-                    const auto& img = pick(plane);
-                    const std::string tag = format_tag(opt.file_pattern, plane, run, sub, evt);
-                    const std::string title =
-                        "Semantic Image, Plane " + plane +
-                        " - Run " + std::to_string(run) +
-                        ", Subrun " + std::to_string(sub) +
-                        ", Event " + std::to_string(evt);
-
-                    rarexsec::plot::EventDisplay::Spec spec{tag, title, Mode::Semantic};
-                    EventDisplay ed(spec, display_opts, img);
-
-                    if (use_combined_pdf) {
-                        const std::size_t idx = page_idx++;
-                        std::string target = combined_path.string();
-                        if (idx == 0)
-                            target += "(";
-                        else if (idx + 1 == total_pages)
-                            target += ")";
-                        ed.draw_and_save("pdf", target);
-                        if (!opt.manifest_path.empty()) {
-                            std::lock_guard<std::mutex> lock(manifest_mutex);
-                            manifest.push_back({{"run", run}, {"sub", sub}, {"evt", evt}, {"plane", plane}, {"file", combined_path.string()}});
-                        }
-                    } else {
-                        ed.draw_and_save(opt.image_format);
-                        if (!opt.manifest_path.empty()) {
-                            const std::string file = (std::filesystem::path(opt.out_dir) /
-                                                      (rarexsec::plot::Plotter::sanitise(tag) + "." + opt.image_format))
-                                                         .string();
-                            std::lock_guard<std::mutex> lock(manifest_mutex);
-                            manifest.push_back({{"run", run}, {"sub", sub}, {"evt", evt}, {"plane", plane}, {"file", file}});
-                        }
-                    }
-                }
+                batch.render(run, sub, evt, {&sem_u, &sem_v, &sem_w});
             },
             cols);
     }
-    if (!opt.manifest_path.empty()) {
-        std::ofstream ofs(opt.manifest_path);
-        ofs << manifest.dump(2);
-        std::clog << "[EventDisplay] Wrote event display manifest: " << opt.manifest_path << '\n';
+    batch.finish();
+}
+//____________________________________________________________________________
+void rarexsec::plot::EventDisplay::render_events(const Entry& rec, const BatchOptions& opt)
+{
+    if (opt.events.empty()) {
+        std::cerr << "[EventDisplay] No events requested; nothing to render." << '\n';
+        return;
+    }
+    const io::EventIndex index =
+        io::EventIndex::open(rec.files, opt.tree, {opt.cols.run, opt.cols.sub, opt.cols.evt}, opt.index_dir);
+
+    // read in file and entry order; repeated keys are rendered once
+    std::vector<std::pair<io::EventIndex::Location, io::EventKey>> found;
+    for (const auto& key : opt.events) {
+        if (auto loc = index.find(key))
+            found.emplace_back(*loc, key);
+        else
+            std::cerr << "[EventDisplay] run=" << key.run << " sub=" << key.sub << " evt=" << key.evt
+                      << " not found in sample " << rec.beamline << "/" << rec.period << '\n';
+    }
+    auto by_entry = [](const auto& a, const auto& b) {
+        return std::tie(a.first.file, a.first.entry) < std::tie(b.first.file, b.first.entry);
+    };
+    std::sort(found.begin(), found.end(), by_entry);
+    found.erase(std::unique(found.begin(), found.end(),
+                            [&](const auto& a, const auto& b) { return !by_entry(a, b) && !by_entry(b, a); }),
+                found.end());
+    std::clog << "[EventDisplay] Found " << found.size() << " of " << opt.events.size()
+              << " requested events in " << index.size() << " indexed entries." << '\n';
+    if (found.empty())
+        return;
+
+    const bool detector = opt.mode == Mode::Detector;
+    const std::array<std::string, 3> columns = detector
+        ? std::array<std::string, 3>{opt.cols.det_u, opt.cols.det_v, opt.cols.det_w}
+        : std::array<std::string, 3>{opt.cols.sem_u, opt.cols.sem_v, opt.cols.sem_w};
+
+    Batch batch(opt, found.size());
+    for (std::size_t i = 0; i < found.size();) {
+        const std::string& file = index.files()[found[i].first.file];
+        // branch buffers owned here, so ROOT reads into them instead of allocating its own; declared
+        // before the file so they outlive its tree
+        std::array<DetectorData, 3> det_buf;
+        std::array<SemanticData, 3> sem_buf;
+        DetectorData* det[3] = {&det_buf[0], &det_buf[1], &det_buf[2]};
+        SemanticData* sem[3] = {&sem_buf[0], &sem_buf[1], &sem_buf[2]};
+        std::unique_ptr<TFile> in(TFile::Open(file.c_str(), "READ"));
+        if (!in || in->IsZombie())
+            throw std::runtime_error("EventDisplay::render_events: cannot open " + file);
+        auto* tree = in->Get<TTree>(opt.tree.c_str());
+        if (!tree)
+            throw std::runtime_error("EventDisplay::render_events: no " + opt.tree + " in " + file);
+
+        // only the requested planes' image branches are read
+        tree->SetBranchStatus("*", false);
+        std::array<bool, 3> wanted{};
+        for (const auto& plane : opt.planes)
+            wanted[Batch::plane_index(plane)] = true;
+        for (std::size_t p = 0; p < 3; ++p) {
+            if (!wanted[p])
+                continue;
+            tree->SetBranchStatus(columns[p].c_str(), true);
+            const int rc = detector ? tree->SetBranchAddress(columns[p].c_str(), &det[p])
+                                    : tree->SetBranchAddress(columns[p].c_str(), &sem[p]);
+            if (rc < 0)
+                throw std::runtime_error("EventDisplay::render_events: cannot read " + columns[p] + " from " + file);
+        }
+
+        for (; i < found.size() && index.files()[found[i].first.file] == file; ++i) {
+            const auto& [loc, key] = found[i];
+            if (tree->GetEntry(static_cast<Long64_t>(loc.entry)) <= 0)
+                throw std::runtime_error("EventDisplay::render_events: cannot read entry " +
+                                         std::to_string(loc.entry) + " of " + file);
+            if (detector)
+                batch.render(key.run, key.sub, key.evt, {det[0], det[1], det[2]});
+            else
+                batch.render(key.run, key.sub, key.evt, {sem[0], sem[1], sem[2]});
+        }
+        tree->ResetBranchAddresses();
     }
+    batch.finish();
 }
 //____________________________________________________________________________
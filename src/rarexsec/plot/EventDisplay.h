@@ -17,7 +17,12 @@
 
 #include <ROOT/RDataFrame.hxx>
 
+#include "rarexsec/io/EventIndex.h"
+
 namespace rarexsec {
+
+struct Entry;
+
 namespace plot {
 
 class Plotter;
@@ -55,6 +60,11 @@ class EventDisplay {
 
         bool show_legend = true;
         int legend_cols = 5;
+
+        // PNG output is drawn straight from the image by plot::Raster rather than through a
+        // TCanvas: same layout and colours, bitmap-font text, and detector pixels below
+        // det_threshold left white.
+        bool raster_png = true;
     };
 
     using DetectorData = std::vector<float>;
@@ -92,14 +102,28 @@ class EventDisplay {
 
         Mode mode{Mode::Detector};
         Options display;
+
+        // Events for render_events, e.g. from a scan; selection_expr and n_events do not apply.
+        std::vector<io::EventKey> events;
+        std::string tree{"nuselection/EventSelectionFilter"};
+        // Where event-index sidecars live; empty keeps them next to each input file.
+        std::string index_dir;
     };
 
     static void render_from_rdf(ROOT::RDF::RNode df, const BatchOptions& opt);
+    // Renders opt.events from the input files of rec, located through io::EventIndex and read by
+    // entry number, so only those entries' image branches are touched. Unknown keys are reported
+    // and skipped; throws std::runtime_error when a file or branch cannot be read.
+    static void render_events(const Entry& rec, const BatchOptions& opt);
 
   private:
+    struct Batch;
+
     EventDisplay(Spec spec, Options opt, DetectorData data);
     EventDisplay(Spec spec, Options opt, SemanticData data);
 
+    void render_png(const std::string& path) const;
+
     void setup_canvas(TCanvas& c) const;
     void build_histogram();
 
@@ -1,5 +1,6 @@
 #include "rarexsec/plot/Plotter.h"
 #include "rarexsec/plot/EventDisplay.h"
+#include "rarexsec/plot/RenderQueue.h"
 #include "rarexsec/plot/StackedHist.h"
 #include "rarexsec/plot/UnstackedHist.h"
 #include <TGaxis.h>
@@ -34,6 +35,10 @@ void rarexsec::plot::Plotter::draw_stack_by_channel(const TH1DModel& spec,
                                                     const std::vector<const Entry*>& mc,
                                                     const std::vector<const Entry*>& data) const {
     set_global_style();
+    if (queue_) {
+        queue_->add(std::make_unique<rarexsec::plot::StackedHist>(spec, opt_, mc, data), opt_.image_format);
+        return;
+    }
     rarexsec::plot::StackedHist plot(spec, opt_, mc, data);
     plot.draw_and_save(opt_.image_format);
 }
@@ -52,6 +57,11 @@ void rarexsec::plot::Plotter::draw_unstacked_by_channel(const TH1DModel& spec,
                                                         bool normalize_to_pdf,
                                                         int line_width) const {
     set_global_style();
+    if (queue_) {
+        queue_->add(std::make_unique<rarexsec::plot::UnstackedHist>(spec, opt_, mc, data, normalize_to_pdf, line_width),
+                    opt_.image_format);
+        return;
+    }
     rarexsec::plot::UnstackedHist plot(spec, opt_, mc, data, normalize_to_pdf, line_width);
     plot.draw_and_save(opt_.image_format);
 }
@@ -63,7 +73,12 @@ void rarexsec::plot::Plotter::draw_stack_by_channel_with_cov(const TH1DModel& sp
     set_global_style();
     auto opt2 = opt_;
     opt2.total_cov = std::make_shared<TMatrixDSym>(total_cov);
-    rarexsec::plot::StackedHist plot(spec, std::move(opt2), mc, data);
+    if (queue_) {
+        const std::string fmt = opt2.image_format;
+        queue_->add(std::make_unique<rarexsec::plot::StackedHist>(spec, std::move(opt2), mc, data), fmt);
+        return;
+    }
+    rarexsec::plot::StackedHist plot(spec, opt2, mc, data);
     plot.draw_and_save(opt2.image_format);
 }
 
@@ -10,6 +10,8 @@
 
 namespace rarexsec::plot {
 
+class RenderQueue;
+
 class Plotter {
   public:
     Plotter();
@@ -20,6 +22,10 @@ class Plotter {
 
     void set_options(Options opt);
 
+    // While set, stacked and unstacked plots are filled at once and handed to the queue for drawing
+    // in its worker processes (see RenderQueue::run); event displays are still drawn directly.
+    void set_render_queue(RenderQueue* queue) noexcept { queue_ = queue; }
+
     void draw_stack_by_channel(const TH1DModel& spec,
                                const std::vector<const Entry*>& mc) const;
 
@@ -58,6 +64,7 @@ class Plotter {
 
   private:
     Options opt_;
+    RenderQueue* queue_ = nullptr;
 };
 
 }
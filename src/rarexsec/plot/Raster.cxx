@@ -0,0 +1,224 @@
+#include "rarexsec/plot/Raster.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <zlib.h>
+
+namespace {
+
+// Printable ASCII (0x20-0x7e), 16 rows of 8 pixels each, MSB leftmost; rendered from DejaVu Sans
+// Mono at 13 px without anti-aliasing.
+constexpr std::uint8_t kFont[95][16] = {
+    {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00}, // ' '
+    {0x00,0x00,0x00,0x10,0x10,0x10,0x10,0x10,0x10,0x00,0x10,0x10,0x00,0x00,0x00,0x00}, // '!'
+    {0x00,0x00,0x00,0x28,0x28,0x28,0x28,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00}, // '"'
+    {0x00,0x00,0x12,0x12,0x16,0x7f,0x24,0x24,0xfe,0x28,0x48,0x48,0x00,0x00,0x00,0x00}, // '#'
+    {0x00,0x00,0x00,0x08,0x3e,0x49,0x48,0x38,0x0e,0x09,0x49,0x3e,0x08,0x08,0x00,0x00}, // '$'
+    {0x00,0x00,0x00,0x60,0x90,0x90,0x62,0x1c,0x66,0x09,0x09,0x06,0x00,0x00,0x00,0x00}, // '%'
+    {0x00,0x00,0x00,0x1c,0x20,0x20,0x30,0x49,0x4d,0x45,0x62,0x3d,0x00,0x00,0x00,0x00}, // '&'
+    {0x00,0x00,0x00,0x10,0x10,0x10,0x10,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00}, // '''
+    {0x00,0x0c,0x08,0x08,0x10,0x10,0x10,0x10,0x10,0x10,0x08,0x08,0x04,0x00,0x00,0x00}, // '('
+    {0x00,0x30,0x10,0x10,0x08,0x08,0x08,0x08,0x08,0x08,0x10,0x10,0x30,0x00,0x00,0x00}, // ')'
+    {0x00,0x00,0x00,0x08,0x49,0x3e,0x1c,0x6b,0x08,0x00,0x00,0x00,0x00,0x00,0x00,0x00}, // '*'
+    {0x00,0x00,0x00,0x00,0x10,0x10,0x10,0xfe,0x10,0x10,0x10,0x00,0x00,0x00,0x00,0x00}, // '+'
+    {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x18,0x18,0x10,0x20,0x00,0x00}, // ','
+    {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x38,0x00,0x00,0x00,0x00,0x00,0x00,0x00}, // '-'
+    {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x18,0x18,0x00,0x00,0x00,0x00}, // '.'
+    {0x00,0x00,0x00,0x02,0x04,0x04,0x08,0x08,0x18,0x10,0x10,0x20,0x20,0x40,0x00,0x00}, // '/'
+    {0x00,0x00,0x00,0x1c,0x22,0x41,0x41,0x49,0x41,0x41,0x22,0x1c,0x00,0x00,0x00,0x00}, // '0'
+    {0x00,0x00,0x00,0x38,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x3e,0x00,0x00,0x00,0x00}, // '1'
+    {0x00,0x00,0x00,0x3e,0x43,0x01,0x01,0x02,0x0c,0x18,0x20,0x7f,0x00,0x00,0x00,0x00}, // '2'
+    {0x00,0x00,0x00,0x3e,0x41,0x01,0x03,0x1c,0x03,0x01,0x43,0x3e,0x00,0x00,0x00,0x00}, // '3'
+    {0x00,0x00,0x00,0x06,0x0a,0x1a,0x12,0x22,0x42,0x7f,0x02,0x02,0x00,0x00,0x00,0x00}, // '4'
+    {0x00,0x00,0x00,0x7e,0x40,0x40,0x7c,0x03,0x01,0x01,0x43,0x3c,0x00,0x00,0x00,0x00}, // '5'
+    {0x00,0x00,0x00,0x1e,0x21,0x40,0x5e,0x63,0x41,0x41,0x23,0x1e,0x00,0x00,0x00,0x00}, // '6'
+    {0x00,0x00,0x00,0x7f,0x02,0x02,0x04,0x04,0x08,0x18,0x10,0x20,0x00,0x00,0x00,0x00}, // '7'
+    {0x00,0x00,0x00,0x3e,0x41,0x41,0x41,0x3e,0x63,0x41,0x61,0x3e,0x00,0x00,0x00,0x00}, // '8'
+    {0x00,0x00,0x00,0x3c,0x62,0x41,0x41,0x63,0x3d,0x01,0x42,0x3c,0x00,0x00,0x00,0x00}, // '9'
+    {0x00,0x00,0x00,0x00,0x00,0x18,0x18,0x00,0x00,0x00,0x18,0x18,0x00,0x00,0x00,0x00}, // ':'
+    {0x00,0x00,0x00,0x00,0x00,0x18,0x18,0x00,0x00,0x00,0x18,0x18,0x10,0x20,0x00,0x00}, // ';'
+    {0x00,0x00,0x00,0x00,0x00,0x01,0x0e,0x70,0x70,0x0e,0x01,0x00,0x00,0x00,0x00,0x00}, // '<'
+    {0x00,0x00,0x00,0x00,0x00,0x00,0x7f,0x00,0x00,0x7f,0x00,0x00,0x00,0x00,0x00,0x00}, // '='
+    {0x00,0x00,0x00,0x00,0x00,0x40,0x38,0x07,0x07,0x38,0x40,0x00,0x00,0x00,0x00,0x00}, // '>'
+    {0x00,0x00,0x00,0x38,0x44,0x04,0x08,0x10,0x10,0x00,0x10,0x10,0x00,0x00,0x00,0x00}, // '?'
+    {0x00,0x00,0x00,0x1e,0x33,0x21,0x47,0x49,0x49,0x49,0x47,0x20,0x30,0x1e,0x00,0x00}, // '@'
+    {0x00,0x00,0x00,0x08,0x14,0x14,0x14,0x22,0x22,0x3e,0x63,0x41,0x00,0x00,0x00,0x00}, // 'A'
+    {0x00,0x00,0x00,0x7e,0x41,0x41,0x41,0x7e,0x41,0x41,0x41,0x7e,0x00,0x00,0x00,0x00}, // 'B'
+    {0x00,0x00,0x00,0x1e,0x21,0x40,0x40,0x40,0x40,0x40,0x21,0x1e,0x00,0x00,0x00,0x00}, // 'C'
+    {0x00,0x00,0x00,0x7c,0x42,0x41,0x41,0x41,0x41,0x41,0x42,0x7c,0x00,0x00,0x00,0x00}, // 'D'
+    {0x00,0x00,0x00,0x7f,0x40,0x40,0x40,0x7f,0x40,0x40,0x40,0x7f,0x00,0x00,0x00,0x00}, // 'E'
+    {0x00,0x00,0x00,0x7f,0x40,0x40,0x40,0x7f,0x40,0x40,0x40,0x40,0x00,0x00,0x00,0x00}, // 'F'
+    {0x00,0x00,0x00,0x1e,0x21,0x40,0x40,0x43,0x41,0x41,0x21,0x1e,0x00,0x00,0x00,0x00}, // 'G'
+    {0x00,0x00,0x00,0x41,0x41,0x41,0x41,0x7f,0x41,0x41,0x41,0x41,0x00,0x00,0x00,0x00}, // 'H'
+    {0x00,0x00,0x00,0x7c,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x7c,0x00,0x00,0x00,0x00}, // 'I'
+    {0x00,0x00,0x00,0x1c,0x04,0x04,0x04,0x04,0x04,0x04,0x44,0x38,0x00,0x00,0x00,0x00}, // 'J'
+    {0x00,0x00,0x00,0x42,0x44,0x48,0x50,0x70,0x48,0x44,0x44,0x42,0x00,0x00,0x00,0x00}, // 'K'
+    {0x00,0x00,0x00,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x7f,0x00,0x00,0x00,0x00}, // 'L'
+    {0x00,0x00,0x00,0x63,0x63,0x55,0x55,0x55,0x49,0x41,0x41,0x41,0x00,0x00,0x00,0x00}, // 'M'
+    {0x00,0x00,0x00,0x61,0x61,0x51,0x51,0x49,0x45,0x45,0x43,0x43,0x00,0x00,0x00,0x00}, // 'N'
+    {0x00,0x00,0x00,0x1c,0x22,0x41,0x41,0x41,0x41,0x41,0x22,0x1c,0x00,0x00,0x00,0x00}, // 'O'
+    {0x00,0x00,0x00,0x7e,0x43,0x41,0x41,0x43,0x7e,0x40,0x40,0x40,0x00,0x00,0x00,0x00}, // 'P'
+    {0x00,0x00,0x00,0x1c,0x22,0x41,0x41,0x41,0x41,0x41,0x23,0x1e,0x06,0x02,0x00,0x00}, // 'Q'
+    {0x00,0x00,0x00,0x7e,0x43,0x41,0x41,0x7e,0x42,0x41,0x41,0x40,0x00,0x00,0x00,0x00}, // 'R'
+    {0x00,0x00,0x00,0x3e,0x61,0x40,0x60,0x3e,0x03,0x01,0x43,0x3e,0x00,0x00,0x00,0x00}, // 'S'
+    {0x00,0x00,0x00,0xfe,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x00,0x00,0x00,0x00}, // 'T'
+    {0x00,0x00,0x00,0x41,0x41,0x41,0x41,0x41,0x41,0x41,0x41,0x3e,0x00,0x00,0x00,0x00}, // 'U'
+    {0x00,0x00,0x00,0x41,0x63,0x22,0x22,0x22,0x14,0x14,0x14,0x08,0x00,0x00,0x00,0x00}, // 'V'
+    {0x00,0x00,0x00,0x81,0x81,0x81,0x5a,0x5a,0x5a,0x66,0x66,0x66,0x00,0x00,0x00,0x00}, // 'W'
+    {0x00,0x00,0x00,0x63,0x22,0x14,0x1c,0x08,0x14,0x36,0x22,0x41,0x00,0x00,0x00,0x00}, // 'X'
+    {0x00,0x00,0x00,0x82,0x44,0x28,0x28,0x10,0x10,0x10,0x10,0x10,0x00,0x00,0x00,0x00}, // 'Y'
+    {0x00,0x00,0x00,0x7f,0x03,0x06,0x04,0x08,0x10,0x30,0x60,0x7f,0x00,0x00,0x00,0x00}, // 'Z'
+    {0x00,0x1c,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x1c,0x00,0x00,0x00}, // '['
+    {0x00,0x00,0x00,0x40,0x20,0x20,0x10,0x10,0x18,0x08,0x08,0x04,0x04,0x02,0x00,0x00}, // backslash
+    {0x00,0x38,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x38,0x00,0x00,0x00}, // ']'
+    {0x00,0x00,0x00,0x10,0x28,0x44,0xc6,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00}, // '^'
+    {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xff,0x00}, // '_'
+    {0x00,0x00,0x10,0x08,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00}, // '`'
+    {0x00,0x00,0x00,0x00,0x00,0x1c,0x22,0x02,0x3e,0x42,0x46,0x3a,0x00,0x00,0x00,0x00}, // 'a'
+    {0x00,0x40,0x40,0x40,0x40,0x7c,0x66,0x42,0x42,0x42,0x66,0x7c,0x00,0x00,0x00,0x00}, // 'b'
+    {0x00,0x00,0x00,0x00,0x00,0x1c,0x22,0x40,0x40,0x40,0x22,0x1c,0x00,0x00,0x00,0x00}, // 'c'
+    {0x00,0x02,0x02,0x02,0x02,0x3e,0x66,0x42,0x42,0x42,0x66,0x3e,0x00,0x00,0x00,0x00}, // 'd'
+    {0x00,0x00,0x00,0x00,0x00,0x3c,0x66,0x42,0x7e,0x40,0x62,0x3c,0x00,0x00,0x00,0x00}, // 'e'
+    {0x00,0x0c,0x10,0x10,0x10,0x7c,0x10,0x10,0x10,0x10,0x10,0x10,0x00,0x00,0x00,0x00}, // 'f'
+    {0x00,0x00,0x00,0x00,0x00,0x3e,0x66,0x42,0x42,0x42,0x66,0x3a,0x02,0x22,0x1c,0x00}, // 'g'
+    {0x00,0x40,0x40,0x40,0x40,0x5c,0x62,0x42,0x42,0x42,0x42,0x42,0x00,0x00,0x00,0x00}, // 'h'
+    {0x00,0x10,0x00,0x00,0x00,0x70,0x10,0x10,0x10,0x10,0x10,0x7c,0x00,0x00,0x00,0x00}, // 'i'
+    {0x00,0x08,0x00,0x00,0x00,0x38,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x70,0x00}, // 'j'
+    {0x00,0x40,0x40,0x40,0x40,0x44,0x48,0x50,0x70,0x48,0x44,0x42,0x00,0x00,0x00,0x00}, // 'k'
+    {0x00,0x70,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x0e,0x00,0x00,0x00,0x00}, // 'l'
+    {0x00,0x00,0x00,0x00,0x00,0x7f,0x49,0x49,0x49,0x49,0x49,0x49,0x00,0x00,0x00,0x00}, // 'm'
+    {0x00,0x00,0x00,0x00,0x00,0x5c,0x62,0x42,0x42,0x42,0x42,0x42,0x00,0x00,0x00,0x00}, // 'n'
+    {0x00,0x00,0x00,0x00,0x00,0x3c,0x66,0x42,0x42,0x42,0x66,0x3c,0x00,0x00,0x00,0x00}, // 'o'
+    {0x00,0x00,0x00,0x00,0x00,0x7c,0x66,0x42,0x42,0x42,0x66,0x7c,0x40,0x40,0x40,0x00}, // 'p'
+    {0x00,0x00,0x00,0x00,0x00,0x3e,0x66,0x42,0x42,0x42,0x66,0x3a,0x02,0x02,0x02,0x00}, // 'q'
+    {0x00,0x00,0x00,0x00,0x00,0x3c,0x32,0x20,0x20,0x20,0x20,0x20,0x00,0x00,0x00,0x00}, // 'r'
+    {0x00,0x00,0x00,0x00,0x00,0x3c,0x42,0x40,0x3c,0x02,0x42,0x3c,0x00,0x00,0x00,0x00}, // 's'
+    {0x00,0x00,0x00,0x10,0x10,0x7e,0x10,0x10,0x10,0x10,0x10,0x0e,0x00,0x00,0x00,0x00}, // 't'
+    {0x00,0x00,0x00,0x00,0x00,0x42,0x42,0x42,0x42,0x42,0x46,0x3a,0x00,0x00,0x00,0x00}, // 'u'
+    {0x00,0x00,0x00,0x00,0x00,0x42,0x66,0x24,0x24,0x3c,0x18,0x18,0x00,0x00,0x00,0x00}, // 'v'
+    {0x00,0x00,0x00,0x00,0x00,0x81,0x81,0x5a,0x5a,0x5a,0x24,0x24,0x00,0x00,0x00,0x00}, // 'w'
+    {0x00,0x00,0x00,0x00,0x00,0x66,0x24,0x18,0x18,0x18,0x24,0x66,0x00,0x00,0x00,0x00}, // 'x'
+    {0x00,0x00,0x00,0x00,0x00,0x42,0x22,0x24,0x24,0x14,0x18,0x08,0x08,0x10,0x30,0x00}, // 'y'
+    {0x00,0x00,0x00,0x00,0x00,0x7e,0x02,0x04,0x18,0x20,0x40,0x7e,0x00,0x00,0x00,0x00}, // 'z'
+    {0x00,0x1c,0x10,0x10,0x10,0x10,0x60,0x10,0x10,0x10,0x10,0x10,0x0c,0x00,0x00,0x00}, // '{'
+    {0x00,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x00,0x00}, // '|'
+    {0x00,0x70,0x10,0x10,0x10,0x10,0x0c,0x10,0x10,0x10,0x10,0x10,0x60,0x00,0x00,0x00}, // '}'
+    {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x39,0x46,0x00,0x00,0x00,0x00,0x00,0x00,0x00}, // '~'
+};
+
+void put_u32(std::string& out, std::uint32_t v)
+{
+    const char b[4] = {static_cast<char>(v >> 24), static_cast<char>(v >> 16), static_cast<char>(v >> 8),
+                       static_cast<char>(v)};
+    out.append(b, 4);
+}
+
+void chunk(std::string& out, const char* type, const std::string& data)
+{
+    put_u32(out, static_cast<std::uint32_t>(data.size()));
+    const std::size_t start = out.size();
+    out.append(type, 4);
+    out += data;
+    const auto* p = reinterpret_cast<const Bytef*>(out.data() + start);
+    put_u32(out, static_cast<std::uint32_t>(crc32(0L, p, static_cast<uInt>(out.size() - start))));
+}
+
+}
+
+//____________________________________________________________________________
+rarexsec::plot::Raster::Raster(int width, int height, std::uint32_t fill)
+    : width_(std::max(1, width)), height_(std::max(1, height)),
+      pixels_(static_cast<std::size_t>(width_) * height_, pixel(fill)) {}
+//____________________________________________________________________________
+std::uint32_t rarexsec::plot::Raster::pixel(std::uint32_t rgb)
+{
+    const std::uint8_t b[4] = {static_cast<std::uint8_t>(rgb >> 16), static_cast<std::uint8_t>(rgb >> 8),
+                               static_cast<std::uint8_t>(rgb), 0xff};
+    std::uint32_t px;
+    std::memcpy(&px, b, 4);
+    return px;
+}
+//____________________________________________________________________________
+void rarexsec::plot::Raster::fill_rect(int x, int y, int w, int h, std::uint32_t rgb)
+{
+    const int x0 = std::max(0, x), x1 = std::min(width_, x + w);
+    const int y0 = std::max(0, y), y1 = std::min(height_, y + h);
+    if (x0 >= x1)
+        return;
+    const std::uint32_t px = pixel(rgb);
+    for (int yy = y0; yy < y1; ++yy)
+        std::fill(row(yy) + x0, row(yy) + x1, px);
+}
+//____________________________________________________________________________
+void rarexsec::plot::Raster::text(int x, int y, const std::string& s, int scale, std::uint32_t rgb)
+{
+    scale = std::max(1, scale);
+    for (std::size_t i = 0; i < s.size(); ++i) {
+        const unsigned char c = static_cast<unsigned char>(s[i]);
+        if (c < 0x20 || c > 0x7e)
+            continue;
+        const int gx = x + static_cast<int>(i) * 8 * scale;
+        for (int r = 0; r < 16; ++r) {
+            const std::uint8_t bits = kFont[c - 0x20][r];
+            for (int b = 0; b < 8; ++b) {
+                if (bits & (0x80 >> b))
+                    fill_rect(gx + b * scale, y + r * scale, scale, scale, rgb);
+            }
+        }
+    }
+}
+//____________________________________________________________________________
+void rarexsec::plot::Raster::text_vertical(int x, int y, const std::string& s, int scale, std::uint32_t rgb)
+{
+    scale = std::max(1, scale);
+    for (std::size_t i = 0; i < s.size(); ++i) {
+        const unsigned char c = static_cast<unsigned char>(s[i]);
+        if (c < 0x20 || c > 0x7e)
+            continue;
+        // glyph rotated 90 degrees anticlockwise: its rows become columns from the left
+        const int gy = y - static_cast<int>(i + 1) * 8 * scale;
+        for (int r = 0; r < 16; ++r) {
+            const std::uint8_t bits = kFont[c - 0x20][r];
+            for (int b = 0; b < 8; ++b) {
+                if (bits & (0x80 >> b))
+                    fill_rect(x + r * scale, gy + (7 - b) * scale, scale, scale, rgb);
+            }
+        }
+    }
+}
+//____________________________________________________________________________
+void rarexsec::plot::Raster::write_png(const std::string& path) const
+{
+    const std::size_t stride = static_cast<std::size_t>(width_) * 4;
+    std::string raw;
+    raw.resize((stride + 1) * height_);
+    for (int y = 0; y < height_; ++y) {
+        char* dst = &raw[(stride + 1) * y];
+        dst[0] = 0; // filter: none
+        std::memcpy(dst + 1, pixels_.data() + static_cast<std::size_t>(y) * width_, stride);
+    }
+    uLongf zlen = compressBound(static_cast<uLong>(raw.size()));
+    std::string z(zlen, '\0');
+    if (compress2(reinterpret_cast<Bytef*>(&z[0]), &zlen, reinterpret_cast<const Bytef*>(raw.data()),
+                  static_cast<uLong>(raw.size()), Z_BEST_SPEED) != Z_OK)
+        throw std::runtime_error("Raster::write_png: compression failed for " + path);
+    z.resize(zlen);
+
+    std::string ihdr;
+    put_u32(ihdr, static_cast<std::uint32_t>(width_));
+    put_u32(ihdr, static_cast<std::uint32_t>(height_));
+    ihdr += std::string("\x08\x06\x00\x00\x00", 5); // 8-bit RGBA, deflate, no interlace
+
+    std::string out("\x89PNG\r\n\x1a\n", 8);
+    chunk(out, "IHDR", ihdr);
+    chunk(out, "IDAT", z);
+    chunk(out, "IEND", std::string());
+
+    std::ofstream os(path, std::ios::binary | std::ios::trunc);
+    os.write(out.data(), static_cast<std::streamsize>(out.size()));
+    if (!os)
+        throw std::runtime_error("Raster::write_png: cannot write " + path);
+}
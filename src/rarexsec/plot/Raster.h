@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rarexsec {
+namespace plot {
+
+// 8-bit RGBA image, rows top to bottom, with just enough drawing for event-display overlays:
+// filled rectangles and text in a built-in 8x16 bitmap font (printable ASCII) scaled by an
+// integer factor. Colours are 0xRRGGBB.
+class Raster {
+  public:
+    Raster(int width, int height, std::uint32_t fill);
+
+    // Pixel word for a colour, as stored by row()
+    static std::uint32_t pixel(std::uint32_t rgb);
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    std::uint32_t* row(int y) { return pixels_.data() + static_cast<std::size_t>(y) * width_; }
+
+    void fill_rect(int x, int y, int w, int h, std::uint32_t rgb);
+    // Text with its top-left corner at (x, y); vertical text reads bottom to top with its
+    // bottom-left corner at (x, y).
+    void text(int x, int y, const std::string& s, int scale, std::uint32_t rgb);
+    void text_vertical(int x, int y, const std::string& s, int scale, std::uint32_t rgb);
+    static int text_width(const std::string& s, int scale) { return static_cast<int>(s.size()) * 8 * scale; }
+    static int text_height(int scale) { return 16 * scale; }
+
+    // Deflate level 1 (images are mostly flat and compress well anyway); throws
+    // std::runtime_error on I/O failure.
+    void write_png(const std::string& path) const;
+
+  private:
+    int width_, height_;
+    // RGBA bytes in memory order, one word per pixel
+    std::vector<std::uint32_t> pixels_;
+};
+
+}
+}
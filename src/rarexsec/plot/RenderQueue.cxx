@@ -0,0 +1,191 @@
+#include "rarexsec/plot/RenderQueue.h"
+#include "rarexsec/plot/StackedHist.h"
+#include "rarexsec/plot/UnstackedHist.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+void render_here(const std::function<void()>& render, rarexsec::plot::RenderQueue::Result& r)
+{
+    try {
+        render();
+        r.ok = true;
+    } catch (const std::exception& e) {
+        r.error = e.what();
+    } catch (...) {
+        r.error = "unknown exception";
+    }
+}
+
+[[noreturn]] void run_child(const std::function<void()>& render, int fd)
+{
+    int status = 0;
+    std::string error;
+    try {
+        render();
+    } catch (const std::exception& e) {
+        error = e.what();
+        status = 1;
+    } catch (...) {
+        error = "unknown exception";
+        status = 1;
+    }
+    for (std::size_t off = 0; off < error.size();) {
+        const ssize_t n = ::write(fd, error.data() + off, error.size() - off);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        off += static_cast<std::size_t>(n);
+    }
+    ::close(fd);
+    std::cout.flush();
+    std::cerr.flush();
+    // skip atexit handlers and static destructors that belong to the parent
+    ::_exit(status);
+}
+
+std::string describe(int status)
+{
+    if (WIFSIGNALED(status))
+        return std::string("worker killed by signal ") + std::to_string(WTERMSIG(status)) + " (" +
+               strsignal(WTERMSIG(status)) + ")";
+    if (WIFEXITED(status))
+        return "worker exited with status " + std::to_string(WEXITSTATUS(status));
+    return "worker failed";
+}
+
+}
+
+//____________________________________________________________________________
+rarexsec::plot::RenderQueue::RenderQueue(unsigned workers)
+    : workers_(workers ? workers : std::max(1u, std::thread::hardware_concurrency()))
+{
+}
+//____________________________________________________________________________
+rarexsec::plot::RenderQueue::~RenderQueue() = default;
+//____________________________________________________________________________
+void rarexsec::plot::RenderQueue::add(std::unique_ptr<StackedHist> plot, const std::string& image_format)
+{
+    if (!plot)
+        throw std::invalid_argument("RenderQueue::add: null plot");
+    plot->build();
+    std::shared_ptr<StackedHist> p(std::move(plot));
+    jobs_.push_back({p->id(), p->output_path(image_format), [p, image_format] { p->draw_and_save(image_format); }});
+}
+//____________________________________________________________________________
+void rarexsec::plot::RenderQueue::add(std::unique_ptr<UnstackedHist> plot, const std::string& image_format)
+{
+    if (!plot)
+        throw std::invalid_argument("RenderQueue::add: null plot");
+    plot->build();
+    std::shared_ptr<UnstackedHist> p(std::move(plot));
+    jobs_.push_back({p->id(), p->output_path(image_format), [p, image_format] { p->draw_and_save(image_format); }});
+}
+//____________________________________________________________________________
+std::vector<rarexsec::plot::RenderQueue::Result> rarexsec::plot::RenderQueue::run()
+{
+    std::vector<Job> jobs;
+    jobs.swap(jobs_);
+    std::vector<Result> out(jobs.size());
+    for (std::size_t i = 0; i < jobs.size(); ++i) {
+        out[i].id = jobs[i].id;
+        out[i].file = jobs[i].file;
+    }
+    if (workers_ <= 1 || jobs.size() <= 1) {
+        for (std::size_t i = 0; i < jobs.size(); ++i)
+            render_here(jobs[i].render, out[i]);
+        return out;
+    }
+
+    struct Child {
+        std::size_t job;
+        int fd;
+        std::string message;
+    };
+    std::map<pid_t, Child> running;
+    std::size_t next = 0;
+
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(nullptr);
+    while (next < jobs.size() || !running.empty()) {
+        while (next < jobs.size() && running.size() < workers_) {
+            const std::size_t i = next++;
+            int fds[2];
+            if (::pipe(fds) != 0) {
+                render_here(jobs[i].render, out[i]);
+                continue;
+            }
+            const pid_t pid = ::fork();
+            if (pid == 0) {
+                ::close(fds[0]);
+                for (const auto& [other, child] : running)
+                    ::close(child.fd);
+                run_child(jobs[i].render, fds[1]);
+            }
+            ::close(fds[1]);
+            if (pid < 0) {
+                // out of processes: draw it here rather than lose it
+                ::close(fds[0]);
+                render_here(jobs[i].render, out[i]);
+                continue;
+            }
+            running.emplace(pid, Child{i, fds[0], {}});
+        }
+        if (running.empty())
+            continue;
+
+        // a child's pipe reaches end-of-file when it exits
+        std::vector<pollfd> fds;
+        std::vector<pid_t> pids;
+        for (const auto& [pid, child] : running) {
+            fds.push_back({child.fd, POLLIN, 0});
+            pids.push_back(pid);
+        }
+        if (::poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(std::string("RenderQueue::run: poll: ") + std::strerror(errno));
+        }
+        for (std::size_t k = 0; k < fds.size(); ++k) {
+            if (!fds[k].revents)
+                continue;
+            Child& child = running.at(pids[k]);
+            char buf[4096];
+            const ssize_t n = ::read(child.fd, buf, sizeof(buf));
+            if (n > 0) {
+                child.message.append(buf, static_cast<std::size_t>(n));
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            ::close(child.fd);
+            int status = 0;
+            while (::waitpid(pids[k], &status, 0) < 0 && errno == EINTR) {
+            }
+            Result& r = out[child.job];
+            r.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+            if (!r.ok)
+                r.error = child.message.empty() ? describe(status) : child.message;
+            running.erase(pids[k]);
+        }
+    }
+    return out;
+}
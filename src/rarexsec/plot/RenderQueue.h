@@ -0,0 +1,57 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rarexsec {
+namespace plot {
+
+class StackedHist;
+class UnstackedHist;
+
+// Renders plots whose histograms are already filled in a pool of forked worker processes. Each
+// plot is drawn in a child of its own, which sees the filled stack components, totals, data,
+// covariance band and options through copy-on-write memory, and has its own canvas, pad and style
+// state; ROOT's serial graphics thus run on several cores. Event loops stay in this process, so
+// implicit MT may be used to fill the plots. A plot that throws or crashes is reported in its
+// result and does not stop the others. Queued plots keep pointers to their samples, which must
+// outlive run().
+class RenderQueue {
+  public:
+    struct Result {
+        std::string id;
+        std::string file;
+        bool ok = false;
+        std::string error;
+    };
+
+    // Worker processes; 0 takes the hardware concurrency, 1 renders in this process.
+    explicit RenderQueue(unsigned workers = 0);
+    ~RenderQueue();
+    RenderQueue(const RenderQueue&) = delete;
+    RenderQueue& operator=(const RenderQueue&) = delete;
+
+    // Fills the plot now (its event loops run here); it is drawn by run().
+    void add(std::unique_ptr<StackedHist> plot, const std::string& image_format);
+    void add(std::unique_ptr<UnstackedHist> plot, const std::string& image_format);
+
+    std::size_t size() const noexcept { return jobs_.size(); }
+    unsigned workers() const noexcept { return workers_; }
+
+    // Draws and saves everything queued, then empties the queue. Results follow the order of add().
+    std::vector<Result> run();
+
+  private:
+    struct Job {
+        std::string id;
+        std::string file;
+        std::function<void()> render;
+    };
+
+    unsigned workers_;
+    std::vector<Job> jobs_;
+};
+
+}
+}
@@ -9,6 +9,8 @@
 #include "TMatrixDSym.h"
 #include "rarexsec/plot/Plotter.h"
 #include "rarexsec/plot/Channels.h"
+#include "rarexsec/io/BranchUsage.h"
+#include "rarexsec/exec/Plan.h"
 #include <algorithm>
 #include <cmath>
 #include <filesystem>
@@ -136,32 +138,91 @@ void rarexsec::plot::StackedHist::setup_pads(TCanvas& c, TPad*& p_main, TPad*& p
     }
 }
 
-void rarexsec::plot::StackedHist::build_histograms() {
-    const auto axes = spec_.axis_title();
-    stack_ = std::make_unique<THStack>((spec_.id + "_stack").c_str(), axes.c_str());
-    mc_ch_hists_.clear();
-    mc_total_.reset();
-    data_hist_.reset();
-    sig_hist_.reset();
-    signal_scale_ = 1.0;
-    std::map<int, std::vector<ROOT::RDF::RResultPtr<TH1D>>> booked;
+void rarexsec::plot::StackedHist::declare(exec::Plan& plan) const {
+    for (const auto* samples : {&mc_, &data_}) {
+        for (const Entry* e : *samples) {
+            if (!e)
+                continue;
+            plan.declare(*e, spec_.expr.empty() ? spec_.id : spec_.expr);
+            if (samples == &mc_)
+                plan.declare(*e, spec_.weight);
+        }
+    }
+}
+
+void rarexsec::plot::StackedHist::book(exec::Plan& plan) {
+    book_histograms(&plan);
+}
+
+// Without a plan each plot selects and splits the samples on nodes of its own.
+void rarexsec::plot::StackedHist::book_histograms(exec::Plan* plan) {
+    booked_mc_.clear();
+    booked_data_.clear();
     const auto& channels = rarexsec::plot::Channels::mc_keys();
 
+    auto& usage = rarexsec::io::branch_usage();
+    usage.request_expression(spec_.expr.empty() ? spec_.id : spec_.expr);
+    usage.request_expression(spec_.weight);
+    usage.request("analysis_channels");
+
     for (size_t ie = 0; ie < mc_.size(); ++ie) {
         const Entry* e = mc_[ie];
         if (!e)
             continue;
+        if (plan) {
+            const std::string var = plan->column(*e, spec_.expr.empty() ? spec_.id : spec_.expr);
+            const std::string weight = plan->column(*e, spec_.weight);
+            for (int ch : channels) {
+                auto h = plan->node(*e, spec_.sel, ch)
+                             .Histo1D(spec_.model("_mc_ch" + std::to_string(ch) + "_src" + std::to_string(ie)), var, weight);
+                booked_mc_[ch].push_back(h);
+            }
+            continue;
+        }
         auto n0 = selection::apply(e->rnode(), spec_.sel, *e);
         auto n = (spec_.expr.empty() ? n0 : n0.Define("_rx_expr_", spec_.expr));
         const std::string var = spec_.expr.empty() ? spec_.id : "_rx_expr_";
         for (int ch : channels) {
             auto nf = n.Filter([ch](int c) { return c == ch; }, {"analysis_channels"});
             auto h = nf.Histo1D(spec_.model("_mc_ch" + std::to_string(ch) + "_src" + std::to_string(ie)), var, spec_.weight);
-            booked[ch].push_back(h);
+            booked_mc_[ch].push_back(h);
+        }
+    }
+
+    for (size_t ie = 0; ie < data_.size(); ++ie) {
+        const Entry* e = data_[ie];
+        if (!e)
+            continue;
+        if (plan) {
+            const std::string var = plan->column(*e, spec_.expr.empty() ? spec_.id : spec_.expr);
+            booked_data_.push_back(plan->node(*e, spec_.sel).Histo1D(spec_.model("_data_src" + std::to_string(ie)), var));
+            continue;
         }
+        auto n0 = selection::apply(e->rnode(), spec_.sel, *e);
+        auto n = (spec_.expr.empty() ? n0 : n0.Define("_rx_expr_", spec_.expr));
+        const std::string var = spec_.expr.empty() ? spec_.id : "_rx_expr_";
+        booked_data_.push_back(n.Histo1D(spec_.model("_data_src" + std::to_string(ie)), var));
     }
+    booked_ = true;
+}
+
+void rarexsec::plot::StackedHist::build_histograms() {
+    const auto axes = spec_.axis_title();
+    stack_ = std::make_unique<THStack>((spec_.id + "_stack").c_str(), axes.c_str());
+    mc_ch_hists_.clear();
+    mc_total_.reset();
+    data_hist_.reset();
+    sig_hist_.reset();
+    signal_scale_ = 1.0;
+    if (!booked_)
+        book_histograms(nullptr);
+    auto booked = std::move(booked_mc_);
+    auto parts = std::move(booked_data_);
+    booked_mc_.clear();
+    booked_data_.clear();
+    booked_ = false;
+    const auto& channels = rarexsec::plot::Channels::mc_keys();
 
-    std::vector<int> order;
     std::map<int, std::unique_ptr<TH1D>> sum_by_channel;
     std::vector<std::pair<int, double>> yields;
 
@@ -218,16 +279,6 @@ void rarexsec::plot::StackedHist::build_histograms() {
     }
 
     if (!data_.empty()) {
-        std::vector<ROOT::RDF::RResultPtr<TH1D>> parts;
-        for (size_t ie = 0; ie < data_.size(); ++ie) {
-            const Entry* e = data_[ie];
-            if (!e)
-                continue;
-            auto n0 = selection::apply(e->rnode(), spec_.sel, *e);
-            auto n = (spec_.expr.empty() ? n0 : n0.Define("_rx_expr_", spec_.expr));
-            const std::string var = spec_.expr.empty() ? spec_.id : "_rx_expr_";
-            parts.push_back(n.Histo1D(spec_.model("_data_src" + std::to_string(ie)), var));
-        }
         for (auto& rr : parts) {
             const TH1D& h = rr.GetValue();
             if (!data_hist_) {
@@ -595,8 +646,20 @@ void rarexsec::plot::StackedHist::draw_watermark(TPad* p, double total_mc) const
     watermark.DrawLatex(x, y - 0.06, line3.c_str());
 }
 
-void rarexsec::plot::StackedHist::draw(TCanvas& canvas) {
+void rarexsec::plot::StackedHist::build() {
+    if (built_)
+        return;
     build_histograms();
+    built_ = true;
+}
+
+std::string rarexsec::plot::StackedHist::output_path(const std::string& image_format) const {
+    const std::string fmt = image_format.empty() ? "png" : image_format;
+    return output_directory_ + "/" + plot_name_ + "." + fmt;
+}
+
+void rarexsec::plot::StackedHist::draw(TCanvas& canvas) {
+    build();
     TPad *p_main = nullptr, *p_ratio = nullptr, *p_legend = nullptr;
     setup_pads(canvas, p_main, p_ratio, p_legend);
     double max_y = 1.;
@@ -615,8 +678,5 @@ void rarexsec::plot::StackedHist::draw_and_save(const std::string& image_format)
     std::filesystem::create_directories(output_directory_);
     TCanvas canvas(plot_name_.c_str(), plot_name_.c_str(), 800, 600);
     draw(canvas);
-    const std::string fmt = image_format.empty() ? "png" : image_format;
-    const std::string out = output_directory_ + "/" + plot_name_ + "." + fmt;
-    
-    canvas.SaveAs(out.c_str());
+    canvas.SaveAs(output_path(image_format).c_str());
 }
@@ -6,6 +6,7 @@
 #include "TLegendEntry.h"
 #include "TImage.h"
 #include "TPad.h"
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -14,6 +15,9 @@
 #include "rarexsec/plot/Descriptors.h"
 
 namespace rarexsec {
+namespace exec {
+class Plan;
+}
 namespace plot {
 
 class StackedHist {
@@ -24,13 +28,23 @@ class StackedHist {
                 std::vector<const Entry*> data);
     ~StackedHist() = default;
 
+    // Runs the event loops that fill the stack, total and data; draw() does so if needed.
+    void build();
+    // Declares the plot's expressions to the plan, then books its histograms on the plan's shared
+    // nodes; build() reads them once Plan::run() has filled them.
+    void declare(exec::Plan& plan) const;
+    void book(exec::Plan& plan);
     void draw_and_save(const std::string& image_format);
 
+    const std::string& id() const noexcept { return spec_.id; }
+    std::string output_path(const std::string& image_format) const;
+
   protected:
     void draw(TCanvas& canvas);
 
   private:
     bool want_ratio() const { return opt_.show_ratio && data_hist_ && mc_total_; }
+    void book_histograms(exec::Plan* plan);
     void build_histograms();
     void setup_pads(TCanvas& c, TPad*& p_main, TPad*& p_ratio, TPad*& p_legend) const;
     void draw_stack_and_unc(TPad* p_main, double& max_y);
@@ -52,6 +66,10 @@ class StackedHist {
     std::unique_ptr<TH1D> sig_hist_;
     std::vector<int> chan_order_;
     double signal_scale_ = 1.0;
+    std::map<int, std::vector<ROOT::RDF::RResultPtr<TH1D>>> booked_mc_;
+    std::vector<ROOT::RDF::RResultPtr<TH1D>> booked_data_;
+    bool booked_ = false;
+    bool built_ = false;
     mutable std::unique_ptr<TLegend> legend_;
     mutable std::vector<std::unique_ptr<TH1D>> legend_proxies_;
 };
@@ -15,12 +15,15 @@
 #include <map>
 #include <memory>
 #include <numeric>
+#include <optional>
 #include <sstream>
 #include <stdexcept>
 #include <utility>
 #include <vector>
 
 #include "rarexsec/Hub.h"
+#include "rarexsec/exec/Plan.h"
+#include "rarexsec/io/BranchUsage.h"
 #include "rarexsec/plot/Plotter.h"
 #include "rarexsec/plot/Channels.h"
 #include "rarexsec/proc/Selection.h"
@@ -108,10 +111,26 @@ void rarexsec::plot::UnstackedHist::setup_pads(TCanvas& c, TPad*& p_main, TPad*&
     p_legend->Draw();
 }
 
-void rarexsec::plot::UnstackedHist::build_histograms() {
-    mc_ch_hists_.clear();
-    data_hist_.reset();
-    chan_order_.clear();
+void rarexsec::plot::UnstackedHist::declare(exec::Plan& plan) const {
+    for (const auto* samples : {&mc_, &data_}) {
+        for (const Entry* e : *samples) {
+            if (!e)
+                continue;
+            plan.declare(*e, spec_.expr.empty() ? spec_.id : spec_.expr);
+            if (samples == &mc_)
+                plan.declare(*e, spec_.weight);
+        }
+    }
+}
+
+void rarexsec::plot::UnstackedHist::book(exec::Plan& plan) {
+    book_histograms(&plan);
+}
+
+// Without a plan each plot selects and splits the samples on nodes of its own.
+void rarexsec::plot::UnstackedHist::book_histograms(exec::Plan* plan) {
+    booked_mc_.clear();
+    booked_data_.clear();
 
     constexpr int kBinsPerDecade = 40;
     const std::vector<double> log_edges = make_log_edges(1.0, 1e4, kBinsPerDecade);
@@ -120,29 +139,76 @@ void rarexsec::plot::UnstackedHist::build_histograms() {
         throw std::runtime_error("log-spaced histogram requires at least two bin edges");
     }
 
-    std::map<int, std::vector<ROOT::RDF::RResultPtr<TH1D>>> booked_mc;
     const auto& channels = rarexsec::plot::Channels::mc_keys();
 
+    auto& usage = rarexsec::io::branch_usage();
+    usage.request_expression(spec_.expr.empty() ? spec_.id : spec_.expr);
+    usage.request_expression(spec_.weight);
+    usage.request("analysis_channels");
+
     for (size_t ie = 0; ie < mc_.size(); ++ie) {
         const Entry* e = mc_[ie];
         if (!e)
             continue;
 
-        auto n0 = selection::apply(e->rnode(), spec_.sel, *e);
-        auto n = (spec_.expr.empty() ? n0 : n0.Define("_rx_expr_", spec_.expr));
-        const std::string var = spec_.expr.empty() ? spec_.id : "_rx_expr_";
+        std::optional<ROOT::RDF::RNode> n;
+        std::string var, weight = spec_.weight;
+        if (plan) {
+            var = plan->column(*e, spec_.expr.empty() ? spec_.id : spec_.expr);
+            weight = plan->column(*e, spec_.weight);
+        } else {
+            auto n0 = selection::apply(e->rnode(), spec_.sel, *e);
+            n = (spec_.expr.empty() ? n0 : n0.Define("_rx_expr_", spec_.expr));
+            var = spec_.expr.empty() ? spec_.id : "_rx_expr_";
+        }
 
         for (int ch : channels) {
-            auto nf = n.Filter([ch](int c) { return c == ch; }, {"analysis_channels"});
+            ROOT::RDF::RNode nf = plan ? plan->node(*e, spec_.sel, ch)
+                                       : ROOT::RDF::RNode(n->Filter([ch](int c) { return c == ch; }, {"analysis_channels"}));
             ROOT::RDF::TH1DModel model(
                 (spec_.id + "_mc_ch" + std::to_string(ch) + "_src" + std::to_string(ie)).c_str(),
                 "",
                 nbins,
                 log_edges.data());
-            auto h = nf.Histo1D(model, var, spec_.weight);
-            booked_mc[ch].push_back(h);
+            auto h = nf.Histo1D(model, var, weight);
+            booked_mc_[ch].push_back(h);
+        }
+    }
+
+    for (size_t ie = 0; ie < data_.size(); ++ie) {
+        const Entry* e = data_[ie];
+        if (!e)
+            continue;
+        ROOT::RDF::TH1DModel model((spec_.id + "_data_src" + std::to_string(ie)).c_str(),
+                                   "",
+                                   nbins,
+                                   log_edges.data());
+        if (plan) {
+            const std::string var = plan->column(*e, spec_.expr.empty() ? spec_.id : spec_.expr);
+            booked_data_.push_back(plan->node(*e, spec_.sel).Histo1D(model, var));
+            continue;
         }
+        auto n0 = selection::apply(e->rnode(), spec_.sel, *e);
+        auto n = (spec_.expr.empty() ? n0 : n0.Define("_rx_expr_", spec_.expr));
+        const std::string var = spec_.expr.empty() ? spec_.id : "_rx_expr_";
+        booked_data_.push_back(n.Histo1D(model, var));
     }
+    booked_ = true;
+}
+
+void rarexsec::plot::UnstackedHist::build_histograms() {
+    mc_ch_hists_.clear();
+    data_hist_.reset();
+    chan_order_.clear();
+
+    if (!booked_)
+        book_histograms(nullptr);
+    auto booked_mc = std::move(booked_mc_);
+    auto parts = std::move(booked_data_);
+    booked_mc_.clear();
+    booked_data_.clear();
+    booked_ = false;
+    const auto& channels = rarexsec::plot::Channels::mc_keys();
 
     std::vector<std::pair<int, double>> yields;
     std::map<int, std::unique_ptr<TH1D>> sum_by_channel;
@@ -193,20 +259,6 @@ void rarexsec::plot::UnstackedHist::build_histograms() {
     }
 
     if (!data_.empty()) {
-        std::vector<ROOT::RDF::RResultPtr<TH1D>> parts;
-        for (size_t ie = 0; ie < data_.size(); ++ie) {
-            const Entry* e = data_[ie];
-            if (!e)
-                continue;
-            auto n0 = selection::apply(e->rnode(), spec_.sel, *e);
-            auto n = (spec_.expr.empty() ? n0 : n0.Define("_rx_expr_", spec_.expr));
-            const std::string var = spec_.expr.empty() ? spec_.id : "_rx_expr_";
-            ROOT::RDF::TH1DModel model((spec_.id + "_data_src" + std::to_string(ie)).c_str(),
-                                       "",
-                                       nbins,
-                                       log_edges.data());
-            parts.push_back(n.Histo1D(model, var));
-        }
         for (auto& rr : parts) {
             const TH1D& h = rr.GetValue();
             if (!data_hist_) {
@@ -326,8 +378,20 @@ void rarexsec::plot::UnstackedHist::draw_watermark(TPad* p_main) const {
                      .c_str());
 }
 
-void rarexsec::plot::UnstackedHist::draw(TCanvas& canvas) {
+void rarexsec::plot::UnstackedHist::build() {
+    if (built_)
+        return;
     build_histograms();
+    built_ = true;
+}
+
+std::string rarexsec::plot::UnstackedHist::output_path(const std::string& image_format) const {
+    const std::string fmt = image_format.empty() ? "png" : image_format;
+    return output_directory_ + "/" + plot_name_ + "." + fmt;
+}
+
+void rarexsec::plot::UnstackedHist::draw(TCanvas& canvas) {
+    build();
     TPad *p_main = nullptr, *p_legend = nullptr;
     setup_pads(canvas, p_main, p_legend);
     double max_y = 1.;
@@ -343,6 +407,5 @@ void rarexsec::plot::UnstackedHist::draw_and_save(const std::string& image_forma
     std::filesystem::create_directories(output_directory_);
     TCanvas canvas(plot_name_.c_str(), plot_name_.c_str(), 900, 700);
     draw(canvas);
-    const std::string fmt = image_format.empty() ? "png" : image_format;
-    canvas.SaveAs((output_directory_ + "/" + plot_name_ + "." + fmt).c_str());
+    canvas.SaveAs(output_path(image_format).c_str());
 }
@@ -1,4 +1,7 @@
 #pragma once
+#include <ROOT/RResultPtr.hxx>
+
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -12,6 +15,9 @@ class TH1D;
 
 namespace rarexsec {
 struct Entry;
+namespace exec {
+class Plan;
+}
 namespace plot {
 
 class UnstackedHist {
@@ -23,10 +29,20 @@ class UnstackedHist {
                   bool normalize_to_pdf = true,
                   int line_width = 3);
 
+    // Runs the event loops that fill the curves; draw() does so if needed.
+    void build();
+    // Declares the plot's expressions to the plan, then books its histograms on the plan's shared
+    // nodes; build() reads them once Plan::run() has filled them.
+    void declare(exec::Plan& plan) const;
+    void book(exec::Plan& plan);
     void draw(TCanvas& canvas);
     void draw_and_save(const std::string& image_format = "");
 
+    const std::string& id() const noexcept { return spec_.id; }
+    std::string output_path(const std::string& image_format) const;
+
   private:
+    void book_histograms(exec::Plan* plan);
     void build_histograms();
     void setup_pads(TCanvas& c, TPad*& p_main, TPad*& p_legend) const;
     void draw_curves(TPad* p_main, double& max_y);
@@ -39,6 +55,10 @@ class UnstackedHist {
     std::vector<const Entry*> data_;
     bool normalize_to_pdf_;
     int line_width_;
+    std::map<int, std::vector<ROOT::RDF::RResultPtr<TH1D>>> booked_mc_;
+    std::vector<ROOT::RDF::RResultPtr<TH1D>> booked_data_;
+    bool booked_ = false;
+    bool built_ = false;
 
     std::string plot_name_;
     std::string output_directory_;
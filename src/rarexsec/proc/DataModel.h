@@ -11,6 +11,9 @@
 #include <utility>
 #include <vector>
 
+class TChain;
+class TEntryList;
+
 namespace rarexsec {
 
 enum class Source { Data,
@@ -133,17 +136,26 @@ inline origin from_source_slice(Source src, Slice sl) {
 }
 
 struct Frame {
+    // Entry list and chain behind df when it reads a selected-entry subset; declared first so they
+    // outlive the data frame, and the list ahead of the chain since ~TChain still reads it.
+    std::shared_ptr<TEntryList> entries;
+    std::shared_ptr<TChain> chain;
     std::shared_ptr<ROOT::RDataFrame> df;
     mutable std::optional<ROOT::RDF::RNode> node;
+    // Count booked on df whose partial-result callback signals the start of its first event loop
+    // to the read-ahead scheduler; held so the action stays booked.
+    ROOT::RDF::RResultPtr<ULong64_t> loop_start;
 
     Frame() = default;
     Frame(std::shared_ptr<ROOT::RDataFrame> df_in, ROOT::RDF::RNode node_in)
         : df(std::move(df_in)), node(std::move(node_in)) {}
 
+    // Counts of every named filter booked on the sample, including the per-atom filters of
+    // selection presets applied downstream of node; book it before the event loop runs.
     auto report() const {
-        if (!node)
-            throw std::runtime_error("Frame::report: node is not initialised");
-        return node->Report();
+        if (!df)
+            throw std::runtime_error("Frame::report: data frame is not initialised");
+        return df->Report();
     }
 
     ROOT::RDF::RNode rnode() const {
@@ -160,6 +172,10 @@ struct Entry {
     sample::origin kind = sample::origin::unknown;
     std::vector<std::string> files;
     std::string file;
+    // Recipe truth filter and the truth filters of overlapping samples to remove; when either is
+    // set they replace the slice.
+    std::string truth_filter;
+    std::vector<std::string> exclusion_truth_filters;
 
     double pot_nom = 0.0, pot_eqv = 0.0;
     double trig_nom = 0.0, trig_eqv = 0.0;
@@ -2,17 +2,34 @@
 
 #include <algorithm>
 #include <cstdlib>
+#include <fstream>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
 #include "rarexsec/Hub.h"
+#include "rarexsec/proc/Selection.h"
 
 namespace rarexsec {
 struct Env {
   std::string cfg, beamline;
   std::vector<std::string> periods;
+  // Optional: RAREXSEC_ENTRY_INDEX names a selection preset to restrict every sample to, with
+  // indices kept in RAREXSEC_INDEX_DIR (default: next to the input files).
+  std::string entry_index, index_dir;
+  // Optional: RAREXSEC_SKIM_OVERLAY points at a skim catalogue overlay; the job's columns are
+  // taken from the RAREXSEC_USAGE_LOG entries of RAREXSEC_JOB. RAREXSEC_ALLOW_PRESELECTED=1
+  // also accepts pre-selected skims.
+  std::string skim_overlay, usage_log, job;
+  bool allow_preselected = false;
+  // Optional I/O tuning: RAREXSEC_CACHE_MB, RAREXSEC_CACHE_LEARN (entries), RAREXSEC_PREFETCH=1
+  // and RAREXSEC_READ_AHEAD_MB; see Hub::Options.
+  long long cache_mb = 0, learn_entries = 0, read_ahead_mb = 0;
+  bool prefetch = false;
+  // Optional: RAREXSEC_EXPOSURE=fill|check sums simulation POT from the ntuples, with per-file
+  // totals cached in RAREXSEC_EXPOSURE_CACHE; EXT triggers come from RAREXSEC_BEAM_INDEX.
+  std::string exposure, exposure_cache, beam_index;
   static Env from_env() {
     auto get_env = [](const char* key) {
       const char* value = std::getenv(key);
@@ -38,8 +55,62 @@ struct Env {
     while (ss >> token) {
       env.periods.push_back(token);
     }
+    env.entry_index = get_env("RAREXSEC_ENTRY_INDEX");
+    env.index_dir = get_env("RAREXSEC_INDEX_DIR");
+    env.skim_overlay = get_env("RAREXSEC_SKIM_OVERLAY");
+    env.usage_log = get_env("RAREXSEC_USAGE_LOG");
+    env.job = get_env("RAREXSEC_JOB");
+    env.allow_preselected = get_env("RAREXSEC_ALLOW_PRESELECTED") == "1";
+    auto get_count = [&](const char* key) {
+      const auto value = get_env(key);
+      if (value.empty()) {
+        return 0LL;
+      }
+      try {
+        const long long n = std::stoll(value);
+        if (n >= 0) {
+          return n;
+        }
+      } catch (const std::exception&) {
+      }
+      throw std::runtime_error(std::string(key) + " must be a non-negative integer");
+    };
+    env.cache_mb = get_count("RAREXSEC_CACHE_MB");
+    env.learn_entries = get_count("RAREXSEC_CACHE_LEARN");
+    env.read_ahead_mb = get_count("RAREXSEC_READ_AHEAD_MB");
+    env.prefetch = get_env("RAREXSEC_PREFETCH") == "1";
+    env.exposure = get_env("RAREXSEC_EXPOSURE");
+    if (!env.exposure.empty() && env.exposure != "fill" && env.exposure != "check") {
+      throw std::runtime_error("RAREXSEC_EXPOSURE must be 'fill' or 'check'");
+    }
+    env.exposure_cache = get_env("RAREXSEC_EXPOSURE_CACHE");
+    env.beam_index = get_env("RAREXSEC_BEAM_INDEX");
     return env;
   }
-  Hub make_hub() const { return Hub(cfg); }
+  Hub make_hub() const {
+    Hub::Options opt;
+    if (!entry_index.empty()) {
+      opt.entry_index = selection::preset_from_name(entry_index);
+    }
+    opt.index_dir = index_dir;
+    opt.skim_overlay = skim_overlay;
+    opt.allow_preselected_skims = allow_preselected;
+    opt.cache_bytes = cache_mb << 20;
+    opt.learn_entries = static_cast<int>(learn_entries);
+    opt.prefetch = prefetch;
+    opt.read_ahead_bytes = static_cast<std::size_t>(read_ahead_mb) << 20;
+    if (exposure == "fill") {
+      opt.exposure = Hub::Options::ExposureMode::Fill;
+    } else if (exposure == "check") {
+      opt.exposure = Hub::Options::ExposureMode::Check;
+    }
+    opt.exposure_cache = exposure_cache;
+    opt.beam_index = beam_index;
+    if (!skim_overlay.empty() && !usage_log.empty() && std::ifstream(usage_log)) {
+      const auto cols = io::read_usage_log(usage_log, {job.empty() ? std::string("default") : job});
+      opt.columns.assign(cols.begin(), cols.end());
+    }
+    return Hub(cfg, opt);
+  }
 };
 } // namespace rarexsec
@@ -3,11 +3,19 @@
 #include <ROOT/RVec.hxx>
 #include <RtypesCore.h>
 #include <cstddef>
+#include <cstdint>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "rarexsec/Hub.h"
+#include "rarexsec/io/BranchUsage.h"
 #include "rarexsec/proc/Volume.h"
 
 namespace rarexsec {
@@ -37,66 +45,345 @@ enum class Preset {
     InclusiveMuCC
 };
 
-inline ROOT::RDF::RNode apply(ROOT::RDF::RNode node, Preset p, const Entry& rec) {
+inline const char* preset_name(Preset p) {
     switch (p) {
     case Preset::Empty:
-        return node;
+        return "Empty";
     case Preset::Trigger:
-        return node.Filter([src = rec.source](float pe_beam, float pe_veto, int sw) {
-            const bool requires_dataset_gate = (src == Source::MC);
-            const bool dataset_gate = requires_dataset_gate
-                                          ? (pe_beam > trigger_min_beam_pe &&
-                                             pe_veto < trigger_max_veto_pe &&
-                                             sw > 0)
-                                          : true;
-            return dataset_gate;
-        },
-                           {"optical_filter_pe_beam", "optical_filter_pe_veto", "software_trigger"});
+        return "Trigger";
     case Preset::Slice:
-        return node.Filter([](int ns, float topo) {
-            return ns == slice_required_count &&
-                   topo > slice_min_topology_score;
-        },
-                           {"num_slices", "topological_score"});
+        return "Slice";
     case Preset::Fiducial:
-        return node.Filter([](bool fv) { return fv; },
-                           {"in_reco_fiducial"});
+        return "Fiducial";
     case Preset::Topology:
-        return node.Filter([](float cf, float cl) {
-            return cf >= topology_min_contained_fraction &&
-                   cl >= topology_min_cluster_fraction;
-        },
-                           {"contained_fraction", "slice_cluster_fraction"});
+        return "Topology";
     case Preset::Muon:
-        return node.Filter(
-            [](const ROOT::RVec<float>& scores,
-               const ROOT::RVec<float>& lengths,
-               const ROOT::RVec<float>& distances,
-               const ROOT::RVec<unsigned>& generations) {
-                const auto n = scores.size();
-                for (std::size_t i = 0; i < n; ++i) {
-                    const bool passes = scores[i] > muon_min_track_score &&
-                                        lengths[i] > muon_min_track_length &&
-                                        distances[i] < muon_max_track_distance &&
-                                        generations[i] == muon_required_generation;
-                    if (passes) {
-                        return true;
-                    }
-                }
-                return false;
-            },
-            {"track_shower_scores",
-             "track_length",
-             "track_distance_to_vertex",
-             "pfp_generations"});
+        return "Muon";
     case Preset::InclusiveMuCC:
-    default: {
-        auto filtered = apply(node, Preset::Trigger, rec);
-        filtered = apply(filtered, Preset::Slice, rec);
-        filtered = apply(filtered, Preset::Fiducial, rec);
-        filtered = apply(filtered, Preset::Topology, rec);
-        return apply(filtered, Preset::Muon, rec);
+    default:
+        return "InclusiveMuCC";
+    }
+}
+
+inline Preset preset_from_name(const std::string& name) {
+    for (Preset p : {Preset::Empty, Preset::Trigger, Preset::Slice, Preset::Fiducial, Preset::Topology,
+                     Preset::Muon, Preset::InclusiveMuCC}) {
+        if (name == preset_name(p))
+            return p;
+    }
+    throw std::invalid_argument("unknown selection preset: " + name);
+}
+
+namespace atom {
+
+// Each cut is a small functor: columns() names its inputs, operator() is the predicate and make()
+// binds any per-sample state. The same functors back the single-cut presets, the staged composite
+// presets and the fused filter.
+struct Trigger {
+    static constexpr const char* name = "Trigger";
+    static std::vector<std::string> columns() {
+        return {"optical_filter_pe_beam", "optical_filter_pe_veto", "software_trigger"};
+    }
+    static Trigger make(const Entry& rec) { return Trigger{rec.source}; }
+
+    Source src = Source::MC;
+    bool operator()(float pe_beam, float pe_veto, int sw) const {
+        const bool requires_dataset_gate = (src == Source::MC);
+        const bool dataset_gate = requires_dataset_gate
+                                      ? (pe_beam > trigger_min_beam_pe &&
+                                         pe_veto < trigger_max_veto_pe &&
+                                         sw > 0)
+                                      : true;
+        return dataset_gate;
+    }
+};
+
+struct Slice {
+    static constexpr const char* name = "Slice";
+    static std::vector<std::string> columns() { return {"num_slices", "topological_score"}; }
+    static Slice make(const Entry&) { return Slice{}; }
+
+    bool operator()(int ns, float topo) const {
+        return ns == slice_required_count &&
+               topo > slice_min_topology_score;
+    }
+};
+
+struct Fiducial {
+    static constexpr const char* name = "Fiducial";
+    static std::vector<std::string> columns() { return {"in_reco_fiducial"}; }
+    static Fiducial make(const Entry&) { return Fiducial{}; }
+
+    bool operator()(bool fv) const { return fv; }
+};
+
+struct Topology {
+    static constexpr const char* name = "Topology";
+    static std::vector<std::string> columns() { return {"contained_fraction", "slice_cluster_fraction"}; }
+    static Topology make(const Entry&) { return Topology{}; }
+
+    bool operator()(float cf, float cl) const {
+        return cf >= topology_min_contained_fraction &&
+               cl >= topology_min_cluster_fraction;
+    }
+};
+
+struct Muon {
+    static constexpr const char* name = "Muon";
+    static std::vector<std::string> columns() {
+        return {"track_shower_scores",
+                "track_length",
+                "track_distance_to_vertex",
+                "pfp_generations"};
+    }
+    static Muon make(const Entry&) { return Muon{}; }
+
+    bool operator()(const ROOT::RVec<float>& scores,
+                    const ROOT::RVec<float>& lengths,
+                    const ROOT::RVec<float>& distances,
+                    const ROOT::RVec<unsigned>& generations) const {
+        const auto n = scores.size();
+        for (std::size_t i = 0; i < n; ++i) {
+            const bool passes = scores[i] > muon_min_track_score &&
+                                lengths[i] > muon_min_track_length &&
+                                distances[i] < muon_max_track_distance &&
+                                generations[i] == muon_required_generation;
+            if (passes) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+}
+
+// Unweighted per-atom cutflow of a composite selection: entries reaching it and entries surviving
+// each successive atom, the same numbers RDataFrame's Report() gives for its named atom filters.
+// Counters are per processing slot and only summed when read, so read them after the event loop.
+class Cutflow {
+public:
+    const std::vector<std::string>& names() const { return names_; }
+    std::uint64_t entered() const { return sum_(0); }
+    std::uint64_t passed(std::size_t atom) const { return sum_(atom + 1); }
+
+    void print(std::ostream& os = std::cout) const {
+        const auto flags = os.flags();
+        const auto precision = os.precision();
+        const double all = static_cast<double>(entered());
+        double prev = all;
+        for (std::size_t i = 0; i < names_.size(); ++i) {
+            const double pass = static_cast<double>(passed(i));
+            os << std::left << std::setw(10) << names_[i] << ": pass=" << std::setw(12) << passed(i)
+               << " all=" << std::setw(12) << static_cast<std::uint64_t>(prev)
+               << " -- eff=" << std::fixed << std::setprecision(2) << (prev > 0.0 ? 100.0 * pass / prev : 0.0)
+               << " % cumulative eff=" << (all > 0.0 ? 100.0 * pass / all : 0.0) << " %\n";
+            prev = pass;
+        }
+        os.flags(flags);
+        os.precision(precision);
+        os.flush();
+    }
+
+    // Called when a filter is booked; re-binding to the same atoms keeps accumulating, so one
+    // Cutflow can collect several samples.
+    void bind(const std::vector<std::string>& names, unsigned nslots) {
+        if (names_.empty()) {
+            names_ = names;
+        } else if (names_ != names) {
+            throw std::runtime_error("selection::Cutflow: already bound to a different set of atoms");
+        }
+        stride_ = (names_.size() + 1 + kPad - 1) / kPad * kPad;
+        if (counts_.size() < stride_ * nslots)
+            counts_.resize(stride_ * nslots, 0);
+    }
+
+    void count(unsigned slot, std::size_t stage) { ++counts_[slot * stride_ + stage]; }
+
+private:
+    // one cache line of counters per slot so that threads do not share lines
+    static constexpr std::size_t kPad = 64 / sizeof(std::uint64_t);
+
+    std::uint64_t sum_(std::size_t stage) const {
+        std::uint64_t n = 0;
+        for (std::size_t off = stage; off < counts_.size(); off += stride_)
+            n += counts_[off];
+        return n;
+    }
+
+    std::vector<std::string> names_;
+    std::size_t stride_ = kPad;
+    std::vector<std::uint64_t> counts_;
+};
+
+namespace detail {
+
+template <class F>
+struct call_args;
+template <class C, class R, class... A>
+struct call_args<R (C::*)(A...) const> {
+    using type = std::tuple<std::decay_t<A>...>;
+};
+template <class Atom>
+using atom_args_t = typename call_args<decltype(&Atom::operator())>::type;
+
+template <class... T>
+using tuple_cat_t = decltype(std::tuple_cat(std::declval<T>()...));
+
+// Gives the fused filter one non-template operator() over the concatenated column types, which
+// is what RDataFrame needs to infer the column types of a functor.
+template <class Self, class Args>
+struct FusedCall;
+template <class Self, class... Ts>
+struct FusedCall<Self, std::tuple<Ts...>> {
+    bool operator()(unsigned slot, const Ts&... v) const {
+        return static_cast<const Self&>(*this).eval(slot, std::forward_as_tuple(v...));
     }
+};
+
+// One atom as a slot-aware predicate that also records its stage of a Cutflow: stage 0 counts the
+// entries reaching the selection as well.
+template <class Atom, class Args = atom_args_t<Atom>>
+struct Counted;
+template <class Atom, class... Ts>
+struct Counted<Atom, std::tuple<Ts...>> {
+    Atom atom;
+    std::shared_ptr<Cutflow> flow;
+    std::size_t stage;
+
+    bool operator()(unsigned slot, const Ts&... v) const {
+        if (stage == 0)
+            flow->count(slot, 0);
+        if (!atom(v...))
+            return false;
+        flow->count(slot, stage + 1);
+        return true;
+    }
+};
+
+template <class... Atoms>
+class Fused : public FusedCall<Fused<Atoms...>, tuple_cat_t<atom_args_t<Atoms>...>> {
+public:
+    Fused(std::tuple<Atoms...> atoms, std::shared_ptr<Cutflow> flow)
+        : atoms_(std::move(atoms)), flow_(std::move(flow)) {}
+
+    template <class Tuple>
+    bool eval(unsigned slot, const Tuple& args) const {
+        if (flow_)
+            flow_->count(slot, 0);
+        return step_<0, 0>(slot, args);
+    }
+
+private:
+    template <std::size_t I, std::size_t Off, class Tuple>
+    bool step_(unsigned slot, const Tuple& args) const {
+        if constexpr (I == sizeof...(Atoms)) {
+            return true;
+        } else {
+            using Atom = std::tuple_element_t<I, std::tuple<Atoms...>>;
+            constexpr std::size_t n = std::tuple_size_v<atom_args_t<Atom>>;
+            if (!call_<Off>(std::get<I>(atoms_), args, std::make_index_sequence<n>{}))
+                return false;
+            if (flow_)
+                flow_->count(slot, I + 1);
+            return step_<I + 1, Off + n>(slot, args);
+        }
+    }
+
+    template <std::size_t Off, class Atom, class Tuple, std::size_t... Is>
+    static bool call_(const Atom& atom, const Tuple& args, std::index_sequence<Is...>) {
+        return atom(std::get<Off + Is>(args)...);
+    }
+
+    std::tuple<Atoms...> atoms_;
+    std::shared_ptr<Cutflow> flow_;
+};
+
+// The atoms as one Filter node counting stages 0..n of a Cutflow already bound by the caller.
+template <class... Atoms>
+inline ROOT::RDF::RNode fused_filter(ROOT::RDF::RNode node, const Entry& rec, const std::string& name,
+                                     std::shared_ptr<Cutflow> flow) {
+    std::vector<std::string> columns{"rdfslot_"};
+    for (const auto& cols : {Atoms::columns()...})
+        columns.insert(columns.end(), cols.begin(), cols.end());
+    io::branch_usage().request(columns);
+    Fused<Atoms...> fn(std::make_tuple(Atoms::make(rec)...), std::move(flow));
+    return node.Filter(std::move(fn), columns, name);
+}
+
+}
+
+// One atom as a Filter named after it, so Report() lists it; with the Cutflow of a composite
+// selection it is also counted there as the given stage.
+template <class Atom>
+inline ROOT::RDF::RNode filter(ROOT::RDF::RNode node, const Entry& rec,
+                               const std::shared_ptr<Cutflow>& flow = nullptr, std::size_t stage = 0) {
+    io::branch_usage().request(Atom::columns());
+    if (!flow)
+        return node.Filter(Atom::make(rec), Atom::columns(), Atom::name);
+    std::vector<std::string> columns{"rdfslot_"};
+    const auto cols = Atom::columns();
+    columns.insert(columns.end(), cols.begin(), cols.end());
+    return node.Filter(detail::Counted<Atom>{Atom::make(rec), flow, stage}, columns, Atom::name);
+}
+
+// The atoms as a chain of named Filter nodes, in order. Each node reads its columns only for
+// entries that passed the atoms before it, so cheap early cuts save the reads of later ones, and
+// Report() gives the per-atom counts; a Cutflow records the same counts.
+template <class... Atoms>
+inline ROOT::RDF::RNode staged(ROOT::RDF::RNode node, const Entry& rec, std::shared_ptr<Cutflow> flow = nullptr) {
+    if (flow)
+        flow->bind({Atoms::name...}, node.GetNSlots());
+    std::size_t stage = 0;
+    ((node = filter<Atoms>(node, rec, flow, stage++)), ...);
+    return node;
+}
+
+// All atoms in one named Filter node: one set of column readers and one short-circuiting predicate
+// per entry instead of a chain of nodes. RDataFrame reads every column of a node before calling its
+// predicate, so each entry pays for the columns of all atoms; this suits atoms of cheap scalar
+// columns. With a Cutflow the per-atom survivor counts are recorded.
+template <class... Atoms>
+inline ROOT::RDF::RNode fused(ROOT::RDF::RNode node, const Entry& rec, const std::string& name,
+                              std::shared_ptr<Cutflow> flow = nullptr) {
+    if (flow)
+        flow->bind({Atoms::name...}, node.GetNSlots());
+    return detail::fused_filter<Atoms...>(node, rec, name, std::move(flow));
+}
+
+// InclusiveMuCC as apply() evaluates it: the scalar atoms fused into one node, then Muon as a
+// filter of its own, so its track vectors are only read for entries that passed the others. A
+// Cutflow records all five atoms.
+inline ROOT::RDF::RNode inclusive_mucc(ROOT::RDF::RNode node, const Entry& rec,
+                                       std::shared_ptr<Cutflow> flow = nullptr) {
+    if (flow)
+        flow->bind({atom::Trigger::name, atom::Slice::name, atom::Fiducial::name, atom::Topology::name,
+                    atom::Muon::name},
+                   node.GetNSlots());
+    node = detail::fused_filter<atom::Trigger, atom::Slice, atom::Fiducial, atom::Topology>(
+        node, rec, "Trigger+Slice+Fiducial+Topology", flow);
+    return filter<atom::Muon>(node, rec, flow, 4);
+}
+
+// flow only applies to composite presets.
+inline ROOT::RDF::RNode apply(ROOT::RDF::RNode node, Preset p, const Entry& rec,
+                              std::shared_ptr<Cutflow> flow = nullptr) {
+    switch (p) {
+    case Preset::Empty:
+        return node;
+    case Preset::Trigger:
+        return filter<atom::Trigger>(node, rec);
+    case Preset::Slice:
+        return filter<atom::Slice>(node, rec);
+    case Preset::Fiducial:
+        return filter<atom::Fiducial>(node, rec);
+    case Preset::Topology:
+        return filter<atom::Topology>(node, rec);
+    case Preset::Muon:
+        return filter<atom::Muon>(node, rec);
+    case Preset::InclusiveMuCC:
+    default:
+        return inclusive_mucc(node, rec, std::move(flow));
     }
 }
 
@@ -112,7 +399,7 @@ template <class SignalPredicate>
 inline EvalResult evaluate(const std::vector<const Entry*>& mc,
                            const SignalPredicate& is_signal_truth,
                            Preset final_selection) {
-    auto sumw = [](ROOT::RDF::RNode n){ auto r = n.Sum<float>("w_nominal"); return double(r.GetValue()); };
+    auto sumw = [](ROOT::RDF::RNode n){ auto r = n.Sum<double>("w_nominal"); return r.GetValue(); };
     EvalResult out;
     for (const Entry* rec : mc) {
         ROOT::RDF::RNode base = rec->nominal.rnode();
@@ -1,5 +1,6 @@
 #pragma once
 #include "rarexsec/Hub.h"
+#include "rarexsec/io/BranchUsage.h"
 
 #include <ROOT/RDFHelpers.hxx>
 #include <ROOT/RDataFrame.hxx>
@@ -142,6 +143,7 @@ inline std::vector<std::string> write(const std::vector<const Entry*>& samples,
             continue;
 
         const auto cols = intersect_cols(e->rnode(), opt.columns);
+        io::branch_usage().request(cols);
         const auto treeName = make_tree_name(opt, *e, "");
         snapshot_once(e->rnode(), treeName, cols);
     }
@@ -0,0 +1,162 @@
+#include "rarexsec/syst/Covariance.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+constexpr int kBlock = 64;
+constexpr int kDepth = 256;
+// multiply-adds below which syrk stays on the calling thread: small updates (a few hundred bins,
+// tens of universes) finish faster than a thread can be started
+constexpr double kMinParallelWork = 4.0e6;
+
+void syrk_block(const double* D, int N, int nb, double alpha, double* C,
+                int bi, int bj, std::vector<double>& scratch)
+{
+    const int i0 = bi * kBlock;
+    const int j0 = bj * kBlock;
+    const int ni = std::min(kBlock, nb - i0);
+    const int nj = std::min(kBlock, nb - j0);
+    const bool diag = (bi == bj);
+
+    scratch.assign(2 * kBlock * kBlock + 2 * kBlock * kDepth, 0.0);
+    double* acc = scratch.data();
+    double* comp = acc + kBlock * kBlock;
+    double* at = comp + kBlock * kBlock;
+    double* pj = at + kBlock * kDepth;
+
+    for (int k0 = 0; k0 < N; k0 += kDepth) {
+        const int nk = std::min(kDepth, N - k0);
+        for (int k = 0; k < nk; ++k) {
+            const double* r = D + static_cast<std::size_t>(k0 + k) * nb;
+            for (int i = 0; i < ni; ++i)
+                at[i * kDepth + k] = r[i0 + i];
+            for (int j = 0; j < nj; ++j)
+                pj[k * kBlock + j] = r[j0 + j];
+        }
+        for (int i = 0; i < ni; ++i) {
+            const int js = diag ? i : 0;
+            double* s = acc + i * kBlock;
+            double* c = comp + i * kBlock;
+            const double* a = at + i * kDepth;
+            for (int k = 0; k < nk; ++k) {
+                const double ak = a[k];
+                const double* p = pj + k * kBlock;
+                for (int j = js; j < nj; ++j) {
+                    const double y = ak * p[j] - c[j];
+                    const double t = s[j] + y;
+                    c[j] = (t - s[j]) - y;
+                    s[j] = t;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < ni; ++i) {
+        const int js = diag ? i : 0;
+        double* out = C + static_cast<std::size_t>(i0 + i) * nb + j0;
+        for (int j = js; j < nj; ++j)
+            out[j] += alpha * acc[i * kBlock + j];
+    }
+}
+}
+
+//____________________________________________________________________________
+rarexsec::syst::DeltaMatrix::DeltaMatrix(int ncols, int nrows_hint)
+    : ncols_(std::max(0, ncols))
+{
+    if (nrows_hint > 0)
+        data_.reserve(static_cast<std::size_t>(nrows_hint) * ncols_);
+}
+//____________________________________________________________________________
+double* rarexsec::syst::DeltaMatrix::add_row()
+{
+    data_.resize(data_.size() + ncols_, 0.0);
+    ++nrows_;
+    return data_.data() + static_cast<std::size_t>(nrows_ - 1) * ncols_;
+}
+//____________________________________________________________________________
+void rarexsec::syst::DeltaMatrix::add_diff(const double* a, const double* b)
+{
+    double* r = add_row();
+    for (int i = 0; i < ncols_; ++i)
+        r[i] = a[i] - b[i];
+}
+//____________________________________________________________________________
+void rarexsec::syst::DeltaMatrix::add_diff(const TH1D& a, const TH1D& b)
+{
+    if (a.GetNbinsX() != ncols_ || b.GetNbinsX() != ncols_)
+        throw std::runtime_error("DeltaMatrix::add_diff: bin mismatch");
+    add_diff(bin_contents(a), bin_contents(b));
+}
+//____________________________________________________________________________
+void rarexsec::syst::DeltaMatrix::add_scaled(const double* v, double s)
+{
+    double* r = add_row();
+    for (int i = 0; i < ncols_; ++i)
+        r[i] = s * v[i];
+}
+//____________________________________________________________________________
+void rarexsec::syst::syrk(const double* D, int N, int nb, double alpha, double* C, int nthreads)
+{
+    if (!D || !C || N <= 0 || nb <= 0)
+        return;
+
+    const int nblk = (nb + kBlock - 1) / kBlock;
+    const double work = 0.5 * double(nb) * double(nb) * double(N);
+    if (work < kMinParallelWork || nthreads == 1) {
+        std::vector<double> scratch;
+        for (int bi = 0; bi < nblk; ++bi)
+            for (int bj = bi; bj < nblk; ++bj)
+                syrk_block(D, N, nb, alpha, C, bi, bj, scratch);
+    } else {
+        std::vector<std::pair<int, int>> tasks;
+        tasks.reserve(static_cast<std::size_t>(nblk) * (nblk + 1) / 2);
+        for (int bi = 0; bi < nblk; ++bi)
+            for (int bj = bi; bj < nblk; ++bj)
+                tasks.emplace_back(bi, bj);
+
+        int nt = nthreads > 0 ? nthreads : static_cast<int>(std::thread::hardware_concurrency());
+        nt = std::max(1, std::min<int>(nt, static_cast<int>(tasks.size())));
+
+        std::atomic<std::size_t> next{0};
+        auto worker = [&]() {
+            std::vector<double> scratch;
+            for (std::size_t t = next++; t < tasks.size(); t = next++)
+                syrk_block(D, N, nb, alpha, C, tasks[t].first, tasks[t].second, scratch);
+        };
+        std::vector<std::thread> pool;
+        pool.reserve(nt - 1);
+        for (int t = 1; t < nt; ++t)
+            pool.emplace_back(worker);
+        worker();
+        for (auto& th : pool)
+            th.join();
+    }
+
+    for (int i = 0; i < nb; ++i)
+        for (int j = i + 1; j < nb; ++j)
+            C[static_cast<std::size_t>(j) * nb + i] = C[static_cast<std::size_t>(i) * nb + j];
+}
+//____________________________________________________________________________
+TMatrixDSym rarexsec::syst::covariance_from_deltas(const DeltaMatrix& D, double alpha, int nthreads)
+{
+    TMatrixDSym C(D.cols());
+    if (D.rows() > 0 && D.cols() > 0)
+        syrk(D.data(), D.rows(), D.cols(), alpha, C.GetMatrixArray(), nthreads);
+    return C;
+}
+//____________________________________________________________________________
+void rarexsec::syst::add_covariance_from_deltas(TMatrixDSym& C, const DeltaMatrix& D, double alpha, int nthreads)
+{
+    if (C.GetNrows() != D.cols())
+        throw std::runtime_error("add_covariance_from_deltas: size mismatch");
+    if (D.rows() > 0 && D.cols() > 0)
+        syrk(D.data(), D.rows(), D.cols(), alpha, C.GetMatrixArray(), nthreads);
+}
+//____________________________________________________________________________
@@ -0,0 +1,41 @@
+#pragma once
+#include <TH1D.h>
+#include <TMatrixDSym.h>
+#include <cstddef>
+#include <vector>
+
+namespace rarexsec::syst {
+
+// Row-major [N x nb] matrix of per-universe (or per-variation) bin deltas.
+class DeltaMatrix {
+  public:
+    explicit DeltaMatrix(int ncols, int nrows_hint = 0);
+
+    int rows() const noexcept { return nrows_; }
+    int cols() const noexcept { return ncols_; }
+    const double* data() const noexcept { return data_.data(); }
+    const double* row(int k) const noexcept { return data_.data() + static_cast<std::size_t>(k) * ncols_; }
+
+    double* add_row();
+    void add_diff(const double* a, const double* b);
+    void add_diff(const TH1D& a, const TH1D& b);
+    void add_scaled(const double* v, double s);
+
+  private:
+    int ncols_ = 0;
+    int nrows_ = 0;
+    std::vector<double> data_;
+};
+
+// Bin contents 1..nb of a histogram as a contiguous array (no per-bin virtual calls).
+inline const double* bin_contents(const TH1D& h) { return h.GetArray() + 1; }
+
+// C += alpha * D^T D on a full row-major nb x nb buffer, computed as a cache-blocked,
+// multithreaded symmetric rank-k update with compensated accumulation along N. Updates of fewer
+// than ~4e6 multiply-adds, and nthreads == 1, run serially on the calling thread.
+void syrk(const double* D, int N, int nb, double alpha, double* C, int nthreads = 0);
+
+TMatrixDSym covariance_from_deltas(const DeltaMatrix& D, double alpha, int nthreads = 0);
+void add_covariance_from_deltas(TMatrixDSym& C, const DeltaMatrix& D, double alpha, int nthreads = 0);
+
+}
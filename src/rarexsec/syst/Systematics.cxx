@@ -1,7 +1,10 @@
 #include "rarexsec/syst/Systematics.h"
+#include "rarexsec/syst/Covariance.h"
+#include "rarexsec/io/BranchUsage.h"
 
 #include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <limits>
 #include <map>
 #include <memory>
@@ -28,6 +31,9 @@ ROOT::RDF::RNode with_expr(ROOT::RDF::RNode node, const rarexsec::plot::TH1DMode
 }
 
 static std::string expr_var(const rarexsec::plot::TH1DModel& spec) {
+    auto& usage = rarexsec::io::branch_usage();
+    usage.request_expression(spec.expr.empty() ? spec.id : spec.expr);
+    usage.request_expression(spec.weight);
     if (spec.expr.empty()) {
         if (!spec.id.empty())
             return spec.id;
@@ -38,6 +44,19 @@ static std::string expr_var(const rarexsec::plot::TH1DModel& spec) {
     return expr_column_name(spec);
 }
 
+static void concat_diff(double* out, const TH1D& a, const TH1D& a0, const TH1D& b, const TH1D& b0) {
+    const int nA = a0.GetNbinsX();
+    const int nB = b0.GetNbinsX();
+    const double* pa = rarexsec::syst::bin_contents(a);
+    const double* pa0 = rarexsec::syst::bin_contents(a0);
+    const double* pb = rarexsec::syst::bin_contents(b);
+    const double* pb0 = rarexsec::syst::bin_contents(b0);
+    for (int i = 0; i < nA; ++i)
+        out[i] = pa[i] - pa0[i];
+    for (int j = 0; j < nB; ++j)
+        out[nA + j] = pb[j] - pb0[j];
+}
+
 static std::unique_ptr<TH1D> sum_hists(std::vector<ROOT::RDF::RResultPtr<TH1D>> parts,
                                        const std::string& name) {
     std::unique_ptr<TH1D> total;
@@ -125,49 +144,24 @@ TMatrixDSym rarexsec::syst::mc_stat_covariance(const TH1D& hist) {
 TMatrixDSym rarexsec::syst::sample_covariance(const TH1D& nominal,
                                               const std::vector<std::unique_ptr<TH1D>>& universes) {
     const int nb = nominal.GetNbinsX();
-    std::vector<std::vector<double>> deltas;
-    deltas.reserve(universes.size());
+    DeltaMatrix D(nb, static_cast<int>(universes.size()));
     for (const auto& uptr : universes) {
-        if (!uptr)
-            continue;
-        std::vector<double> diff(nb, 0.0);
-        for (int i = 0; i < nb; ++i) {
-            diff[i] = uptr->GetBinContent(i + 1) - nominal.GetBinContent(i + 1);
-        }
-        deltas.emplace_back(std::move(diff));
+        if (uptr)
+            D.add_diff(*uptr, nominal);
     }
-    const int N = static_cast<int>(deltas.size());
-    TMatrixDSym C(nb);
+    const int N = D.rows();
     if (N <= 1)
-        return C;
-    for (int i = 0; i < nb; ++i) {
-        for (int j = i; j < nb; ++j) {
-            long double s = 0.0L;
-            for (const auto& diff : deltas)
-                s += static_cast<long double>(diff[i]) * diff[j];
-            const double cij = static_cast<double>(s / (N - 1));
-            C(i, j) = C(j, i) = cij;
-        }
-    }
-    return C;
+        return TMatrixDSym(nb);
+    return covariance_from_deltas(D, 1.0 / (N - 1));
 }
 
 TMatrixDSym rarexsec::syst::hessian_covariance(const TH1D& nominal,
                                                const TH1D& up,
                                                const TH1D& down) {
-    const int nb = nominal.GetNbinsX();
-    TMatrixDSym C(nb);
-    for (int i = 0; i < nb; ++i) {
-        const double dpi = up.GetBinContent(i + 1) - nominal.GetBinContent(i + 1);
-        const double dmi = down.GetBinContent(i + 1) - nominal.GetBinContent(i + 1);
-        for (int j = i; j < nb; ++j) {
-            const double dpj = up.GetBinContent(j + 1) - nominal.GetBinContent(j + 1);
-            const double dmj = down.GetBinContent(j + 1) - nominal.GetBinContent(j + 1);
-            const double cij = 0.5 * (dpi * dpj + dmi * dmj);
-            C(i, j) = C(j, i) = cij;
-        }
-    }
-    return C;
+    DeltaMatrix D(nominal.GetNbinsX(), 2);
+    D.add_diff(up, nominal);
+    D.add_diff(down, nominal);
+    return covariance_from_deltas(D, 0.5);
 }
 
 TMatrixDSym rarexsec::syst::sum(const std::vector<const TMatrixDSym*>& pieces) {
@@ -196,6 +190,7 @@ std::unique_ptr<TH1D> rarexsec::syst::make_total_mc_hist_weight_universe_ushort(
     const std::string& weights_branch, int k, const std::string& suffix,
     const std::string& cv_branch, double us_scale) {
 
+    rarexsec::io::branch_usage().request({weights_branch, cv_branch});
     TH1::SetDefaultSumw2(true);
     std::vector<ROOT::RDF::RResultPtr<TH1D>> parts;
     parts.reserve(mc.size());
@@ -265,6 +260,7 @@ std::unique_ptr<TH1D> rarexsec::syst::make_total_mc_hist_weight_universe_map(
     const std::string& map_branch, const std::string& key, int k,
     const std::string& suffix, const std::string& cv_branch) {
 
+    rarexsec::io::branch_usage().request({map_branch, cv_branch});
     TH1::SetDefaultSumw2(true);
     std::vector<ROOT::RDF::RResultPtr<TH1D>> parts;
     parts.reserve(mc.size());
@@ -341,9 +337,7 @@ TMatrixDSym rarexsec::syst::cov_from_detvar_pairs(
     if (!H0)
         throw std::runtime_error("cov_from_detvar_pairs: failed to build nominal histogram");
 
-    const int nb = H0->GetNbinsX();
-    TMatrixDSym C(nb);
-
+    DeltaMatrix D(H0->GetNbinsX(), 2 * static_cast<int>(tag_pairs.size()));
     for (const auto& pr : tag_pairs) {
         const auto& up = pr.first;
         const auto& down = pr.second;
@@ -353,9 +347,10 @@ TMatrixDSym rarexsec::syst::cov_from_detvar_pairs(
             throw std::runtime_error(
                 "cov_from_detvar_pairs: missing detvar hist for tags '" + up + "', '" + down + "'");
         }
-        C += rarexsec::syst::hessian_covariance(*H0, *Hup, *Hdown);
+        D.add_diff(*Hup, *H0);
+        D.add_diff(*Hdown, *H0);
     }
-    return C;
+    return covariance_from_deltas(D, 0.5);
 }
 
 TMatrixDSym rarexsec::syst::cov_from_detvar_unisims(
@@ -397,24 +392,13 @@ TMatrixDSym rarexsec::syst::block_cov_from_weight_vector_ushort_scaled(
         return C;
 
     const int ddof = RAREXSEC_MULTISIM_DDOF;
+    DeltaMatrix D(nA + nB, nuniv);
     for (int k = 0; k < nuniv; ++k) {
         auto Au = rarexsec::syst::make_total_mc_hist_weight_universe_ushort(specA, A, weights_branch, k, "_A", cv_branch, us_scale);
         auto Bu = rarexsec::syst::make_total_mc_hist_weight_universe_ushort(specB, B, weights_branch, k, "_B", cv_branch, us_scale);
-
-        std::vector<double> d(nA + nB);
-        for (int i = 0; i < nA; ++i)
-            d[i] = Au->GetBinContent(i + 1) - H0A->GetBinContent(i + 1);
-        for (int j = 0; j < nB; ++j)
-            d[nA + j] = Bu->GetBinContent(j + 1) - H0B->GetBinContent(j + 1);
-
-        for (int p = 0; p < nA + nB; ++p)
-            for (int q = p; q < nA + nB; ++q)
-                C(p, q) += d[p] * d[q];
+        concat_diff(D.add_row(), *Au, *H0A, *Bu, *H0B);
     }
-    C *= 1.0 / std::max(1, nuniv - ddof);
-    for (int i = 0; i < nA + nB; ++i)
-        for (int j = i + 1; j < nA + nB; ++j)
-            C(i, j) = C(j, i) = 0.5 * (C(i, j) + C(j, i));
+    add_covariance_from_deltas(C, D, 1.0 / std::max(1, nuniv - ddof));
     return C;
 }
 
@@ -433,24 +417,13 @@ TMatrixDSym rarexsec::syst::block_cov_from_map_weight_vector(
         return C;
 
     const int ddof = RAREXSEC_MULTISIM_DDOF;
+    DeltaMatrix D(nA + nB, nuniv);
     for (int k = 0; k < nuniv; ++k) {
         auto Au = rarexsec::syst::make_total_mc_hist_weight_universe_map(specA, A, map_branch, key, k, "_A", cv_branch);
         auto Bu = rarexsec::syst::make_total_mc_hist_weight_universe_map(specB, B, map_branch, key, k, "_B", cv_branch);
-
-        std::vector<double> d(nA + nB);
-        for (int i = 0; i < nA; ++i)
-            d[i] = Au->GetBinContent(i + 1) - H0A->GetBinContent(i + 1);
-        for (int j = 0; j < nB; ++j)
-            d[nA + j] = Bu->GetBinContent(j + 1) - H0B->GetBinContent(j + 1);
-
-        for (int p = 0; p < nA + nB; ++p)
-            for (int q = p; q < nA + nB; ++q)
-                C(p, q) += d[p] * d[q];
+        concat_diff(D.add_row(), *Au, *H0A, *Bu, *H0B);
     }
-    C *= 1.0 / std::max(1, nuniv - ddof);
-    for (int i = 0; i < nA + nB; ++i)
-        for (int j = i + 1; j < nA + nB; ++j)
-            C(i, j) = C(j, i) = 0.5 * (C(i, j) + C(j, i));
+    add_covariance_from_deltas(C, D, 1.0 / std::max(1, nuniv - ddof));
     return C;
 }
 
@@ -460,6 +433,7 @@ TMatrixDSym rarexsec::syst::block_cov_from_ud_ushort(
     const std::string& up_branch, const std::string& dn_branch, int knob_index,
     double us_scale, const std::string& cv_branch) {
 
+    rarexsec::io::branch_usage().request({up_branch, dn_branch, cv_branch});
     auto H0A = rarexsec::syst::make_total_mc_hist(specA, A, "_A_nom");
     auto H0B = rarexsec::syst::make_total_mc_hist(specB, B, "_B_nom");
     if (!H0A || !H0B)
@@ -514,22 +488,11 @@ TMatrixDSym rarexsec::syst::block_cov_from_ud_ushort(
     const int nA = H0A->GetNbinsX();
     const int nB = H0B->GetNbinsX();
     TMatrixDSym C(nA + nB);
-    auto hess_cat = [&](const TH1D& H0, const TH1D& Hup, const TH1D& Hdn, int off) {
-        const int nb = H0.GetNbinsX();
-        for (int i = 1; i <= nb; ++i) {
-            const double dpi = Hup.GetBinContent(i) - H0.GetBinContent(i);
-            const double dmi = Hdn.GetBinContent(i) - H0.GetBinContent(i);
-            for (int j = i; j <= nb; ++j) {
-                const double dpj = Hup.GetBinContent(j) - H0.GetBinContent(j);
-                const double dmj = Hdn.GetBinContent(j) - H0.GetBinContent(j);
-                const double cij = 0.5 * (dpi * dpj + dmi * dmj);
-                C(off + i - 1, off + j - 1) += cij;
-                C(off + j - 1, off + i - 1) += cij;
-            }
-        }
-    };
-    hess_cat(*H0A, *HupA, *HdnA, 0);
-    hess_cat(*H0B, *HupB, *HdnB, nA);
+    // one hessian_covariance block per channel. The per-bin loop this replaced added each diagonal
+    // term twice, so variances here are half what earlier versions returned; the off-diagonal
+    // terms, and every other hessian_covariance user, are unchanged
+    C.SetSub(0, rarexsec::syst::hessian_covariance(*H0A, *HupA, *HdnA));
+    C.SetSub(nA, rarexsec::syst::hessian_covariance(*H0B, *HupB, *HdnB));
     return C;
 }
 
@@ -548,7 +511,7 @@ TMatrixDSym rarexsec::syst::block_cov_from_detvar_pairs(
 
     const int nA = H0A->GetNbinsX();
     const int nB = H0B->GetNbinsX();
-    TMatrixDSym C(nA + nB);
+    DeltaMatrix D(nA + nB, 2 * static_cast<int>(tag_pairs.size()));
 
     for (const auto& pr : tag_pairs) {
         const auto& up = pr.first;
@@ -562,25 +525,10 @@ TMatrixDSym rarexsec::syst::block_cov_from_detvar_pairs(
             throw std::runtime_error(
                 "block_cov_from_detvar_pairs: missing detvar hist(s) for tags '" + up + "', '" + down + "'");
         }
-
-        std::vector<double> dplus(nA + nB), dminus(nA + nB);
-        for (int i = 0; i < nA; ++i) {
-            dplus[i] = HupA->GetBinContent(i + 1) - H0A->GetBinContent(i + 1);
-            dminus[i] = HdnA->GetBinContent(i + 1) - H0A->GetBinContent(i + 1);
-        }
-        for (int j = 0; j < nB; ++j) {
-            dplus[nA + j] = HupB->GetBinContent(j + 1) - H0B->GetBinContent(j + 1);
-            dminus[nA + j] = HdnB->GetBinContent(j + 1) - H0B->GetBinContent(j + 1);
-        }
-
-        for (int p = 0; p < nA + nB; ++p) {
-            for (int q = p; q < nA + nB; ++q) {
-                const double add = 0.5 * (dplus[p] * dplus[q] + dminus[p] * dminus[q]);
-                C(p, q) = C(q, p) = C(p, q) + add;
-            }
-        }
+        concat_diff(D.add_row(), *HupA, *H0A, *HupB, *H0B);
+        concat_diff(D.add_row(), *HdnA, *H0A, *HdnB, *H0B);
     }
-    return C;
+    return covariance_from_deltas(D, 0.5);
 }
 
 TMatrixDSym rarexsec::syst::block_diag_stat(const TH1D& A, const TH1D& B) {
@@ -601,18 +549,11 @@ TMatrixDSym rarexsec::syst::block_diag_stat(const TH1D& A, const TH1D& B) {
 TMatrixDSym rarexsec::syst::pot_cov_block(const TH1D& A, const TH1D& B, double frac_pot) {
     const int nA = A.GetNbinsX();
     const int nB = B.GetNbinsX();
-    const int n = nA + nB;
-    std::vector<double> v(n);
-    for (int i = 1; i <= nA; ++i)
-        v[i - 1] = A.GetBinContent(i);
-    for (int j = 1; j <= nB; ++j)
-        v[nA + j - 1] = B.GetBinContent(j);
-    TMatrixDSym C(n);
-    const double s2 = frac_pot * frac_pot;
-    for (int p = 0; p < n; ++p)
-        for (int q = p; q < n; ++q)
-            C(p, q) = C(q, p) = s2 * v[p] * v[q];
-    return C;
+    DeltaMatrix D(nA + nB, 1);
+    double* v = D.add_row();
+    std::copy_n(bin_contents(A), nA, v);
+    std::copy_n(bin_contents(B), nB, v + nA);
+    return covariance_from_deltas(D, frac_pot * frac_pot);
 }
 
 std::unique_ptr<TH1D> rarexsec::syst::sum_same_binning(const TH1D& A, const TH1D& B, const std::string& name) {
@@ -639,16 +580,15 @@ TMatrixDSym rarexsec::syst::sum_covariance_block_same_binning(const TMatrixDSym&
     if (nB != nA)
         throw std::runtime_error("sum_covariance_block_same_binning: A and B must have the same binning");
 
+    const int ld = nA + nB;
+    const double* src = C_block.GetMatrixArray();
     TMatrixDSym Csum(n);
+    double* out = Csum.GetMatrixArray();
     for (int i = 0; i < n; ++i) {
-        for (int j = i; j < n; ++j) {
-            double cij =
-                C_block(i, j) +
-                C_block(i, nA + j) +
-                C_block(nA + i, j) +
-                C_block(nA + i, nA + j);
-            Csum(i, j) = Csum(j, i) = cij;
-        }
+        const double* r0 = src + static_cast<std::size_t>(i) * ld;
+        const double* r1 = src + static_cast<std::size_t>(nA + i) * ld;
+        for (int j = 0; j < n; ++j)
+            out[static_cast<std::size_t>(i) * n + j] = r0[j] + r0[nA + j] + r1[j] + r1[nA + j];
     }
     return Csum;
 }
@@ -72,6 +72,8 @@ TMatrixDSym block_cov_from_map_weight_vector(
     const std::string& map_branch, const std::string& key, int nuniv,
     const std::string& cv_branch = "");
 
+// Block-diagonal (A, B) up/down covariance, 0.5 (du du^T + dd dd^T) per channel. Before the
+// syst:: kernels were blocked this doubled the diagonal, unlike hessian_covariance.
 TMatrixDSym block_cov_from_ud_ushort(
     const plot::TH1DModel& specA, const std::vector<const Entry*>& A,
     const plot::TH1DModel& specB, const std::vector<const Entry*>& B,
@@ -3,8 +3,10 @@
 #include <ROOT/RDataFrame.hxx>
 #include <ROOT/RVec.hxx>
 #include <cmath>
+#include <sstream>
 #include <stdexcept>
 
+#include "rarexsec/io/BranchUsage.h"
 #include "rarexsec/proc/DataModel.h"
 #include "rarexsec/syst/Systematics.h"
 
@@ -18,77 +20,103 @@ std::unique_ptr<TH1D> clone_reset_like(const TH1D& templ, const std::string& nam
   return h;
 }
 //_______________________________________________________________________________________
-std::unique_ptr<TH1D> sum_parts(std::vector<ROOT::RDF::RResultPtr<TH1D>>& parts,
-                                const TH1D& model, const std::string& name) 
+using Booked = std::vector<ROOT::RDF::RResultPtr<TH1D>>;
+//_______________________________________________________________________________________
+void add_parts(exec::Partial& out, const std::string& name, Booked& parts)
 {
-  std::unique_ptr<TH1D> total;
-  for (auto& rr : parts) {
-    const TH1D& h = rr.GetValue();
-    if (!total) {
-      total.reset(static_cast<TH1D*>(h.Clone(name.c_str())));
-      total->SetDirectory(nullptr);
-    } else {
-      total->Add(&h);
-    }
-  }
-  if (!total) return clone_reset_like(model, name);
-  return total;
+  for (auto& rr : parts) out.add(name, rr.GetValue());
 }
 //_______________________________________________________________________________________
-std::unique_ptr<TH1D> make_total_hist(const TH1D& model,
-                                      const std::string& value_col,
-                                      const std::string& weight_col,
-                                      const std::vector<const rarexsec::Entry*>& entries,
-                                      const std::string& name_suffix) 
+Booked book_total_hist(const TH1D& model,
+                       const std::string& value_col,
+                       const std::string& weight_col,
+                       const std::vector<const rarexsec::Entry*>& entries)
 {
-  std::vector<ROOT::RDF::RResultPtr<TH1D>> parts;
+  Booked parts;
   parts.reserve(entries.size());
+  rarexsec::io::branch_usage().request({value_col, weight_col});
   for (auto* e : entries) {
     if (!e) continue;
     auto node = e->rnode();
     parts.emplace_back(node.Histo1D(model, value_col, weight_col));
   }
-  return sum_parts(parts, model, std::string(model.GetName()) + name_suffix);
+  return parts;
+}
+//_______________________________________________________________________________________
+std::string universe_column(const std::string& weights_branch, const std::string& cv_branch,
+                            const std::string& base_weight_col, int k)
+{
+  std::string col = "_rx_univ_" + weights_branch + "_" + std::to_string(k) + "__" + base_weight_col;
+  if (!cv_branch.empty()) col += "__" + cv_branch;
+  return col;
+}
+//_______________________________________________________________________________________
+ROOT::RDF::RNode define_universe(ROOT::RDF::RNode node,
+                                 const std::string& base_weight_col,
+                                 const std::string& weights_branch,
+                                 int k,
+                                 double us_scale,
+                                 const std::string& cv_branch)
+{
+  const std::string col = universe_column(weights_branch, cv_branch, base_weight_col, k);
+  if (node.HasColumn(col)) return node;
+  if (cv_branch.empty())
+    return node.Define(col,
+      [k, us_scale](const ROOT::RVec<unsigned short>& v, double w_nom) {
+        double wk = 1.0;
+        if (k >= 0 && k < (int)v.size()) wk = static_cast<double>(v[k]) * us_scale;
+        const double out = w_nom * wk;
+        return (std::isfinite(out) && out > 0.0) ? out : 0.0;
+      }, {weights_branch, base_weight_col});
+  return node.Define(col,
+    [k, us_scale](const ROOT::RVec<unsigned short>& v, double w_nom, double w_cv) {
+      double wk = 1.0;
+      if (k >= 0 && k < (int)v.size()) wk = static_cast<double>(v[k]) * us_scale;
+      const double out = w_nom * w_cv * wk;
+      return (std::isfinite(out) && out > 0.0) ? out : 0.0;
+    }, {weights_branch, base_weight_col, cv_branch});
 }
 //_______________________________________________________________________________________
-std::unique_ptr<TH1D> make_total_hist_universe_ushort(const TH1D& model,
-                                                      const std::string& value_col,
-                                                      const std::string& base_weight_col,
-                                                      const std::vector<const rarexsec::Entry*>& entries,
-                                                      const std::string& weights_branch,
-                                                      int k,
-                                                      double us_scale,
-                                                      const std::string& cv_branch,
-                                                      const std::string& name_suffix) 
+// A universe weight already defined upstream (see SystematicsPack::define_universes) is reused.
+Booked book_total_hist_universe_ushort(const TH1D& model,
+                                       const std::string& value_col,
+                                       const std::string& base_weight_col,
+                                       const std::vector<const rarexsec::Entry*>& entries,
+                                       const std::string& weights_branch,
+                                       int k,
+                                       double us_scale,
+                                       const std::string& cv_branch)
 {
-  std::vector<ROOT::RDF::RResultPtr<TH1D>> parts;
+  Booked parts;
   parts.reserve(entries.size());
-  for (size_t ie = 0; ie < entries.size(); ++ie) {
-    auto* e = entries[ie];
+  rarexsec::io::branch_usage().request({value_col, base_weight_col, weights_branch, cv_branch});
+  const std::string col = universe_column(weights_branch, cv_branch, base_weight_col, k);
+  for (auto* e : entries) {
     if (!e) continue;
-    auto node = e->rnode();
-    const std::string col = "_rx_univ_" + std::to_string(k) + "_src" + std::to_string(ie);
-    if (cv_branch.empty()) {
-      auto n1 = node.Define(col,
-        [k, us_scale](const ROOT::RVec<unsigned short>& v, double w_nom) {
-          double wk = 1.0;
-          if (k >= 0 && k < (int)v.size()) wk = static_cast<double>(v[k]) * us_scale;
-          const double out = w_nom * wk;
-          return (std::isfinite(out) && out > 0.0) ? out : 0.0;
-        }, {weights_branch, base_weight_col});
-      parts.emplace_back(n1.Histo1D(model, value_col, col));
-    } else {
-      auto n1 = node.Define(col,
-        [k, us_scale](const ROOT::RVec<unsigned short>& v, double w_nom, double w_cv) {
-          double wk = 1.0;
-          if (k >= 0 && k < (int)v.size()) wk = static_cast<double>(v[k]) * us_scale;
-          const double out = w_nom * w_cv * wk;
-          return (std::isfinite(out) && out > 0.0) ? out : 0.0;
-        }, {weights_branch, base_weight_col, cv_branch});
-      parts.emplace_back(n1.Histo1D(model, value_col, col));
-    }
+    auto n1 = define_universe(e->rnode(), base_weight_col, weights_branch, k, us_scale, cv_branch);
+    parts.emplace_back(n1.Histo1D(model, value_col, col));
   }
-  return sum_parts(parts, model, std::string(model.GetName()) + name_suffix);
+  return parts;
+}
+//_______________________________________________________________________________________
+std::unique_ptr<TH1D> total_or_empty(const exec::Partial& totals, const std::string& key,
+                                     const TH1D& model, const std::string& name)
+{
+  if (!totals.has_hist(key)) return clone_reset_like(model, name);
+  auto h = std::unique_ptr<TH1D>(static_cast<TH1D*>(totals.hist(key).Clone(name.c_str())));
+  h->SetDirectory(nullptr);
+  return h;
+}
+//_______________________________________________________________________________________
+std::vector<std::unique_ptr<TH1D>> universes(const exec::Partial& totals, const TH1D& model,
+                                             const std::string& source, int n)
+{
+  std::vector<std::unique_ptr<TH1D>> out;
+  out.reserve(n);
+  for (int k = 0; k < n; ++k)
+    out.emplace_back(total_or_empty(totals, source + "/" + std::to_string(k), model,
+                                    std::string(model.GetName()) + "_" + source + "_u" + std::to_string(k)));
+  return out;
 }
 } 
 //_______________________________________________________________________________________
@@ -97,6 +125,120 @@ SystematicsPack::SystematicsPack(Config cfg) : cfg_(std::move(cfg)) {}
 Result SystematicsPack::build(const TH1D& model,
                               const std::vector<const rarexsec::Entry*>& mc_entries,
                               const std::vector<const rarexsec::Entry*>& ext_entries) const 
+{
+  exec::Partial totals;
+  fill(model, mc_entries, ext_entries, totals);
+  return assemble(model, totals);
+}
+//_______________________________________________________________________________________
+Result SystematicsPack::build(const rarexsec::Hub& hub,
+                              const TH1D& model,
+                              const std::vector<const rarexsec::Entry*>& mc_entries,
+                              const std::vector<const rarexsec::Entry*>& ext_entries,
+                              const exec::ShardOptions& opt) const 
+{
+  std::vector<const rarexsec::Entry*> entries = mc_entries;
+  if (cfg_.include_ext) entries.insert(entries.end(), ext_entries.begin(), ext_entries.end());
+  const std::size_t n_mc = mc_entries.size();
+  auto totals = exec::run_sharded(hub, entries,
+    [this, &model, n_mc](const std::vector<const rarexsec::Entry*>& view, exec::Partial& out) {
+      const std::vector<const rarexsec::Entry*> mc(view.begin(), view.begin() + n_mc);
+      const std::vector<const rarexsec::Entry*> ext(view.begin() + n_mc, view.end());
+      fill(model, mc, ext, out);
+    }, opt);
+  return assemble(model, totals);
+}
+//_______________________________________________________________________________________
+Result SystematicsPack::build_incremental(const rarexsec::Hub& hub,
+                                          const TH1D& model,
+                                          const std::vector<const rarexsec::Entry*>& mc_entries,
+                                          const std::vector<const rarexsec::Entry*>& ext_entries,
+                                          const std::string& store_dir,
+                                          exec::IncrementalStats* stats) const 
+{
+  std::vector<const rarexsec::Entry*> entries = mc_entries;
+  if (cfg_.include_ext) entries.insert(entries.end(), ext_entries.begin(), ext_entries.end());
+  const std::size_t n_mc = mc_entries.size();
+  auto totals = exec::run_incremental(hub, entries, job_key(model),
+    [this, &model, n_mc](const std::vector<const rarexsec::Entry*>& view, exec::Partial& out) {
+      const std::vector<const rarexsec::Entry*> mc(view.begin(), view.begin() + n_mc);
+      const std::vector<const rarexsec::Entry*> ext(view.begin() + n_mc, view.end());
+      fill(model, mc, ext, out);
+    }, store_dir, stats);
+  return assemble(model, totals);
+}
+//_______________________________________________________________________________________
+std::string SystematicsPack::job_key(const TH1D& model) const 
+{
+  std::ostringstream os;
+  os << std::hexfloat << "systpack/" << model.GetName() << '/' << cfg_.value_col << '/' << cfg_.weight_col << '/'
+     << cfg_.include_ext << '/' << cfg_.ushort_scale;
+  if (cfg_.use_ppfx) os << "/ppfx:" << cfg_.N_ppfx << ':' << cfg_.ppfx_branch << ':' << cfg_.ppfx_cv_branch;
+  if (cfg_.use_genie) os << "/genie:" << cfg_.N_genie << ':' << cfg_.genie_branch << ':' << cfg_.genie_cv_branch;
+  if (cfg_.use_reint) os << "/reint:" << cfg_.N_reint << ':' << cfg_.reint_branch;
+  os << "/edges";
+  for (int i = 1; i <= model.GetNbinsX() + 1; ++i) os << ' ' << model.GetXaxis()->GetBinLowEdge(i);
+  return os.str();
+}
+//_______________________________________________________________________________________
+SystematicsPack::Booking SystematicsPack::book(const TH1D& model,
+                                               const std::vector<const rarexsec::Entry*>& mc_entries,
+                                               const std::vector<const rarexsec::Entry*>& ext_entries) const
+{
+  Booking out;
+  out.parts.emplace_back("mc", book_total_hist(model, cfg_.value_col, cfg_.weight_col, mc_entries));
+  for (const auto& src : sources()) {
+    if (!src.use) continue;
+    for (int k = 0; k < src.n; ++k)
+      out.parts.emplace_back(std::string(src.key) + "/" + std::to_string(k),
+                             book_total_hist_universe_ushort(model, cfg_.value_col, cfg_.weight_col,
+                                                             mc_entries, src.branch, k,
+                                                             cfg_.ushort_scale, src.cv));
+  }
+  if (cfg_.include_ext)
+    out.parts.emplace_back("ext", book_total_hist(model, cfg_.value_col, cfg_.weight_col, ext_entries));
+  return out;
+}
+//_______________________________________________________________________________________
+Result SystematicsPack::finish(const TH1D& model, Booking& booking) const
+{
+  exec::Partial totals;
+  for (auto& [key, parts] : booking.parts) add_parts(totals, key, parts);
+  booking.parts.clear();
+  return assemble(model, totals);
+}
+//_______________________________________________________________________________________
+ROOT::RDF::RNode SystematicsPack::define_universes(ROOT::RDF::RNode node) const
+{
+  for (const auto& src : sources()) {
+    if (!src.use) continue;
+    for (int k = 0; k < src.n; ++k)
+      node = define_universe(node, cfg_.weight_col, src.branch, k, cfg_.ushort_scale, src.cv);
+  }
+  return node;
+}
+//_______________________________________________________________________________________
+std::vector<SystematicsPack::Source> SystematicsPack::sources() const
+{
+  static const std::string no_cv;
+  return {
+    {cfg_.use_ppfx, cfg_.N_ppfx, cfg_.ppfx_branch, cfg_.ppfx_cv_branch, "ppfx"},
+    {cfg_.use_genie, cfg_.N_genie, cfg_.genie_branch, cfg_.genie_cv_branch, "genie"},
+    {cfg_.use_reint, cfg_.N_reint, cfg_.reint_branch, no_cv, "reint"},
+  };
+}
+//_______________________________________________________________________________________
+void SystematicsPack::fill(const TH1D& model,
+                           const std::vector<const rarexsec::Entry*>& mc_entries,
+                           const std::vector<const rarexsec::Entry*>& ext_entries,
+                           exec::Partial& out) const
+{
+  // everything is booked before the first result is read, so each sample is looped over once
+  auto booking = book(model, mc_entries, ext_entries);
+  for (auto& [key, parts] : booking.parts) add_parts(out, key, parts);
+}
+//_______________________________________________________________________________________
+Result SystematicsPack::assemble(const TH1D& model, const exec::Partial& totals) const 
 {
   using rarexsec::syst::mc_stat_covariance;
   using rarexsec::syst::sample_covariance;
@@ -104,58 +246,24 @@ Result SystematicsPack::build(const TH1D& model,
 
   Result out;
 
-  auto H_mc = make_total_hist(model, cfg_.value_col, cfg_.weight_col, mc_entries, "_mc");
-  if (!H_mc) throw std::runtime_error("SystematicsPack: MC nominal is empty");
+  auto H_mc = total_or_empty(totals, "mc", model, std::string(model.GetName()) + "_mc");
 
   out.sources["MC stat"] = mc_stat_covariance(*H_mc);
 
-  if (cfg_.use_ppfx && cfg_.N_ppfx > 0) {
-    std::vector<std::unique_ptr<TH1D>> universes;
-    universes.reserve(cfg_.N_ppfx);
-    for (int k = 0; k < cfg_.N_ppfx; ++k) {
-      universes.emplace_back(
-        make_total_hist_universe_ushort(model, cfg_.value_col, cfg_.weight_col,
-                                        mc_entries, cfg_.ppfx_branch, k,
-                                        cfg_.ushort_scale, cfg_.ppfx_cv_branch,
-                                        "_ppfx_u" + std::to_string(k)));
-    }
-    out.sources["Flux (PPFX)"] = sample_covariance(*H_mc, universes);
-  }
-
-  if (cfg_.use_genie && cfg_.N_genie > 0) {
-    std::vector<std::unique_ptr<TH1D>> universes;
-    universes.reserve(cfg_.N_genie);
-    for (int k = 0; k < cfg_.N_genie; ++k) {
-      universes.emplace_back(
-        make_total_hist_universe_ushort(model, cfg_.value_col, cfg_.weight_col,
-                                        mc_entries, cfg_.genie_branch, k,
-                                        cfg_.ushort_scale, cfg_.genie_cv_branch,
-                                        "_genie_u" + std::to_string(k)));
-    }
-    out.sources["GENIE"] = sample_covariance(*H_mc, universes);
-  }
-
-  if (cfg_.use_reint && cfg_.N_reint > 0) {
-    std::vector<std::unique_ptr<TH1D>> universes;
-    universes.reserve(cfg_.N_reint);
-    for (int k = 0; k < cfg_.N_reint; ++k) {
-      universes.emplace_back(
-        make_total_hist_universe_ushort(model, cfg_.value_col, cfg_.weight_col,
-                                        mc_entries, cfg_.reint_branch, k,
-                                        cfg_.ushort_scale, "",
-                                        "_reint_u" + std::to_string(k)));
-    }
-    out.sources["Reint (Geant4)"] = sample_covariance(*H_mc, universes);
-  }
+  if (cfg_.use_ppfx && cfg_.N_ppfx > 0)
+    out.sources["Flux (PPFX)"] = sample_covariance(*H_mc, universes(totals, model, "ppfx", cfg_.N_ppfx));
+  if (cfg_.use_genie && cfg_.N_genie > 0)
+    out.sources["GENIE"] = sample_covariance(*H_mc, universes(totals, model, "genie", cfg_.N_genie));
+  if (cfg_.use_reint && cfg_.N_reint > 0)
+    out.sources["Reint (Geant4)"] = sample_covariance(*H_mc, universes(totals, model, "reint", cfg_.N_reint));
 
   out.H_pred = std::unique_ptr<TH1D>(static_cast<TH1D*>(H_mc->Clone("H_pred")));
   out.H_pred->SetDirectory(nullptr);
 
-  if (cfg_.include_ext && !ext_entries.empty()) {
-    if (auto H_ext = make_total_hist(model, cfg_.value_col, cfg_.weight_col, ext_entries, "_ext")) {
-      out.H_pred->Add(H_ext.get());
-      out.sources["EXT stat"] = mc_stat_covariance(*H_ext);
-    }
+  if (cfg_.include_ext && totals.has_hist("ext")) {
+    auto H_ext = total_or_empty(totals, "ext", model, std::string(model.GetName()) + "_ext");
+    out.H_pred->Add(H_ext.get());
+    out.sources["EXT stat"] = mc_stat_covariance(*H_ext);
   }
 
   std::vector<const TMatrixDSym*> pieces;
@@ -1,13 +1,18 @@
 #pragma once
 
+#include <ROOT/RDataFrame.hxx>
 #include <TH1D.h>
 #include <TMatrixDSym.h>
 #include <map>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
-namespace rarexsec { struct Entry; }
+#include "rarexsec/exec/Incremental.h"
+#include "rarexsec/exec/Sharded.h"
+
+namespace rarexsec { struct Entry; class Hub; }
 
 namespace rarexsec::systpack {
 
@@ -37,11 +42,52 @@ struct Result {
 
 class SystematicsPack {
 public:
+  // Histograms of build() booked but not yet filled.
+  struct Booking {
+    std::vector<std::pair<std::string, std::vector<ROOT::RDF::RResultPtr<TH1D>>>> parts;
+  };
+
   explicit SystematicsPack(Config cfg);
   Result build(const TH1D& model,
                const std::vector<const rarexsec::Entry*>& mc_entries,
                const std::vector<const rarexsec::Entry*>& ext_entries) const;
+  // Same result with the event loops split across forked workers; see exec::run_sharded.
+  Result build(const rarexsec::Hub& hub,
+               const TH1D& model,
+               const std::vector<const rarexsec::Entry*>& mc_entries,
+               const std::vector<const rarexsec::Entry*>& ext_entries,
+               const exec::ShardOptions& opt) const;
+  // Same result from per-file partials kept under store_dir, processing only files that are new
+  // since the last call; see exec::run_incremental. The job key covers the config and binning.
+  Result build_incremental(const rarexsec::Hub& hub,
+                           const TH1D& model,
+                           const std::vector<const rarexsec::Entry*>& mc_entries,
+                           const std::vector<const rarexsec::Entry*>& ext_entries,
+                           const std::string& store_dir,
+                           exec::IncrementalStats* stats = nullptr) const;
+  // Books the histograms of build() without running an event loop, so that the pass filling them
+  // can be shared with other booked actions (see exec::Plan); finish() then assembles the result.
+  Booking book(const TH1D& model,
+               const std::vector<const rarexsec::Entry*>& mc_entries,
+               const std::vector<const rarexsec::Entry*>& ext_entries) const;
+  Result finish(const TH1D& model, Booking& booking) const;
+  // Defines the universe weights of the enabled sources on node under the names book() looks for,
+  // so samples prepared once let several binnings or variables share them instead of defining
+  // and evaluating their own.
+  ROOT::RDF::RNode define_universes(ROOT::RDF::RNode node) const;
 private:
+  struct Source { bool use; int n; const std::string& branch; const std::string& cv; const char* key; };
+  std::vector<Source> sources() const;
+
+  // Books every histogram the result needs, runs one event loop per sample and adds the totals
+  // to out as "mc", "<source>/<k>" and "ext".
+  void fill(const TH1D& model,
+            const std::vector<const rarexsec::Entry*>& mc_entries,
+            const std::vector<const rarexsec::Entry*>& ext_entries,
+            exec::Partial& out) const;
+  Result assemble(const TH1D& model, const exec::Partial& totals) const;
+  std::string job_key(const TH1D& model) const;
+
   Config cfg_;
 };
 